@@ -18,15 +18,14 @@ string computeHashForFile(const string& filePath) {
     ostringstream buffer;
     buffer << file.rdbuf();
     string fileContent = buffer.str();
+    countStat(STAT_FILES_OPENED);
+    countStat(STAT_FILES_HASHED);
     
-    // Create blob format: "blob <size>\0<content>"
-    string blobContent = "blob " + to_string(fileContent.length()) + '\0' + fileContent;
-    
-    // Return hash of blob content
-    return computeSHA1FromString(blobContent); // Use your existing SHA1 function
+    // Blob hash, or the chunked manifest hash for large files
+    return computeBlobHash(fileContent);
 }
 
-void addtoindex(const string& filePath, const string& hash) {
+void addtoindex(const string& filePath, const string& hash, bool recordStat, const string& mode) {
     // Skip validation since hash is already computed
     fs::path pathObj(filePath);
     string fileName = pathObj.filename().string();
@@ -37,34 +36,28 @@ void addtoindex(const string& filePath, const string& hash) {
         return;
     }
 
-    // Create .mygit/index file if it doesn't exist
-    fs::path indexPath = ".mygit/index";
-    if (!fs::exists(indexPath.parent_path())) {
-        fs::create_directories(indexPath.parent_path());
+    // Create .mygit directory if it doesn't exist
+    if (!fs::exists(".mygit")) {
+        fs::create_directories(".mygit");
     }
 
-    if (!fs::exists(indexPath)) {
-        ofstream createFile(indexPath);
-        createFile.close();
+    // Index format: mode hash filename, plus stat data when the working
+    // file is known to hold this content
+    IndexEntry entry;
+    entry.mode = mode;
+    entry.hash = hash;
+    entry.path = normalizeRepoPath(filePath);
+    if (recordStat) {
+        fillIndexStat(entry);
     }
 
-    // Open file in append mode
-    ofstream outFile(indexPath, ios::app);
-    if (!outFile) {
-        cerr << "Error: Cannot open index file" << endl;
-        return;
+    if (appendIndexEntry(entry)) {
+        cout << "Added to staging area: " << filePath << endl;
     }
-
-    // Index format: mode hash filename (or keep your "Blob" format)
-    string indexEntry = "100644 " + hash + " " + filePath;
-    outFile << indexEntry << '\n';
-    
-    cout << "Added to staging area: " << filePath << endl;
-    outFile.close();
 }
 
 // FIXED: Single function to create blob and add to index
-bool addFileToStaging(const string& filePath) {
+bool addFileToStaging(const string& filePath, const string& mode) {
     // 1. Compute hash for the file
     string hash = computeHashForFile(filePath);
     if (hash.empty()) {
@@ -79,25 +72,69 @@ bool addFileToStaging(const string& filePath) {
         return false;
     }
     
-    // 3. Add to index
-    addtoindex(filePath, hash);
+    // 3. Add to index, with stat data of the file just hashed
+    addtoindex(filePath, hash, true, mode);
     return true;
 }
 
-void listFilesDFS(const fs::path& path) {
-    for (const auto& entry : fs::recursive_directory_iterator(path)) {
+// Modes of tracked files, so re-adding an executable or symlink entry (its
+// working copy is a plain file) does not turn it into a regular file
+map<string, string> trackedFileModes() {
+    map<string, string> modes;
+    for (const IndexEntry& entry : loadIndex()) {
+        if (entry.mode != "100644" && !entry.skipWorktree) modes[entry.path] = entry.mode;
+    }
+    return modes;
+}
+
+string stagingMode(const map<string, string>& modes, const string& filePath) {
+    auto it = modes.find(normalizeRepoPath(filePath));
+    return it == modes.end() ? "100644" : it->second;
+}
+
+void listFilesDFS(const fs::path& path, const map<string, string>& modes) {
+    for (auto it = fs::recursive_directory_iterator(path); it != fs::recursive_directory_iterator(); ++it) {
+        const fs::directory_entry& entry = *it;
         if (isHidden(entry.path())) {
-            continue; // Skip hidden files and directories
+            // Skip hidden files and directories, including everything in .mygit
+            if (entry.is_directory()) it.disable_recursion_pending();
+            continue;
         }
 
         if (fs::is_regular_file(entry.status())) {
             cout << "Processing file: " << entry.path() << '\n';
             // FIXED: Single function call
-            addFileToStaging(entry.path().string());
+            addFileToStaging(entry.path().string(), stagingMode(modes, entry.path().string()));
         }
     }
 }
 
+// Stage deletions: drop tracked entries at or under path whose working
+// file is gone ("" or "." for the whole worktree). Entries outside the
+// sparse checkout have no working file and are kept.
+size_t stageDeletions(const string& path) {
+    string prefix = normalizeRepoPath(path);
+    if (prefix == ".") prefix.clear();
+
+    vector<IndexEntry> entries = loadIndex();
+    size_t before = entries.size();
+    entries.erase(remove_if(entries.begin(), entries.end(),
+                            [&prefix](const IndexEntry& entry) {
+                                bool inside = prefix.empty() || entry.path == prefix ||
+                                              entry.path.rfind(prefix + "/", 0) == 0;
+                                if (!inside || entry.skipWorktree || fs::exists(fs::symlink_status(entry.path))) {
+                                    return false;
+                                }
+                                cout << "Removed from staging area: " << entry.path << "\n";
+                                return true;
+                            }),
+                  entries.end());
+
+    size_t removed = before - entries.size();
+    if (removed > 0 && !storeIndex(entries)) return 0;
+    return removed;
+}
+
 void add(const string& filename) {
     // Check if repository is initialized
     if (!fs::exists(".mygit")) {
@@ -105,23 +142,26 @@ void add(const string& filename) {
         return;
     }
 
+    map<string, string> modes = trackedFileModes();
     if (filename == ".") {
         cout << "Adding all files in current directory...\n";
-        listFilesDFS(".");
+        listFilesDFS(".", modes);
+        stageDeletions(filename);
     } else if (fs::exists(filename)) {
         if (fs::is_regular_file(filename)) {
             if (!isHidden(filename)) {
                 cout << "Adding file: " << filename << endl;
                 // FIXED: Single function call
-                addFileToStaging(filename);
+                addFileToStaging(filename, stagingMode(modes, filename));
             } else {
                 cout << "Skipping hidden file: " << filename << endl;
             }
         } else if (fs::is_directory(filename)) {
             cout << "Adding directory: " << filename << endl;
-            listFilesDFS(filename);
+            listFilesDFS(filename, modes);
+            stageDeletions(filename);
         }
-    } else {
+    } else if (stageDeletions(filename) == 0) {
         cerr << "Error: File or directory '" << filename << "' does not exist\n";
     }
 }
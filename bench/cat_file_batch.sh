@@ -0,0 +1,43 @@
+#!/bin/bash
+# Benchmark reading every object once per process ("cat-file -p") against
+# one resident "cat-file --batch" process.
+#
+# Usage: bench/cat_file_batch.sh [files]
+# Run from the repository root after building ./mygit.
+
+set -e
+
+FILES=${1:-2000}
+MYGIT=${MYGIT:-$(pwd)/mygit}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cd "$WORK"
+"$MYGIT" init > /dev/null
+
+echo "Generating $FILES files..."
+mkdir src
+awk -v n="$FILES" 'BEGIN { for (f = 1; f <= n; f++) { path = sprintf("src/file%06d.txt", f); print "content of file " f > path; close(path) } }'
+"$MYGIT" add src > /dev/null
+"$MYGIT" commit -m "many files" > /dev/null
+"$MYGIT" cat-file --batch-check --batch-all-objects | awk '{ print $1 }' > ids
+OBJECTS=$(wc -l < ids)
+
+# Time a command and report objects per second
+measure() {
+    local label=$1 start end
+    shift
+    start=$(date +%s.%N)
+    "$@" > /dev/null
+    end=$(date +%s.%N)
+    awk -v label="$label" -v n="$OBJECTS" -v s="$start" -v e="$end" \
+        'BEGIN { t = e - s; printf "%-28s %6d objects  %7.3f s  %10.0f objects/s\n", label, n, t, n / t }'
+}
+
+per_process() {
+    while read -r id; do "$MYGIT" cat-file -p "$id"; done < ids
+}
+
+measure "cat-file -p per object" per_process
+measure "cat-file --batch" "$MYGIT" cat-file --batch < ids
+measure "cat-file --batch-check" "$MYGIT" cat-file --batch-check < ids
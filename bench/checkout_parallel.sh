@@ -0,0 +1,56 @@
+#!/bin/bash
+# Benchmark a fresh checkout (empty working tree) by worker count.
+#
+# Usage: bench/checkout_parallel.sh [files] [directories] ["thread counts"]
+# Run from the repository root after building ./mygit.
+
+set -e
+
+FILES=${1:-20000}
+DIRS=${2:-200}
+THREADS=${3:-"1 2 4 8"}
+MYGIT=${MYGIT:-$(pwd)/mygit}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+mkdir "$WORK/source"
+cd "$WORK/source"
+"$MYGIT" init > /dev/null
+
+echo "Generating $FILES files over $DIRS directories..."
+for d in $(seq 0 $((DIRS - 1))); do
+    mkdir -p "src/dir$d"
+done
+for i in $(seq 1 "$FILES"); do
+    printf 'file %d\n%0512d\n' "$i" "$i" > "src/dir$((i % DIRS))/file$i.txt"
+done
+"$MYGIT" add src > /dev/null
+COMMIT=$("$MYGIT" commit -m "snapshot" | tail -1)
+
+# Each run starts from a copy of the repository with no branches and no files
+fresh_clone() {
+    rm -rf "$WORK/clone"
+    mkdir "$WORK/clone"
+    cp -r "$WORK/source/.mygit" "$WORK/clone/.mygit"
+    rm -rf "$WORK/clone/.mygit/refs/heads" "$WORK/clone/.mygit/packed-refs"
+    : > "$WORK/clone/.mygit/HEAD"
+    : > "$WORK/clone/.mygit/index"
+}
+
+BASELINE=""
+for threads in $THREADS; do
+    fresh_clone
+    cd "$WORK/clone"
+    start=$(date +%s.%N)
+    MYGIT_THREADS=$threads "$MYGIT" checkout "$COMMIT" > /dev/null
+    end=$(date +%s.%N)
+    elapsed=$(awk "BEGIN { printf \"%.3f\", $end - $start }")
+    [ -z "$BASELINE" ] && BASELINE=$elapsed
+    echo "$threads worker(s): $elapsed s, $(awk "BEGIN { printf \"%.2f\", $BASELINE / $elapsed }")x"
+
+    if ! diff -r -q --exclude=.mygit "$WORK/source" "$WORK/clone" > /dev/null; then
+        echo "Checkout with $threads worker(s) differs from the source tree" >&2
+        exit 1
+    fi
+done
+echo "All checkouts match the source tree"
@@ -0,0 +1,47 @@
+#!/bin/bash
+# Benchmark "mygit show" on a large file with small edits.
+#
+# Usage: bench/diff_large_file.sh [lines] [edits]
+# Run from the repository root after building ./mygit.
+
+set -e
+
+LINES=${1:-50000}
+EDITS=${2:-100}
+MYGIT=${MYGIT:-$(pwd)/mygit}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cd "$WORK"
+"$MYGIT" init > /dev/null
+
+echo "Generating a $LINES-line file..."
+awk -v n="$LINES" 'BEGIN { for (i = 1; i <= n; i++) printf "line %d: %s\n", i, (i % 10 == 0 ? "}" : "value = compute(" i ");") }' > big.txt
+"$MYGIT" add big.txt > /dev/null
+"$MYGIT" commit -m "base" > /dev/null
+
+time_show() {
+    local start end
+    start=$(date +%s.%N)
+    "$MYGIT" show > "$WORK/show.txt"
+    end=$(date +%s.%N)
+    echo "$1: $(awk "BEGIN { printf \"%.3f\", $end - $start }") s, $(wc -l < "$WORK/show.txt") output lines," \
+         "$(grep -c '^@@' "$WORK/show.txt") hunks"
+}
+
+# One changed line
+sed -i "$((LINES / 2))s/.*/edited line/" big.txt
+"$MYGIT" add big.txt > /dev/null
+"$MYGIT" commit -m "one edit" > /dev/null
+time_show "1 edited line"
+
+# Scattered edits, insertions and deletions
+awk -v n="$LINES" -v e="$EDITS" 'BEGIN { step = int(n / e) }
+    NR % step == 1 { print "inserted before " NR }
+    NR % step == 2 { next }
+    NR % step == 3 { print "rewritten " NR; next }
+    { print }' big.txt > big.tmp
+mv big.tmp big.txt
+"$MYGIT" add big.txt > /dev/null
+"$MYGIT" commit -m "scattered edits" > /dev/null
+time_show "$EDITS scattered edits"
@@ -0,0 +1,138 @@
+#!/bin/bash
+# Generate a deterministic synthetic repository for scale tests: a history
+# streamed into "mygit fast-import", with its last commit checked out.
+#
+# Usage: bench/gen_repo.sh <dir> [options]
+#   --files N        files in the worktree (default 10000)
+#   --depth D        directory levels above each file (default 3)
+#   --per-dir N      files per leaf directory (default 64)
+#   --commits C      commits in the history (default 1)
+#   --edit-rate R    fraction of files each later commit changes (default 0.001)
+#   --size-median B  median file size in bytes (default 1024)
+#   --size-sigma S   spread of the log-normal size distribution (default 1.0)
+#   --size-max B     largest file size in bytes (default 1048576)
+#   --seed N         random seed (default 1)
+#
+# The same options always produce the same commits, for a given awk.
+# Set MYGIT to the binary to use (default: ./mygit).
+
+set -e
+
+if [ $# -lt 1 ]; then
+    sed -n '2,/^$/s/^# \{0,1\}//p' "$0"
+    exit 1
+fi
+
+DIR=$1
+shift
+FILES=10000
+DEPTH=3
+PER_DIR=64
+COMMITS=1
+EDIT_RATE=0.001
+SIZE_MEDIAN=1024
+SIZE_SIGMA=1.0
+SIZE_MAX=1048576
+SEED=1
+while [ $# -gt 0 ]; do
+    case $1 in
+        --files) FILES=$2 ;;
+        --depth) DEPTH=$2 ;;
+        --per-dir) PER_DIR=$2 ;;
+        --commits) COMMITS=$2 ;;
+        --edit-rate) EDIT_RATE=$2 ;;
+        --size-median) SIZE_MEDIAN=$2 ;;
+        --size-sigma) SIZE_SIGMA=$2 ;;
+        --size-max) SIZE_MAX=$2 ;;
+        --seed) SEED=$2 ;;
+        *) echo "Unknown option $1" >&2; exit 1 ;;
+    esac
+    shift 2
+done
+MYGIT=${MYGIT:-$(pwd)/mygit}
+
+mkdir -p "$DIR"
+cd "$DIR"
+"$MYGIT" init > /dev/null
+
+# Byte counts in the stream must be bytes, not characters
+export LC_ALL=C
+
+awk -v files="$FILES" -v depth="$DEPTH" -v perDir="$PER_DIR" -v commits="$COMMITS" \
+    -v editRate="$EDIT_RATE" -v median="$SIZE_MEDIAN" -v sigma="$SIZE_SIGMA" \
+    -v maxSize="$SIZE_MAX" -v seed="$SEED" '
+# Leaf directories are numbered and spelled in base "fanout", one level each
+function filePath(i,    leaf, path, level, digit) {
+    leaf = int(i / perDir)
+    path = ""
+    for (level = depth - 1; level >= 0; level--) {
+        digit = int(leaf / fanout ^ level) % fanout
+        path = path sprintf("d%0" width "d/", digit)
+    }
+    return path sprintf("f%07d.txt", i)
+}
+
+# Log-normal size around the median (Box-Muller)
+function fileSize(    u, v, size) {
+    u = rand(); v = rand()
+    if (u < 1e-12) u = 1e-12
+    size = int(median * exp(sigma * sqrt(-2 * log(u)) * cos(6.283185307179586 * v)))
+    if (size < 16) size = 16
+    if (size > maxSize) size = maxSize
+    return size
+}
+
+# Content: a header naming the file, text from the shared block, then edits
+function fileContent(i,    header) {
+    header = "file " i "\n"
+    return header substr(block, 1 + (i * 61) % 4096, size[i] - length(header)) edits[i]
+}
+
+function emitFile(i,    content) {
+    content = fileContent(i)
+    printf "M 100644 inline %s\ndata %d\n%s\n", path[i], length(content), content
+}
+
+function emitCommit(n, message) {
+    printf "commit refs/heads/master\n"
+    printf "committer Synthetic <synthetic@example.com> %d +0000\n", 1700000000 + n * 60
+    printf "data %d\n%s\n", length(message), message
+}
+
+BEGIN {
+    srand(seed)
+    leaves = int((files + perDir - 1) / perDir)
+    fanout = depth > 0 ? int(leaves ^ (1 / depth)) : 1
+    while (depth > 0 && fanout ^ depth < leaves) fanout++
+    if (fanout < 2) fanout = 2
+    width = length(fanout - 1 "")
+
+    line = "The quick brown fox jumps over the lazy dog; pack my box with five dozen liquor jugs.\n"
+    block = line
+    while (length(block) < maxSize + 4096) block = block block
+
+    for (i = 0; i < files; i++) {
+        path[i] = filePath(i)
+        size[i] = fileSize()
+        edits[i] = ""
+    }
+
+    emitCommit(0, "Initial synthetic tree")
+    for (i = 0; i < files; i++) emitFile(i)
+
+    perCommit = int(files * editRate + 0.5)
+    if (perCommit < 1) perCommit = 1
+    for (n = 1; n < commits; n++) {
+        emitCommit(n, "Synthetic edit " n)
+        for (k = 0; k < perCommit; k++) {
+            i = int(rand() * files)
+            edits[i] = edits[i] "edit " n "\n"
+            emitFile(i)
+        }
+    }
+    print "done"
+}' | "$MYGIT" fast-import > /dev/null
+
+# Materialize the last commit as the worktree and index
+HEAD_COMMIT=$("$MYGIT" rev-parse HEAD)
+"$MYGIT" reset --hard "$HEAD_COMMIT" > /dev/null
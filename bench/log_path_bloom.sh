@@ -0,0 +1,49 @@
+#!/bin/bash
+# Benchmark "mygit log -- <path>" with and without changed-path Bloom filters
+# over a synthetic linear history.
+#
+# Usage: bench/log_path_bloom.sh [commits] [directories]
+# Run from the repository root after building ./mygit.
+
+set -e
+
+COMMITS=${1:-2000}
+DIRS=${2:-50}
+MYGIT=${MYGIT:-$(pwd)/mygit}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cd "$WORK"
+"$MYGIT" init > /dev/null
+
+echo "Generating $COMMITS commits over $DIRS directories..."
+for i in $(seq 1 "$COMMITS"); do
+    dir="services/dir$((i % DIRS))"
+    mkdir -p "$dir"
+    echo "revision $i" > "$dir/file$((i % 7)).txt"
+    "$MYGIT" add "$dir/file$((i % 7)).txt" > /dev/null
+    "$MYGIT" commit -m "revision $i" > /dev/null
+done
+
+"$MYGIT" commit-graph write
+
+time_log() {
+    local start end
+    start=$(date +%s.%N)
+    "$MYGIT" log --oneline -- services/dir7 > "$WORK/log_$1.txt"
+    end=$(date +%s.%N)
+    echo "$1: $(awk "BEGIN { printf \"%.3f\", $end - $start }") s, $(wc -l < "$WORK/log_$1.txt") commits matched"
+}
+
+time_log "with bloom filters"
+
+mv .mygit/objects/info/commit-graph-bloom "$WORK/bloom.saved"
+time_log "without bloom filters"
+mv "$WORK/bloom.saved" .mygit/objects/info/commit-graph-bloom
+
+if cmp -s "$WORK/log_with bloom filters.txt" "$WORK/log_without bloom filters.txt"; then
+    echo "Outputs match"
+else
+    echo "Outputs differ" >&2
+    exit 1
+fi
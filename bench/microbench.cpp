@@ -0,0 +1,294 @@
+#include <benchmark/benchmark.h>
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <unistd.h>
+#include "../header.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+// Microbenchmarks of the hot paths (make bench)
+//
+// Inputs are synthetic and deterministic (fixed seed), in several size
+// classes per benchmark. Functions that read the object store or the
+// filesystem run inside a scratch repository created under $TMPDIR, which
+// is removed at exit. make bench writes the results as JSON so two builds
+// can be compared with Google Benchmark's tools/compare.py.
+
+// Text that compresses like source code: lines of words from a small vocabulary
+string syntheticText(size_t size, unsigned seed = 42) {
+    static const char* const words[] = {"const", "string", "return", "entry", "tree", "size_t", "if", "for",
+                                        "while", "hash", "index", "commit", "vector", "auto", "path", "=", "{", "}",
+                                        "(", ")", ";", "0", "1", "true", "false", "error", "data", "object"};
+    mt19937 random(seed);
+    string text;
+    text.reserve(size);
+    while (text.size() < size) {
+        text += words[random() % (sizeof(words) / sizeof(words[0]))];
+        text += random() % 8 == 0 ? '\n' : ' ';
+    }
+    text.resize(size);
+    return text;
+}
+
+string syntheticObjectId(mt19937& random) {
+    static const char digits[] = "0123456789abcdef";
+    string id(40, '0');
+    for (char& c : id) c = digits[random() % 16];
+    return id;
+}
+
+// Content of a tree with count entries, one in eight a subtree
+string syntheticTreeContent(size_t count) {
+    mt19937 random(7);
+    string content;
+    char name[32];
+    for (size_t i = 0; i < count; i++) {
+        bool isTree = i % 8 == 7;
+        snprintf(name, sizeof(name), isTree ? "dir%06zu" : "file%06zu.txt", i);
+        content += isTree ? "40000 " : "100644 ";
+        content += name;
+        content += '\0';
+        ObjectId id;
+        hexToObjectId(syntheticObjectId(random), id);
+        content.append(reinterpret_cast<const char*>(id.bytes.data()), id.bytes.size());
+    }
+    return content;
+}
+
+// Store an object in the scratch repository and return its id
+string storeSyntheticObject(const string& type, const string& content) {
+    string object = type + " " + to_string(content.size()) + '\0' + content;
+    string hash = computeSHA1FromString(object);
+    string error;
+    storeObject(".mygit", hash, object, error);
+    return hash;
+}
+
+void BM_ComputeSHA1FromString(benchmark::State& state) {
+    string data = syntheticText(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(computeSHA1FromString(data));
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_ComputeSHA1FromString)->RangeMultiplier(64)->Range(64, 16 << 20);
+
+void BM_CompressData(benchmark::State& state) {
+    string data = syntheticText(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(compressData(data));
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_CompressData)->RangeMultiplier(64)->Range(64, 16 << 20);
+
+void BM_DecompressData(benchmark::State& state) {
+    string data = syntheticText(state.range(0));
+    string compressed = compressData(data);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decompressData(compressed));
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_DecompressData)->RangeMultiplier(64)->Range(64, 16 << 20);
+
+void BM_ParseObject(benchmark::State& state) {
+    string content = syntheticText(state.range(0));
+    string object = "blob " + to_string(content.size()) + '\0' + content;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parseObject(object));
+    }
+    state.SetBytesProcessed(state.iterations() * object.size());
+}
+BENCHMARK(BM_ParseObject)->RangeMultiplier(64)->Range(64, 1 << 20);
+
+void BM_ParseTreeEntry(benchmark::State& state) {
+    string content = syntheticTreeContent(state.range(0));
+    TreeEntry entry;
+    for (auto _ : state) {
+        size_t pos = 0;
+        while (parseTreeEntry(content, pos, entry)) {
+            benchmark::DoNotOptimize(entry);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ParseTreeEntry)->RangeMultiplier(16)->Range(16, 4096);
+
+// A fresh arena per iteration, as each walk gets one
+void BM_ReadTreeEntries(benchmark::State& state) {
+    string treeSHA = storeSyntheticObject("tree", syntheticTreeContent(state.range(0)));
+    for (auto _ : state) {
+        TreeArena arena;
+        benchmark::DoNotOptimize(readTreeEntries(arena, treeSHA).data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ReadTreeEntries)->RangeMultiplier(16)->Range(16, 4096);
+
+// Commit whose message is range(0) bytes long
+void BM_ParseCommitObject(benchmark::State& state) {
+    mt19937 random(11);
+    string content = "tree " + syntheticObjectId(random) + "\nparent " + syntheticObjectId(random) +
+                     "\nauthor Bench <bench@example.com> 1700000000 +0000"
+                     "\ncommitter Bench <bench@example.com> 1700000000 +0000\n\n" +
+                     syntheticText(state.range(0), 11);
+    string commitSHA = storeSyntheticObject("commit", content);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(parseCommitObject(commitSHA));
+    }
+}
+BENCHMARK(BM_ParseCommitObject)->RangeMultiplier(32)->Range(64, 65536);
+
+// Index with range(0) entries, 100 files per directory
+void BM_ReadIndexFile(benchmark::State& state) {
+    size_t count = state.range(0);
+    string path = "index-" + to_string(count);
+    if (!fs::exists(path)) {
+        mt19937 random(13);
+        vector<IndexEntry> entries(count);
+        char name[64];
+        for (size_t i = 0; i < count; i++) {
+            snprintf(name, sizeof(name), "src/dir%04zu/file%06zu.txt", i / 100, i);
+            entries[i].mode = "100644";
+            entries[i].hash = syntheticObjectId(random);
+            entries[i].path = name;
+            entries[i].mtimeNs = 1700000000000000000LL + static_cast<long long>(i);
+            entries[i].size = static_cast<long long>(random() % 100000);
+        }
+        storeIndex(entries);
+        fs::rename(".mygit/index", path);
+    }
+
+    vector<IndexEntry> entries;
+    for (auto _ : state) {
+        readIndexFile(path, entries);
+        benchmark::DoNotOptimize(entries.data());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ReadIndexFile)->RangeMultiplier(10)->Range(1000, 100000);
+
+// Worktree of range(0) empty files, 100 per directory
+void BM_ScanDirectory(benchmark::State& state) {
+    size_t count = state.range(0);
+    string root = "worktree-" + to_string(count);
+    if (!fs::exists(root)) {
+        char name[64];
+        for (size_t i = 0; i < count; i++) {
+            if (i % 100 == 0) fs::create_directories(root + "/dir" + to_string(i / 100));
+            snprintf(name, sizeof(name), "/dir%zu/file%06zu.txt", i / 100, i);
+            ofstream(root + name);
+        }
+    }
+
+    for (auto _ : state) {
+        set<string> files;
+        scanDirectory(root, "", files);
+        benchmark::DoNotOptimize(files.size());
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_ScanDirectory)->RangeMultiplier(10)->Range(100, 10000)->Unit(benchmark::kMillisecond);
+
+// packed-refs with range(0) tags, replaced only when the count changes
+void writeSyntheticPackedRefs(size_t count) {
+    static size_t written = 0;
+    if (written == count) return;
+    mt19937 random(17);
+    ofstream file(".mygit/packed-refs", ios::trunc);
+    file << "# pack-refs with: sorted\n";
+    char name[64];
+    for (size_t i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "refs/tags/v%07zu", i);
+        file << syntheticObjectId(random) << " " << name << "\n";
+    }
+    written = count;
+}
+
+// Lookups of packed tags (no loose file exists, so each one also pays the
+// failed open of the loose path)
+void BM_ReadPackedRef(benchmark::State& state) {
+    size_t count = state.range(0);
+    writeSyntheticPackedRefs(count);
+    mt19937 random(19);
+    char name[64];
+    string id;
+    for (auto _ : state) {
+        snprintf(name, sizeof(name), "refs/tags/v%07zu", static_cast<size_t>(random() % count));
+        benchmark::DoNotOptimize(readRef(name, id));
+    }
+}
+BENCHMARK(BM_ReadPackedRef)->RangeMultiplier(100)->Range(100, 1000000);
+
+// Moving a loose branch while range(0) tags are packed
+void BM_UpdateRef(benchmark::State& state) {
+    writeSyntheticPackedRefs(state.range(0));
+    mt19937 random(23);
+    string ids[2] = {syntheticObjectId(random), syntheticObjectId(random)};
+    string error;
+    size_t n = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(updateRef("refs/heads/bench", ids[n++ % 2], "", error));
+    }
+}
+BENCHMARK(BM_UpdateRef)->RangeMultiplier(100)->Range(100, 1000000);
+
+// Scratch repository the benchmarks run in
+class ScratchRepository {
+public:
+    ScratchRepository() {
+        const char* tmp = getenv("TMPDIR");
+        string pattern = string(tmp && *tmp ? tmp : "/tmp") + "/mygit-bench-XXXXXX";
+        vector<char> buffer(pattern.begin(), pattern.end());
+        buffer.push_back('\0');
+        if (!mkdtemp(buffer.data())) return;
+        path = buffer.data();
+        fs::current_path(path);
+        fs::create_directories(".mygit/objects");
+    }
+
+    ~ScratchRepository() {
+        if (path.empty()) return;
+        error_code ec;
+        fs::current_path("/", ec);
+        fs::remove_all(path, ec);
+    }
+
+    bool ready() const { return !path.empty(); }
+
+private:
+    string path;
+};
+
+int main(int argc, char** argv) {
+    // The benchmarks run in the scratch repository, so a relative output
+    // file is resolved against the directory mygit-bench started in
+    const string outputFlag = "--benchmark_out=";
+    vector<string> absoluteArgs;
+    absoluteArgs.reserve(argc);
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind(outputFlag, 0) != 0) continue;
+        absoluteArgs.push_back(outputFlag + fs::absolute(arg.substr(outputFlag.size())).string());
+        argv[i] = absoluteArgs.back().data();
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+
+    ScratchRepository repository;
+    if (!repository.ready()) {
+        cerr << "Error: Cannot create a scratch repository\n";
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,47 @@
+#!/bin/bash
+# Benchmark output throughput (lines/s) of "mygit show" and "mygit ls-tree [-r]"
+# when piped, which is where per-line writes used to dominate.
+#
+# Usage: bench/output_throughput.sh [files] [lines-per-file]
+# Run from the repository root after building ./mygit.
+
+set -e
+
+FILES=${1:-20000}
+LINES=${2:-20}
+MYGIT=${MYGIT:-$(pwd)/mygit}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+cd "$WORK"
+"$MYGIT" init > /dev/null
+
+echo "Generating $FILES files of $LINES lines, 100 per directory..."
+awk -v n="$FILES" -v l="$LINES" 'BEGIN {
+    for (f = 1; f <= n; f++) {
+        if (f % 100 == 1) system(sprintf("mkdir -p src/dir%04d", int((f - 1) / 100)))
+        path = sprintf("src/dir%04d/file%06d.txt", int((f - 1) / 100), f)
+        for (i = 1; i <= l; i++) printf "file %d line %d\n", f, i > path
+        close(path)
+    }
+}'
+"$MYGIT" add src > /dev/null
+"$MYGIT" commit -m "many files" > /dev/null
+
+TREE=$("$MYGIT" write-tree | awk '{ print $NF }')
+
+# Run a command into a pipe and report lines per second
+measure() {
+    local label=$1 start end lines
+    shift
+    start=$(date +%s.%N)
+    lines=$("$@" | wc -l)
+    end=$(date +%s.%N)
+    awk -v label="$label" -v lines="$lines" -v s="$start" -v e="$end" \
+        'BEGIN { t = e - s; printf "%-22s %9d lines  %7.3f s  %10.0f lines/s\n", label, lines, t, lines / t }'
+}
+
+measure "show (patch)" "$MYGIT" show
+measure "show --name-status" "$MYGIT" show --name-status
+measure "ls-tree -r" "$MYGIT" ls-tree -r "$TREE"
+measure "ls-tree -r --long" "$MYGIT" ls-tree -r --long "$TREE"
@@ -0,0 +1,128 @@
+#!/bin/bash
+# Scale harness: build synthetic repositories of increasing size with
+# bench/gen_repo.sh and time status, add, commit, show, log and checkout
+# on each, cold and warm. Every run records wall time, CPU time and peak
+# RSS (from --stats=json) plus the process wall time seen from outside.
+#
+# Usage: bench/scale.sh [options] [file-count...]
+#   --commits C     history length (default 100)
+#   --edit-rate R   fraction of files each commit changes (default 0.001)
+#   --depth D       directory levels (default 3)
+#   --size-median B median file size in bytes (default 1024)
+#   --seed N        generator seed (default 1)
+#   --out FILE      write the JSON here instead of stdout
+# File counts default to "10000 100000".
+#
+# Cold runs drop the page cache first when /proc/sys/vm/drop_caches is
+# writable (as root); the JSON says whether that happened. Warm runs repeat
+# the same step with everything cached. Run from the repository root after
+# building ./mygit.
+
+set -e
+
+COMMITS=100
+EDIT_RATE=0.001
+DEPTH=3
+SIZE_MEDIAN=1024
+SEED=1
+OUT=
+SIZES=()
+while [ $# -gt 0 ]; do
+    case $1 in
+        --commits) COMMITS=$2; shift ;;
+        --edit-rate) EDIT_RATE=$2; shift ;;
+        --depth) DEPTH=$2; shift ;;
+        --size-median) SIZE_MEDIAN=$2; shift ;;
+        --seed) SEED=$2; shift ;;
+        --out) OUT=$2; shift ;;
+        *) SIZES+=("$1") ;;
+    esac
+    shift
+done
+[ ${#SIZES[@]} -gt 0 ] || SIZES=(10000 100000)
+
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+MYGIT=${MYGIT:-$(pwd)/mygit}
+export MYGIT MYGIT_NO_SERVER=1
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+CACHE_DROPPED=false
+if [ -w /proc/sys/vm/drop_caches ]; then CACHE_DROPPED=true; fi
+
+RUNS=()
+MODE=
+FILES=
+
+drop_caches() {
+    if [ "$MODE" = cold ] && [ "$CACHE_DROPPED" = true ]; then
+        sync
+        echo 3 > /proc/sys/vm/drop_caches
+    fi
+}
+
+# Time one mygit command and append its JSON record to RUNS
+measure() {
+    local label=$1 start end stats
+    shift
+    drop_caches
+    start=$(date +%s%N)
+    stats=$("$MYGIT" --stats=json "$@" 2>&1 > /dev/null | tail -n 1) || true
+    end=$(date +%s%N)
+    case $stats in
+        "{"*) ;;
+        *) stats='{"failed":true}' ;;
+    esac
+    RUNS+=("$(printf '{"files":%d,"commits":%d,"command":"%s","mode":"%s","process_wall_ms":%d,%s' \
+        "$FILES" "$COMMITS" "$label" "$MODE" $(((end - start) / 1000000)) "${stats#\{}")")
+    echo "  $MODE $label: $(((end - start) / 1000000)) ms" >&2
+}
+
+# Append a line to every STEP-th file, so each round changes different files
+edit_files() {
+    local round=$1
+    awk -v step="$STEP" -v offset="$round" -v round="$round" \
+        'NR % step == offset % step { print "scale edit " round >> $0; close($0) }' "$FILE_LIST"
+}
+
+for FILES in "${SIZES[@]}"; do
+    echo "Generating $FILES files, $COMMITS commits..." >&2
+    REPO=$WORK/repo-$FILES
+    "$BENCH_DIR/gen_repo.sh" "$REPO" --files "$FILES" --commits "$COMMITS" --edit-rate "$EDIT_RATE" \
+        --depth "$DEPTH" --size-median "$SIZE_MEDIAN" --seed "$SEED"
+    cd "$REPO"
+
+    FILE_LIST=$WORK/files-$FILES.txt
+    find . -path ./.mygit -prune -o -type f -print | LC_ALL=C sort > "$FILE_LIST"
+    EDITED=$(awk -v n="$FILES" -v r="$EDIT_RATE" 'BEGIN { e = int(n * r * 10 + 0.5); print e < 1 ? 1 : e }')
+    STEP=$((FILES / EDITED))
+    [ "$STEP" -ge 1 ] || STEP=1
+    ROOT=$("$MYGIT" log | awk '/^Commit:/ { c = $2 } END { print c }')
+
+    round=0
+    for MODE in cold warm; do
+        round=$((round + 1))
+        edit_files "$round"
+        measure status status
+        measure "add ." add .
+        measure commit commit -m "scale $MODE"
+        measure show show
+        measure log log
+        measure checkout checkout "$ROOT"
+        "$MYGIT" checkout master > /dev/null
+    done
+
+    cd "$WORK"
+    rm -rf "$REPO"
+done
+
+{
+    printf '{"generator":{"commits":%d,"edit_rate":%s,"depth":%d,"size_median":%d,"seed":%d},' \
+        "$COMMITS" "$EDIT_RATE" "$DEPTH" "$SIZE_MEDIAN" "$SEED"
+    printf '"cache_dropped":%s,"runs":[\n' "$CACHE_DROPPED"
+    for i in "${!RUNS[@]}"; do
+        [ "$i" -eq 0 ] || printf ',\n'
+        printf '%s' "${RUNS[$i]}"
+    done
+    printf '\n]}\n'
+} > "${OUT:-/dev/stdout}"
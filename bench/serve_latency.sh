@@ -0,0 +1,59 @@
+#!/bin/bash
+# Benchmark short commands run one process at a time against the same
+# commands sent to a resident "mygit serve" with warm caches.
+#
+# Usage: bench/serve_latency.sh [files] [runs]
+# Run from the repository root after building ./mygit.
+
+set -e
+
+FILES=${1:-20000}
+RUNS=${2:-50}
+MYGIT=${MYGIT:-$(pwd)/mygit}
+WORK=$(mktemp -d)
+trap '"$MYGIT" serve --stop > /dev/null 2>&1 || true; rm -rf "$WORK"' EXIT
+
+cd "$WORK"
+"$MYGIT" init > /dev/null
+
+echo "Generating $FILES files, 100 per directory..."
+awk -v n="$FILES" 'BEGIN {
+    for (f = 1; f <= n; f++) {
+        if (f % 100 == 1) system(sprintf("mkdir -p src/dir%04d", int((f - 1) / 100)))
+        path = sprintf("src/dir%04d/file%06d.txt", int((f - 1) / 100), f)
+        print "content of file " f > path
+        close(path)
+    }
+}'
+"$MYGIT" add src > /dev/null
+"$MYGIT" commit -m "many files" > /dev/null
+"$MYGIT" commit-graph write > /dev/null
+TREE=$("$MYGIT" write-tree | awk '{ print $NF }')
+# Let the index settle so the daemon may cache it
+sleep 2
+
+# Run a command RUNS times and report the mean latency
+measure() {
+    local label=$1 start end
+    shift
+    start=$(date +%s.%N)
+    for ((i = 0; i < RUNS; i++)); do "$@" > /dev/null; done
+    end=$(date +%s.%N)
+    awk -v label="$label" -v n="$RUNS" -v s="$start" -v e="$end" \
+        'BEGIN { printf "%-32s %8.2f ms/command\n", label, (e - s) * 1000 / n }'
+}
+
+run_all() {
+    measure "status ($1)" "$MYGIT" status
+    measure "log -n 1 ($1)" "$MYGIT" log -n 1
+    measure "ls-tree -r ($1)" "$MYGIT" ls-tree -r "$TREE"
+}
+
+MYGIT_NO_SERVER=1 run_all "one process each"
+
+"$MYGIT" serve > /dev/null &
+while [ ! -S .mygit/serve.sock ]; do sleep 0.1; done
+run_all "mygit serve"
+
+echo
+"$MYGIT" serve --report
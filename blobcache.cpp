@@ -0,0 +1,172 @@
+#include <iostream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <thread>
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include "header.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+// Uncompressed blob cache for checkout (.mygit/blob-cache)
+//
+// Opt in with "checkout.blobCache = true". Each blob is inflated once into
+// the cache. Working files are then cloned from it with FICLONE, which
+// shares extents on btrfs and XFS. Where that is not supported the file is
+// copied with copy_file_range, and after that with plain read/write. Cache
+// files are never hard-linked into the working tree, because editing the
+// working file would then corrupt the cache. The cache is trimmed to
+// "checkout.blobCacheSize" bytes (default 1 GiB), least recently used first.
+
+const string BLOB_CACHE_DIR = ".mygit/blob-cache";
+const unsigned long long DEFAULT_BLOB_CACHE_SIZE = 1ULL << 30;
+
+bool blobCacheEnabled() {
+    return cachedConfig().blobCache;
+}
+
+unsigned long long blobCacheBudget() {
+    string value = readConfigValue("checkout.blobCacheSize");
+    if (value.empty()) return DEFAULT_BLOB_CACHE_SIZE;
+    return strtoull(value.c_str(), nullptr, 10);
+}
+
+string blobCachePath(const string& blobSHA) {
+    return BLOB_CACHE_DIR + "/" + blobSHA.substr(0, 2) + "/" + blobSHA.substr(2);
+}
+
+// Stream a blob into the cache (temp file + rename, so concurrent
+// checkouts never see a partial entry)
+bool fillBlobCache(const string& blobSHA, const string& cachePath, string& error) {
+    error_code ec;
+    fs::create_directories(fs::path(cachePath).parent_path(), ec);
+    string tempPath = cachePath + ".tmp" + to_string(getpid()) + "-" +
+                      to_string(hash<thread::id>{}(this_thread::get_id()));
+
+    int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0444);
+    if (fd < 0) {
+        error = "Cannot write blob cache entry for " + blobSHA;
+        return false;
+    }
+    bool written = writeBlobToFd(blobSHA, fd, checkoutPreallocate(), error);
+    if (close(fd) != 0 || !written) {
+        unlink(tempPath.c_str());
+        if (error.empty()) error = "Cannot write blob cache entry for " + blobSHA;
+        return false;
+    }
+
+    if (rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        unlink(tempPath.c_str());
+        error = "Cannot write blob cache entry for " + blobSHA;
+        return false;
+    }
+    return true;
+}
+
+// Copy an open source file into an open destination: reflink if the
+// filesystem shares extents, otherwise an in-kernel copy, otherwise read/write
+bool cloneFileContents(int sourceFd, int destFd, off_t length) {
+    if (ioctl(destFd, FICLONE, sourceFd) == 0) {
+        return true;
+    }
+
+    off_t remaining = length;
+    while (remaining > 0) {
+        ssize_t copied = copy_file_range(sourceFd, nullptr, destFd, nullptr, static_cast<size_t>(remaining), 0);
+        if (copied <= 0) break;
+        remaining -= copied;
+    }
+    if (remaining == 0) return true;
+
+    // copy_file_range unsupported (or cross-device on older kernels):
+    // start over with plain reads
+    if (lseek(sourceFd, 0, SEEK_SET) < 0 || lseek(destFd, 0, SEEK_SET) < 0 || ftruncate(destFd, 0) != 0) {
+        return false;
+    }
+    char buffer[1 << 16];
+    while (true) {
+        ssize_t bytesRead = read(sourceFd, buffer, sizeof(buffer));
+        if (bytesRead < 0 && errno == EINTR) continue;
+        if (bytesRead < 0) return false;
+        if (bytesRead == 0) return true;
+        if (!writeAll(destFd, buffer, static_cast<size_t>(bytesRead))) return false;
+    }
+}
+
+// Materialize a working file from the cache, filling the cache on a miss.
+// Parent directories must exist.
+bool materializeFromBlobCache(const string& path, const string& blobSHA, string& error) {
+    string cachePath = blobCachePath(blobSHA);
+
+    int sourceFd = open(cachePath.c_str(), O_RDONLY);
+    if (sourceFd < 0) {
+        countStat(STAT_CACHE_MISSES);
+        if (!fillBlobCache(blobSHA, cachePath, error)) return false;
+        sourceFd = open(cachePath.c_str(), O_RDONLY);
+        if (sourceFd < 0) {
+            error = "Cannot open blob cache entry for " + blobSHA;
+            return false;
+        }
+    } else {
+        countStat(STAT_CACHE_HITS);
+        futimens(sourceFd, nullptr); // recency for eviction
+    }
+
+    struct stat info;
+    fstat(sourceFd, &info);
+
+    int destFd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (destFd < 0) {
+        close(sourceFd);
+        error = "Cannot create file " + path;
+        return false;
+    }
+    countStat(STAT_FILES_OPENED);
+
+    bool copied = cloneFileContents(sourceFd, destFd, info.st_size);
+    close(sourceFd);
+    close(destFd);
+    if (!copied) {
+        error = "Cannot write file " + path;
+        return false;
+    }
+    return true;
+}
+
+// Evict least recently used entries until the cache fits its budget
+void trimBlobCache() {
+    TraceSpan span("trimBlobCache");
+    struct CacheFile {
+        fs::path path;
+        fs::file_time_type lastUsed;
+        uintmax_t size;
+    };
+
+    vector<CacheFile> files;
+    uintmax_t total = 0;
+    error_code ec;
+    for (auto it = fs::recursive_directory_iterator(BLOB_CACHE_DIR, ec); it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        if (!it->is_regular_file(ec)) continue;
+        CacheFile file{it->path(), it->last_write_time(ec), it->file_size(ec)};
+        total += file.size;
+        files.push_back(move(file));
+    }
+
+    unsigned long long budget = blobCacheBudget();
+    if (total <= budget) return;
+
+    sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.lastUsed < b.lastUsed; });
+    for (const CacheFile& file : files) {
+        if (total <= budget) break;
+        if (fs::remove(file.path, ec)) total -= file.size;
+    }
+}
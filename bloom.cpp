@@ -0,0 +1,362 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <set>
+#include <map>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include <openssl/sha.h>
+#include "header.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+// Changed-path Bloom filters (.mygit/objects/info/commit-graph-bloom)
+//
+// For every commit in the commit-graph we store a Bloom filter of the paths
+// changed against its first parent, including every directory prefix of
+// those paths. "log -- <path>" skips the tree diff for commits whose filter
+// says the path is definitely not there.
+//
+//   header   "MGBF" | version (u32) | commit count N (u32) |
+//            hash count (u32) | bits per entry (u32)
+//   ids      N x 20-byte commit ids, sorted
+//   ends     N x u32 end offset of each commit's filter in the data section
+//   data     concatenated filters
+//   trailer  SHA-1 of everything above
+//
+// A filter of one 0xFF byte means "too many changes"; it matches every path.
+
+const char BLOOM_MAGIC[4] = {'M', 'G', 'B', 'F'};
+const uint32_t BLOOM_VERSION = 1;
+const uint32_t BLOOM_HASH_COUNT = 7;
+const uint32_t BLOOM_BITS_PER_ENTRY = 10;
+const size_t BLOOM_MAX_CHANGED_PATHS = 512;
+const size_t BLOOM_HEADER_SIZE = 20;
+
+string bloomFilterPath() {
+    return ".mygit/objects/info/commit-graph-bloom";
+}
+
+uint32_t rotl32(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// MurmurHash3 (x86, 32-bit)
+uint32_t murmur3Hash(const string& key, uint32_t seed) {
+    const uint32_t c1 = 0xcc9e2d51, c2 = 0x1b873593;
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(key.data());
+    size_t blocks = key.size() / 4;
+    uint32_t h = seed;
+
+    for (size_t i = 0; i < blocks; i++) {
+        uint32_t k = uint32_t(data[4 * i]) | (uint32_t(data[4 * i + 1]) << 8) |
+                     (uint32_t(data[4 * i + 2]) << 16) | (uint32_t(data[4 * i + 3]) << 24);
+        k = rotl32(k * c1, 15) * c2;
+        h = rotl32(h ^ k, 13) * 5 + 0xe6546b64;
+    }
+
+    const unsigned char* tail = data + blocks * 4;
+    uint32_t k = 0;
+    switch (key.size() & 3) {
+        case 3: k ^= uint32_t(tail[2]) << 16; [[fallthrough]];
+        case 2: k ^= uint32_t(tail[1]) << 8; [[fallthrough]];
+        case 1: k ^= tail[0];
+                h ^= rotl32(k * c1, 15) * c2;
+    }
+
+    h ^= static_cast<uint32_t>(key.size());
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+// Bit positions for a path (double hashing)
+vector<uint32_t> bloomBitPositions(const string& path, size_t filterBits) {
+    uint32_t h1 = murmur3Hash(path, 0x293ae76f);
+    uint32_t h2 = murmur3Hash(path, 0x7e646e2c);
+    vector<uint32_t> positions(BLOOM_HASH_COUNT);
+    for (uint32_t i = 0; i < BLOOM_HASH_COUNT; i++) {
+        positions[i] = static_cast<uint32_t>((h1 + uint64_t(i) * h2) % filterBits);
+    }
+    return positions;
+}
+
+// Strip "./" prefixes and trailing slashes so all paths compare the same way
+string normalizeRepoPath(string path) {
+    while (path.rfind("./", 0) == 0) path = path.substr(2);
+    while (!path.empty() && path.back() == '/') path.pop_back();
+    return path;
+}
+
+// Add a changed path and all of its directory prefixes
+void addChangedPath(const string& path, set<string>& paths) {
+    string normalized = normalizeRepoPath(path);
+    if (normalized.empty()) return;
+    paths.insert(normalized);
+    for (size_t slash = normalized.find('/'); slash != string::npos; slash = normalized.find('/', slash + 1)) {
+        paths.insert(normalized.substr(0, slash));
+    }
+}
+
+// Collect paths that differ between two trees, skipping identical subtrees.
+// Either tree may be empty (root commit, or a path added/removed).
+void collectChangedPaths(TreeArena& arena, const ObjectId* oldTree, const ObjectId* newTree,
+                         const string& prefix, set<string>& paths) {
+    if (oldTree && newTree && *oldTree == *newTree) return;
+
+    map<string_view, const TreeEntry*> oldEntries, newEntries;
+    if (oldTree) {
+        for (const auto& entry : readTreeEntries(arena, *oldTree)) oldEntries[entry.name] = &entry;
+    }
+    if (newTree) {
+        for (const auto& entry : readTreeEntries(arena, *newTree)) newEntries[entry.name] = &entry;
+    }
+
+    auto visit = [&](string_view name, const TreeEntry* oldEntry, const TreeEntry* newEntry) {
+        if (oldEntry && newEntry && oldEntry->id == newEntry->id) return;
+        string fullPath = joinTreePath(prefix, name);
+
+        addChangedPath(fullPath, paths);
+        const ObjectId* oldSubtree = oldEntry && oldEntry->isTree() ? &oldEntry->id : nullptr;
+        const ObjectId* newSubtree = newEntry && newEntry->isTree() ? &newEntry->id : nullptr;
+        if (oldSubtree || newSubtree) {
+            collectChangedPaths(arena, oldSubtree, newSubtree, fullPath, paths);
+        }
+    };
+
+    for (const auto& [name, entry] : oldEntries) {
+        auto it = newEntries.find(name);
+        visit(name, entry, it == newEntries.end() ? nullptr : it->second);
+    }
+    for (const auto& [name, entry] : newEntries) {
+        if (!oldEntries.count(name)) visit(name, nullptr, entry);
+    }
+}
+
+void collectChangedPaths(const string& oldTreeSHA, const string& newTreeSHA,
+                         const string& prefix, set<string>& paths) {
+    ObjectId oldTree, newTree;
+    bool hasOld = hexToObjectId(oldTreeSHA, oldTree);
+    bool hasNew = hexToObjectId(newTreeSHA, newTree);
+    TreeArena arena;
+    collectChangedPaths(arena, hasOld ? &oldTree : nullptr, hasNew ? &newTree : nullptr, prefix, paths);
+}
+
+// Paths changed by a commit relative to its first parent
+set<string> changedPathsForCommit(const CommitSummary& commit) {
+    set<string> paths;
+    string parentTree;
+    if (!commit.parents.empty()) {
+        CommitSummary parent;
+        if (readCommitSummary(commit.parents[0], parent)) {
+            parentTree = parent.treeHash;
+        }
+    }
+    collectChangedPaths(parentTree, commit.treeHash, "", paths);
+    return paths;
+}
+
+// Build the filter bytes for a set of changed paths
+string buildChangedPathFilter(const set<string>& paths) {
+    if (paths.size() > BLOOM_MAX_CHANGED_PATHS) {
+        return string(1, static_cast<char>(0xFF));
+    }
+    if (paths.empty()) {
+        return "";
+    }
+
+    size_t filterBytes = max<size_t>(8, (paths.size() * BLOOM_BITS_PER_ENTRY + 7) / 8);
+    string filter(filterBytes, '\0');
+    for (const string& path : paths) {
+        for (uint32_t bit : bloomBitPositions(path, filterBytes * 8)) {
+            filter[bit / 8] |= static_cast<char>(1 << (bit % 8));
+        }
+    }
+    return filter;
+}
+
+// Loaded Bloom filter file; empty when missing or invalid
+struct BloomFilterFile {
+    string data;
+    uint32_t count = 0;
+    const unsigned char* ids = nullptr;
+    const unsigned char* ends = nullptr;
+    const unsigned char* filters = nullptr;
+    size_t filterDataSize = 0;
+};
+
+BloomFilterFile readBloomFilterFile() {
+    BloomFilterFile b;
+    ifstream file(bloomFilterPath(), ios::binary);
+    if (!file) return b;
+
+    b.data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    const unsigned char* base = reinterpret_cast<const unsigned char*>(b.data.data());
+    if (b.data.size() < BLOOM_HEADER_SIZE + SHA_DIGEST_LENGTH || memcmp(base, BLOOM_MAGIC, 4) != 0 ||
+        readBE32(base + 4) != BLOOM_VERSION || readBE32(base + 12) != BLOOM_HASH_COUNT) {
+        b.data.clear();
+        return b;
+    }
+
+    uint32_t count = readBE32(base + 8);
+    size_t tablesSize = size_t(count) * (SHA_DIGEST_LENGTH + 4);
+    if (b.data.size() < BLOOM_HEADER_SIZE + tablesSize + SHA_DIGEST_LENGTH) {
+        b.data.clear();
+        return b;
+    }
+
+    b.count = count;
+    b.ids = base + BLOOM_HEADER_SIZE;
+    b.ends = b.ids + size_t(count) * SHA_DIGEST_LENGTH;
+    b.filters = b.ends + size_t(count) * 4;
+    b.filterDataSize = b.data.size() - BLOOM_HEADER_SIZE - tablesSize - SHA_DIGEST_LENGTH;
+    if (count > 0 && readBE32(b.ends + 4 * (count - 1)) != b.filterDataSize) {
+        b.data.clear();
+        b.count = 0;
+    }
+    return b;
+}
+
+BloomFilterFile& bloomFilterStorage() {
+    static BloomFilterFile bloom = readBloomFilterFile();
+    return bloom;
+}
+
+const BloomFilterFile& loadedBloomFilters() {
+    return bloomFilterStorage();
+}
+
+// Re-read the file after it changed; only safe while no other thread uses it
+void reloadChangedPathFilters() {
+    bloomFilterStorage() = readBloomFilterFile();
+}
+
+// Find a commit's filter; false if the commit has none
+bool findChangedPathFilter(const string& commitHash, string_view& filter) {
+    const BloomFilterFile& bloom = loadedBloomFilters();
+    ObjectId id;
+    if (bloom.count == 0 || !hexToObjectId(commitHash, id)) return false;
+
+    uint32_t lo = 0, hi = bloom.count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = memcmp(bloom.ids + size_t(mid) * SHA_DIGEST_LENGTH, id.bytes.data(), SHA_DIGEST_LENGTH);
+        if (cmp == 0) {
+            uint32_t start = mid == 0 ? 0 : readBE32(bloom.ends + 4 * (mid - 1));
+            uint32_t end = readBE32(bloom.ends + 4 * mid);
+            filter = string_view(reinterpret_cast<const char*>(bloom.filters) + start, end - start);
+            return true;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return false;
+}
+
+BloomResult queryChangedPathFilter(const string& commitHash, const string& path) {
+    string_view filter;
+    if (!findChangedPathFilter(commitHash, filter)) {
+        return BLOOM_NO_FILTER;
+    }
+    if (filter.empty()) {
+        return BLOOM_DEFINITELY_NOT;
+    }
+    if (filter.size() == 1 && static_cast<unsigned char>(filter[0]) == 0xFF) {
+        return BLOOM_MAYBE;
+    }
+
+    for (uint32_t bit : bloomBitPositions(normalizeRepoPath(path), filter.size() * 8)) {
+        if (!(static_cast<unsigned char>(filter[bit / 8]) & (1 << (bit % 8)))) {
+            return BLOOM_DEFINITELY_NOT;
+        }
+    }
+    return BLOOM_MAYBE;
+}
+
+// True if the commit changed the path or anything below it
+bool commitTouchesPath(const CommitSummary& commit, const string& path) {
+    string normalized = normalizeRepoPath(path);
+    if (normalized.empty()) {
+        return !changedPathsForCommit(commit).empty();
+    }
+    if (queryChangedPathFilter(commit.commitHash, normalized) == BLOOM_DEFINITELY_NOT) {
+        return false;
+    }
+    // Directory prefixes are part of the changed set, so an exact match suffices
+    return changedPathsForCommit(commit).count(normalized) > 0;
+}
+
+// Write filters for every commit in the graph. Filters already on disk are
+// reused; new ones are computed in parallel on the shared pool.
+bool writeChangedPathFilters(const map<string, CommitSummary>& commits, bool verbose) {
+    vector<const CommitSummary*> ordered;
+    for (const auto& entry : commits) ordered.push_back(&entry.second);
+
+    vector<string> filters(ordered.size());
+    vector<size_t> missing;
+    for (size_t i = 0; i < ordered.size(); i++) {
+        string_view existing;
+        if (findChangedPathFilter(ordered[i]->commitHash, existing)) {
+            filters[i] = string(existing);
+        } else {
+            missing.push_back(i);
+        }
+    }
+
+    {
+        TaskGroup group(sharedThreadPool());
+        for (size_t i : missing) {
+            group.run([&filters, &ordered, i]() {
+                filters[i] = buildChangedPathFilter(changedPathsForCommit(*ordered[i]));
+            });
+        }
+        group.wait();
+    }
+
+    string out(BLOOM_MAGIC, 4);
+    appendBE32(out, BLOOM_VERSION);
+    appendBE32(out, static_cast<uint32_t>(ordered.size()));
+    appendBE32(out, BLOOM_HASH_COUNT);
+    appendBE32(out, BLOOM_BITS_PER_ENTRY);
+
+    for (const CommitSummary* commit : ordered) {
+        ObjectId id;
+        hexToObjectId(commit->commitHash, id);
+        out.append(reinterpret_cast<const char*>(id.bytes.data()), SHA_DIGEST_LENGTH);
+    }
+    uint32_t end = 0;
+    for (const string& filter : filters) {
+        end += static_cast<uint32_t>(filter.size());
+        appendBE32(out, end);
+    }
+    for (const string& filter : filters) {
+        out += filter;
+    }
+
+    unsigned char checksum[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(out.data()), out.size(), checksum);
+    out.append(reinterpret_cast<const char*>(checksum), SHA_DIGEST_LENGTH);
+
+    string tempPath = bloomFilterPath() + ".tmp" + to_string(getpid());
+    ofstream bloomFile(tempPath, ios::binary | ios::trunc);
+    if (!bloomFile) {
+        cerr << "Error: Cannot write changed-path filters\n";
+        return false;
+    }
+    bloomFile.write(out.data(), out.size());
+    bloomFile.close();
+    fs::rename(tempPath, bloomFilterPath());
+
+    if (verbose) {
+        cout << "Changed-path filters: " << ordered.size() << " commits ("
+             << missing.size() << " computed)\n";
+    }
+    return true;
+}
@@ -4,46 +4,51 @@
 #include <string>
 #include <vector>
 #include <filesystem>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
 #include <zlib.h>
 #include "header.h"
 
 using namespace std;
 namespace fs = filesystem;
 
-// Print file content (-p flag)
+// Print file content (-p flag); content streams from the inflater to
+// stdout, so memory use does not grow with the object
 void printFileContent(const string& hash) {
-    string objectContent = readObjectFile(hash);
-    if (objectContent.empty()) return;
-
-    auto [type, size, content] = parseObject(objectContent);
-    
-    if (type == "blob") {
-        cout << content;
-    } else if (type == "tree") {
-        // For tree objects, we need to parse the binary format
-        cout << "Tree object with " << content.size() << " bytes of data" << endl;
-        // You might want to implement a more detailed tree parsing here
-    } else {
-        cout << content;
-    }
+    OutputBuffer& out = standardOutput();
+    bool isTree = false;
+    streamObject(
+        hash,
+        [&](const string& type, size_t size) {
+            if (type == "tree") {
+                // For tree objects, we need to parse the binary format
+                out << "Tree object with " << size << " bytes of data\n";
+                isTree = true;
+            }
+            return true;
+        },
+        [&](const char* data, size_t length) {
+            if (!isTree) out.write(data, length);
+            return !isTree;
+        });
 }
 
 // Print file size (-s flag)
 void printFileSize(const string& hash) {
-    string objectContent = readObjectFile(hash);
-    if (objectContent.empty()) return;
-
-    auto [type, size, content] = parseObject(objectContent);
-    cout << size << endl;
+    string type;
+    size_t size;
+    if (!readObjectHeader(hash, type, size)) return;
+    standardOutput() << size << "\n";
 }
 
 // Print file type (-t flag)
 void printFileType(const string& hash) {
-    string objectContent = readObjectFile(hash);
-    if (objectContent.empty()) return;
-
-    auto [type, size, content] = parseObject(objectContent);
-    cout << type << endl;
+    string type;
+    size_t size;
+    if (!readObjectHeader(hash, type, size)) return;
+    standardOutput() << type << "\n";
 }
 
 // Main cat-file function that handles different flags
@@ -61,26 +66,164 @@ void catFile(const string& flag, const string& hash) {
 
 // Alternative function signature for backward compatibility
 bool catFile(const string& hash, bool printContent, bool displaySize, bool displayType) {
-    string objectContent = readObjectFile(hash);
-    if (objectContent.empty()) return false;
+    OutputBuffer& out = standardOutput();
+    auto printHeader = [&](const string& type, size_t size) {
+        if (displayType) {
+            out << "Type: " << type << "\n";
+        }
+        if (displaySize) {
+            out << "Size: " << size << " bytes\n";
+        }
+        return true;
+    };
 
-    auto [type, size, content] = parseObject(objectContent);
+    // Type and size alone only need the object header
+    if (!printContent) {
+        string type;
+        size_t size;
+        if (!readObjectHeader(hash, type, size)) return false;
+        return printHeader(type, size);
+    }
 
-    if (displayType) {
-        cout << "Type: " << type << endl;
+    // Content streams from the inflater to stdout in blocks
+    return streamObject(hash, printHeader, [&out](const char* data, size_t length) {
+        out.write(data, length);
+        return true;
+    });
+}
+// Lines from stdin, read with read(2). Buffered output is flushed before
+// every read that could block, so a client that waits for each answer
+// before sending the next id still gets it.
+struct BatchInput {
+    vector<char> buffer = vector<char>(1 << 16);
+    size_t start = 0, end = 0;
+    bool eof = false;
+
+    bool nextLine(string& line) {
+        line.clear();
+        while (true) {
+            const char* data = buffer.data() + start;
+            const void* newline = memchr(data, '\n', end - start);
+            if (newline) {
+                size_t length = static_cast<const char*>(newline) - data;
+                line.append(data, length);
+                start += length + 1;
+                return true;
+            }
+            line.append(data, end - start);
+            start = end = 0;
+            if (eof) return !line.empty();
+
+            standardOutput().flush();
+            ssize_t bytesRead = read(STDIN_FILENO, buffer.data(), buffer.size());
+            if (bytesRead < 0 && errno == EINTR) continue;
+            if (bytesRead <= 0) eof = true;
+            else end = static_cast<size_t>(bytesRead);
+        }
     }
+};
 
-    if (displaySize) {
-        cout << "Size: " << size << " bytes" << endl;
+// One --batch / --batch-check answer; false if the object store is corrupt
+bool printBatchObject(OutputBuffer& out, const string& name, bool withContent) {
+    if (!isValidSHA1(name)) {
+        out << name << " missing\n";
+        return true;
     }
 
-    if (printContent) {
-        if (type == "blob") {
-            cout << content;
+    if (!withContent) {
+        string type;
+        size_t size;
+        if (readObjectHeader(name, type, size)) {
+            out << name << " " << type << " " << size << "\n";
         } else {
-            cout << content;
+            out << name << " missing\n";
+        }
+        return true;
+    }
+
+    // Content goes straight from the inflater to the output buffer
+    bool headerPrinted = false;
+    bool ok = streamObject(
+        name,
+        [&](const string& type, size_t size) {
+            out << name << " " << type << " " << size << "\n";
+            headerPrinted = true;
+            return true;
+        },
+        [&](const char* data, size_t length) {
+            out.write(data, length);
+            return true;
+        });
+    if (ok) {
+        out << "\n";
+        return true;
+    }
+    if (!headerPrinted) {
+        out << name << " missing\n";
+        return true;
+    }
+    cerr << "Error: Object " << name << " is corrupt\n";
+    return false;
+}
+
+// Every loose object id, sorted
+vector<string> listAllObjects() {
+    vector<string> ids;
+    error_code ec;
+    for (const auto& dir : fs::directory_iterator(".mygit/objects", ec)) {
+        string prefix = dir.path().filename().string();
+        if (prefix.size() != 2 || !dir.is_directory(ec)) continue;
+        for (const auto& file : fs::directory_iterator(dir.path(), ec)) {
+            string id = prefix + file.path().filename().string();
+            if (isValidSHA1(id)) ids.push_back(id);
         }
     }
+    sort(ids.begin(), ids.end());
+    return ids;
+}
+
+// mygit cat-file --batch | --batch-check [--batch-all-objects]
+//
+// Reads object ids from stdin, one per line, and answers each with
+// "<sha> <type> <size>" (plus the content and a newline for --batch), or
+// "<sha> missing". The process stays up for the whole stream and reuses
+// one inflate context, so callers pay for process startup once.
+bool handleCatFileBatch(int argc, char* argv[]) {
+    if (!fs::exists(".mygit")) {
+        cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
+        return false;
+    }
 
+    bool withContent = false, checkOnly = false, allObjects = false;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--batch") withContent = true;
+        else if (arg == "--batch-check") checkOnly = true;
+        else if (arg == "--batch-all-objects") allObjects = true;
+        else {
+            cerr << "Usage: mygit cat-file (--batch | --batch-check) [--batch-all-objects]\n";
+            return false;
+        }
+    }
+    if (withContent == checkOnly) {
+        cerr << "Error: Use exactly one of --batch and --batch-check\n";
+        return false;
+    }
+
+    TraceSpan span("catFileBatch");
+    OutputBuffer& out = standardOutput();
+    if (allObjects) {
+        for (const string& id : listAllObjects()) {
+            if (!printBatchObject(out, id, withContent)) return false;
+        }
+        return true;
+    }
+
+    BatchInput input;
+    string line;
+    while (input.nextLine(line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        if (!printBatchObject(out, line, withContent)) return false;
+    }
     return true;
-}
\ No newline at end of file
+}
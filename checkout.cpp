@@ -7,87 +7,388 @@
 #include <iomanip>
 #include <zlib.h>
 #include <cstring>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
 #include "header.h"
 
 namespace fs = std::filesystem;
 using namespace std;
 
-// Clear working directory (except .mygit)
-void clearWorkingDirectory() {
-    try {
-        for (const auto& entry : fs::directory_iterator(".")) {
-            if (entry.path().filename() == ".mygit") continue;
-            
-            if (fs::is_directory(entry)) {
-                fs::remove_all(entry);
-            } else {
-                fs::remove(entry);
-            }
+// Files written per pool task during checkout
+const size_t CHECKOUT_BATCH_SIZE = 32;
+
+// Checkouts smaller than this don't print progress
+const size_t CHECKOUT_PROGRESS_MIN_FILES = 1000;
+
+// A working file to materialize from a blob
+struct CheckoutWrite {
+    string path;
+    string blobSHA;
+};
+
+// Old and new blob id of a path that differs between two trees
+// (empty when the path is absent on that side)
+struct CheckoutChange {
+    string oldId;
+    string newId;
+};
+
+// Paths inside .mygit that 'add .' may have recorded are never checked out
+bool isRepositoryPath(const string& path) {
+    return path == ".mygit" || path.rfind(".mygit/", 0) == 0;
+}
+
+// Collect blob-level differences between two trees, skipping subtrees whose
+// ids match and directories outside the sparse checkout. Entries of older
+// flat trees ("./d/f.txt") are plain paths.
+void collectCheckoutChanges(TreeArena& arena, const ObjectId* oldTree, const ObjectId* newTree, const string& prefix,
+                            const SparseCheckout& sparse, map<string, CheckoutChange>& changes) {
+    if (oldTree && newTree && *oldTree == *newTree) return;
+
+    map<string_view, const TreeEntry*> oldEntries, newEntries;
+    if (oldTree) {
+        for (const auto& entry : readTreeEntries(arena, *oldTree)) oldEntries[entry.name] = &entry;
+    }
+    if (newTree) {
+        for (const auto& entry : readTreeEntries(arena, *newTree)) newEntries[entry.name] = &entry;
+    }
+
+    auto visit = [&](string_view name, const TreeEntry* oldEntry, const TreeEntry* newEntry) {
+        if (oldEntry && newEntry && oldEntry->id == newEntry->id) return;
+        string path = normalizeRepoPath(joinTreePath(prefix, name));
+        if (isRepositoryPath(path)) return;
+
+        const ObjectId* oldSubtree = oldEntry && oldEntry->isTree() ? &oldEntry->id : nullptr;
+        const ObjectId* newSubtree = newEntry && newEntry->isTree() ? &newEntry->id : nullptr;
+        if ((oldSubtree || newSubtree) && sparseIncludesDirectory(sparse, path)) {
+            collectCheckoutChanges(arena, oldSubtree, newSubtree, path, sparse, changes);
         }
-    } catch (const fs::filesystem_error& e) {
-        cerr << "Warning: Error clearing working directory: " << e.what() << endl;
+        if (!sparseIncludesPath(sparse, path)) return;
+        if (oldEntry && oldEntry->isBlob()) changes[path].oldId = oldEntry->hex();
+        if (newEntry && newEntry->isBlob()) changes[path].newId = newEntry->hex();
+    };
+
+    for (const auto& pair : oldEntries) {
+        auto match = newEntries.find(pair.first);
+        visit(pair.first, pair.second, match == newEntries.end() ? nullptr : match->second);
+    }
+    for (const auto& pair : newEntries) {
+        if (oldEntries.count(pair.first) == 0) visit(pair.first, nullptr, pair.second);
     }
 }
 
-// Restore tree recursively
-bool restoreTree(const string& treeSHA, const fs::path& currentPath) {
-    vector<TreeEntry> entries = readTreeEntries(treeSHA);
-    if (entries.empty()) {
+void collectCheckoutChanges(const string& oldTreeSHA, const string& newTreeSHA, const string& prefix,
+                            const SparseCheckout& sparse, map<string, CheckoutChange>& changes) {
+    ObjectId oldTree, newTree;
+    bool hasOld = hexToObjectId(oldTreeSHA, oldTree);
+    bool hasNew = hexToObjectId(newTreeSHA, newTree);
+    TreeArena arena;
+    collectCheckoutChanges(arena, hasOld ? &oldTree : nullptr, hasNew ? &newTree : nullptr, prefix, sparse, changes);
+}
+
+// Id of the working file at path ("" if missing), trusting the index's
+// stat data instead of re-hashing when it still matches
+string workingFileId(const string& path, const map<string, IndexEntry>& index, long long indexMtime) {
+    auto entry = index.find(path);
+    if (entry != index.end() && indexStatMatches(entry->second, indexMtime)) {
+        return entry->second.hash;
+    }
+    if (!fs::is_regular_file(path)) return "";
+    return computeWorkingFileHash(path);
+}
+
+// Reserve space for large blobs before writing them ("checkout.preallocate")
+bool checkoutPreallocate() {
+    return cachedConfig().preallocate;
+}
+
+// Stream a blob into path; parent directories must exist. Memory use does
+// not depend on the size of the blob.
+bool writeWorkingFile(const string& path, const string& blobSHA, string& error) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        error = "Cannot create file " + path;
+        return false;
+    }
+    countStat(STAT_FILES_OPENED);
+
+    bool written = writeBlobToFd(blobSHA, fd, checkoutPreallocate(), error);
+    if (close(fd) != 0 && written) {
+        error = "Cannot write blob " + blobSHA;
+        written = false;
+    }
+    if (!written) {
+        error += " for " + path;
         return false;
     }
+    return true;
+}
 
-    for (const auto& entry : entries) {
-        fs::path fullPath = currentPath / entry.name;
+// Create the parent directories of all writes in one pass, before any
+// worker starts, removing files or directories that are in the way
+void prepareDirectories(const vector<CheckoutWrite>& writes) {
+    TraceSpan span("prepareDirectories");
+    set<fs::path> directories;
+    error_code ec;
+    for (const CheckoutWrite& write : writes) {
+        if (fs::is_directory(write.path, ec)) {
+            fs::remove_all(write.path, ec);
+        }
+        fs::path parent = fs::path(write.path).parent_path();
+        if (!parent.empty()) directories.insert(parent);
+    }
 
-        if (entry.type == "blob") {
-            // Read blob content
-            string objectContent = readObjectFile(entry.sha);
-            if (objectContent.empty()) {
-                cerr << "Error: Blob object " << entry.sha << " not found for " << entry.name << "\n";
-                continue;
+    // Sorted order visits "a" before "a/b", so a file named like a parent
+    // directory is removed before its children are created
+    for (const fs::path& dir : directories) {
+        if (fs::is_directory(dir, ec)) continue;
+        for (fs::path part; const auto& component : dir) {
+            part /= component;
+            if (fs::exists(part, ec) && !fs::is_directory(part, ec)) {
+                fs::remove(part, ec);
             }
+        }
+        fs::create_directories(dir, ec);
+    }
+}
 
-            auto [type, size, content] = parseObject(objectContent);
-            if (type != "blob") {
-                cerr << "Error: Expected blob, got " << type << " for " << entry.name << "\n";
-                continue;
+// Inflate and write files on the shared thread pool, CHECKOUT_BATCH_SIZE
+// per task, or clone them from the blob cache when it is enabled. Progress
+// is reported on stderr as one line when it is a terminal.
+bool writeWorkingFiles(const vector<CheckoutWrite>& writes) {
+    TraceSpan span("writeWorkingFiles");
+    atomic<size_t> completed{0};
+    atomic<int> shownPercent{-1};
+    bool showProgress = writes.size() >= CHECKOUT_PROGRESS_MIN_FILES && isatty(STDERR_FILENO);
+
+    bool useBlobCache = blobCacheEnabled();
+    mutex errorsMutex;
+    vector<string> errors;
+
+    TaskGroup group(sharedThreadPool());
+    for (size_t start = 0; start < writes.size(); start += CHECKOUT_BATCH_SIZE) {
+        size_t end = min(start + CHECKOUT_BATCH_SIZE, writes.size());
+        group.run([&, start, end]() {
+            for (size_t i = start; i < end; i++) {
+                string error;
+                bool ok = useBlobCache ? materializeFromBlobCache(writes[i].path, writes[i].blobSHA, error)
+                                       : writeWorkingFile(writes[i].path, writes[i].blobSHA, error);
+                if (!ok) {
+                    lock_guard<mutex> lock(errorsMutex);
+                    errors.push_back(error);
+                }
             }
 
-            // Create parent directories if needed
-            if (fullPath.has_parent_path()) {
-                fs::create_directories(fullPath.parent_path());
+            size_t done = completed.fetch_add(end - start) + (end - start);
+            int percent = static_cast<int>(done * 100 / writes.size());
+            int previous = shownPercent.load();
+            if (showProgress && percent > previous && shownPercent.compare_exchange_strong(previous, percent)) {
+                lock_guard<mutex> lock(errorsMutex);
+                cerr << "\rChecking out files: " << percent << "% (" << done << "/" << writes.size() << ")";
             }
+        });
+    }
+    group.wait();
+    if (useBlobCache) {
+        trimBlobCache();
+    }
+
+    if (showProgress) {
+        cerr << "\rChecking out files: 100% (" << writes.size() << "/" << writes.size() << "), done.\n";
+    }
+    for (const string& error : errors) {
+        cerr << "Error: " << error << "\n";
+    }
+    return errors.empty();
+}
+
+// Remove a file and any parent directories it leaves empty
+void removeWorkingFile(const string& path) {
+    error_code ec;
+    fs::remove(path, ec);
+    for (fs::path dir = fs::path(path).parent_path(); !dir.empty(); dir = dir.parent_path()) {
+        if (!fs::is_empty(dir, ec) || ec) break;
+        fs::remove(dir, ec);
+    }
+}
+
+// Move the working tree and index from one tree to another, touching only
+// the paths that differ. Without discardLocalChanges, local modifications
+// to those paths abort the checkout and all other local changes are kept;
+// with it (reset --hard) every tracked file is made to match the target.
+// Only paths inside the sparse checkout are written; files the patterns no
+// longer include are removed, and ones they newly include are written.
+bool checkoutTree(const string& fromTreeSHA, const string& toTreeSHA, bool discardLocalChanges) {
+    OutputBuffer& out = standardOutput();
+    TraceSpan span("checkoutTree");
+    SparseCheckout sparse = loadSparseCheckout();
+
+    map<string, CheckoutChange> changes;
+    collectCheckoutChanges(fromTreeSHA, toTreeSHA, "", sparse, changes);
+    for (auto it = changes.begin(); it != changes.end();) {
+        it = it->second.oldId == it->second.newId ? changes.erase(it) : next(it);
+    }
 
-            // Write file content
-            ofstream outFile(fullPath, ios::binary);
-            if (!outFile) {
-                cerr << "Error: Cannot create file " << fullPath << "\n";
-                continue;
+    map<string, IndexEntry> index;
+    for (IndexEntry& entry : loadIndex()) {
+        string path = entry.path;
+        index[path] = move(entry);
+    }
+    long long indexMtime = indexFileMtime();
+
+    // Target state: files inside the sparse checkout, plus skip-worktree
+    // entries for the directories and files left out
+    map<string, string> targetFiles, targetModes;
+    vector<IndexEntry> skippedEntries;
+    if (!toTreeSHA.empty()) {
+        collectSparseTree(toTreeSHA, "", sparse, targetFiles, skippedEntries, &targetModes);
+    }
+
+    // Files checked out before that the patterns now exclude. Without an
+    // index, everything in the old tree was checked out.
+    map<string, string> leaving;
+    if (sparse.enabled) {
+        map<string, string> checkedOut;
+        if (index.empty() && !fromTreeSHA.empty()) {
+            collectFilesFromTree(fromTreeSHA, "", checkedOut);
+        }
+        for (const auto& [path, entry] : index) {
+            if (!entry.skipWorktree) checkedOut[path] = entry.hash;
+        }
+        for (const auto& [path, blobSHA] : checkedOut) {
+            if (!isRepositoryPath(path) && !sparseIncludesPath(sparse, path)) leaving[path] = blobSHA;
+        }
+    }
+
+    // Included files with no working copy yet, e.g. after the patterns grew
+    for (const auto& [path, blobSHA] : targetFiles) {
+        if (isRepositoryPath(path) || changes.count(path)) continue;
+        auto existing = index.find(path);
+        if (existing != index.end() && !existing->second.skipWorktree) continue;
+        if (!fs::exists(path)) changes[path] = {"", blobSHA};
+    }
+
+    // Refuse to overwrite work that only exists in the working tree
+    set<string> alreadyCurrent;
+    if (!discardLocalChanges) {
+        vector<string> conflicts;
+        for (const auto& [path, change] : changes) {
+            string current = workingFileId(path, index, indexMtime);
+            if (!current.empty() && current == change.newId) {
+                alreadyCurrent.insert(path);
+            } else if (!current.empty() && current != change.oldId) {
+                conflicts.push_back(path);
             }
-            outFile.write(content.c_str(), content.length());
-            outFile.close();
-            
-            cout << "Restored file: " << fullPath << "\n";
-            
-        } else if (entry.type == "tree") {
-            // Create directory and recursively restore subtree
-            if (!fs::exists(fullPath)) {
-                fs::create_directories(fullPath);
+        }
+        if (!conflicts.empty()) {
+            cerr << "Error: Your local changes to the following files would be overwritten by checkout:\n";
+            for (const string& path : conflicts) {
+                cerr << "  " << path << "\n";
             }
-            cout << "Created directory: " << fullPath << "\n";
-            
-            if (!restoreTree(entry.sha, fullPath)) {
-                cerr << "Error: Failed to restore subtree " << entry.sha << "\n";
-                return false;
+            cerr << "Commit them or use 'mygit reset --hard' to discard them.\n";
+            return false;
+        }
+    }
+
+    size_t updated = 0, removed = 0;
+    set<string> written; // paths whose working file now matches the target
+
+    // Deletions first, so a file can be replaced by a directory of the same name
+    for (const auto& [path, change] : changes) {
+        if (change.newId.empty()) {
+            removeWorkingFile(path);
+            index.erase(path);
+            removed++;
+        }
+    }
+    for (const auto& [path, blobSHA] : leaving) {
+        string current = workingFileId(path, index, indexMtime);
+        if (!discardLocalChanges && !current.empty() && current != blobSHA) {
+            cerr << "Warning: Not removing locally modified '" << path << "' outside the sparse checkout\n";
+            continue;
+        }
+        removeWorkingFile(path);
+        removed++;
+    }
+
+    // Paths to (re)write: everything that changed, plus for reset --hard any
+    // tracked file whose working copy no longer matches the target
+    vector<CheckoutWrite> writes;
+    for (const auto& [path, change] : changes) {
+        if (change.newId.empty()) continue;
+        written.insert(path);
+        if (!alreadyCurrent.count(path)) writes.push_back({path, change.newId});
+    }
+    if (discardLocalChanges) {
+        for (const auto& [path, blobSHA] : targetFiles) {
+            if (isRepositoryPath(path) || written.count(path)) continue;
+            if (workingFileId(path, index, indexMtime) != blobSHA) {
+                writes.push_back({path, blobSHA});
             }
+            written.insert(path);
         }
     }
-    
+
+    prepareDirectories(writes);
+    if (!writeWorkingFiles(writes)) return false;
+    updated = writes.size();
+
+    // The new index mirrors the target tree; stat data is recorded for
+    // every file known to match, and kept for entries checkout didn't touch
+    vector<IndexEntry> newIndex;
+    newIndex.reserve(targetFiles.size() + skippedEntries.size());
+    for (const auto& [path, blobSHA] : targetFiles) {
+        if (isRepositoryPath(path)) continue;
+        IndexEntry entry;
+        entry.mode = targetModes[path];
+        entry.hash = blobSHA;
+        entry.path = path;
+
+        auto existing = index.find(path);
+        if (written.count(path)) {
+            fillIndexStat(entry);
+        } else if (existing != index.end() && !existing->second.skipWorktree) {
+            // Keep what is staged for paths the checkout did not touch
+            entry = existing->second;
+            if (entry.hash == blobSHA) entry.mode = targetModes[path];
+        }
+        newIndex.push_back(move(entry));
+    }
+    newIndex.insert(newIndex.end(), skippedEntries.begin(), skippedEntries.end());
+
+    // Staged files the target tree doesn't know about stay staged on
+    // checkout; reset --hard removes them like any other tracked change
+    for (const auto& [path, entry] : index) {
+        if (entry.skipWorktree || !sparseIncludesPath(sparse, path) ||
+            targetFiles.count(path) || changes.count(path)) {
+            continue;
+        }
+        if (discardLocalChanges) {
+            removeWorkingFile(path);
+            removed++;
+        } else {
+            newIndex.push_back(entry);
+        }
+    }
+    sort(newIndex.begin(), newIndex.end(),
+         [](const IndexEntry& a, const IndexEntry& b) { return a.path < b.path; });
+
+    if (!storeIndex(newIndex)) return false;
+
+    out << "Updated " << updated << " file" << (updated == 1 ? "" : "s")
+         << ", removed " << removed << " file" << (removed == 1 ? "" : "s") << "\n";
     return true;
 }
 
-// Main checkout function
-bool checkout(const string& commitSHA) {
+// Main checkout function. With branchRef HEAD ends up on that branch,
+// otherwise it is detached at the commit.
+bool checkout(const string& commitSHA, const string& branchRef) {
+    OutputBuffer& out = standardOutput();
     // Check if repository exists
     if (!fs::exists(".mygit")) {
         cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
@@ -113,34 +414,69 @@ bool checkout(const string& commitSHA) {
         return false;
     }
 
-    cout << "Checking out commit " << commitSHA << "\n";
-    cout << "Tree SHA: " << treeSHA << "\n";
-
-    // Clear current working directory (except .mygit)
-    cout << "Clearing working directory...\n";
-    clearWorkingDirectory();
+    out << "Checking out commit " << commitSHA << "\n";
+    out << "Tree SHA: " << treeSHA << "\n";
 
-    // Restore files from tree object
-    cout << "Restoring files from tree...\n";
-    if (!restoreTree(treeSHA,".")) {
-        cerr << "Error: Failed to restore tree\n";
+    // Only paths that differ from the current HEAD tree are rewritten
+    string currentCommit = getCurrentCommit();
+    string currentTree = currentCommit.empty() ? "" : getTreeSHAFromCommit(currentCommit);
+    if (!checkoutTree(currentTree, treeSHA, false)) {
+        cerr << "Error: Failed to check out tree\n";
         return false;
     }
 
     // Update HEAD to point to the checked out commit
-    writeHEAD(commitSHA);
+    string error;
+    if (!(branchRef.empty() ? detachHEAD(commitSHA, error) : setSymbolicHEAD(branchRef, error))) {
+        cerr << "Error: " << error << "\n";
+        return false;
+    }
 
-    cout << "Successfully checked out commit " << commitSHA << "\n";
+    out << "Successfully checked out commit " << commitSHA << "\n";
+    if (!branchRef.empty()) out << "Switched to branch '" << branchRef.substr(11) << "'\n";
     return true;
 }
 
 // Command handler for main.cpp integration
+// checkout <branch> switches to a branch, checkout -b <new-branch> [<commit>]
+// creates one first, and any other commit or tag detaches HEAD
 bool handleCheckout(int argc, char* argv[]) {
-    if (argc < 3) {
-        cerr << "Usage: mygit checkout <commit-sha>\n";
+    const char* usage = "Usage: mygit checkout [-b <new-branch>] <branch | commit-sha>\n";
+    bool createBranch = argc >= 4 && string(argv[2]) == "-b";
+    if (argc < 3 || argc > (createBranch ? 5 : 3)) {
+        cerr << usage;
+        return false;
+    }
+
+    if (createBranch) {
+        string branchRef = string("refs/heads/") + argv[3];
+        string start = argc == 5 ? argv[4] : "HEAD";
+        string commitSHA = resolveRevision(start);
+        if (commitSHA.empty()) {
+            cerr << "Error: Not a valid commit: " << start << "\n";
+            return false;
+        }
+        string error;
+        if (!isValidRefName(branchRef) || !updateRef(branchRef, commitSHA, string(40, '0'), error)) {
+            cerr << "Error: " << (error.empty() ? "Invalid branch name '" + string(argv[3]) + "'" : error) << "\n";
+            return false;
+        }
+        if (checkout(commitSHA, branchRef)) return true;
+        // The branch was created for this checkout only
+        if (!deleteRef(branchRef, error)) cerr << "Error: " << error << "\n";
+        return false;
+    }
+
+    string target = argv[2];
+    string branchRef = "refs/heads/" + target;
+    string commitSHA;
+    if (isValidRefName(branchRef) && readRef(branchRef, commitSHA)) {
+        return checkout(commitSHA, branchRef);
+    }
+    commitSHA = resolveRevision(target);
+    if (commitSHA.empty()) {
+        cerr << "Error: Unknown branch or commit '" << target << "'\n";
         return false;
     }
-    
-    string commitSHA = argv[2];
     return checkout(commitSHA);
 }
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include "header.h"
+
+using namespace std;
+
+// Chunked blobs: files larger than the configured threshold are split with a
+// content-defined (FastCDC-style) chunker. Each chunk is stored as an ordinary
+// blob, and the file itself is a small "chunked" manifest object listing
+// "<chunk-sha> <length>" per line. Unchanged regions of a slowly changing file
+// produce the same chunks, so a new snapshot only stores the changed bytes.
+
+// Chunk size bounds (bytes)
+const size_t CHUNK_MIN_SIZE = 16 * 1024;
+const size_t CHUNK_AVG_SIZE = 64 * 1024;
+const size_t CHUNK_MAX_SIZE = 256 * 1024;
+
+// Normalized chunking: a stricter mask before the average size and a looser
+// one after it keeps chunk sizes close to the average
+const uint64_t CHUNK_MASK_STRICT = ~0ULL << (64 - 18);
+const uint64_t CHUNK_MASK_LOOSE = ~0ULL << (64 - 14);
+
+// Gear table of 256 pseudo-random values; fixed seed so ids are stable
+const vector<uint64_t>& gearTable() {
+    static const vector<uint64_t> table = []() {
+        vector<uint64_t> values(256);
+        uint64_t state = 0x6d7967697463646cULL;
+        for (auto& value : values) {
+            // splitmix64
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            value = z ^ (z >> 31);
+        }
+        return values;
+    }();
+    return table;
+}
+
+// Length of the next chunk starting at data[0..length)
+size_t nextChunkLength(const unsigned char* data, size_t length) {
+    if (length <= CHUNK_MIN_SIZE) return length;
+    if (length > CHUNK_MAX_SIZE) length = CHUNK_MAX_SIZE;
+
+    const vector<uint64_t>& gear = gearTable();
+    size_t normalSize = min(CHUNK_AVG_SIZE, length);
+    uint64_t fingerprint = 0;
+    size_t i = CHUNK_MIN_SIZE;
+
+    for (; i < normalSize; i++) {
+        fingerprint = (fingerprint << 1) + gear[data[i]];
+        if (!(fingerprint & CHUNK_MASK_STRICT)) return i + 1;
+    }
+    for (; i < length; i++) {
+        fingerprint = (fingerprint << 1) + gear[data[i]];
+        if (!(fingerprint & CHUNK_MASK_LOOSE)) return i + 1;
+    }
+    return length;
+}
+
+// Split content into (offset, length) chunks
+vector<pair<size_t, size_t>> splitIntoChunks(const string& content) {
+    vector<pair<size_t, size_t>> chunks;
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(content.data());
+    size_t offset = 0;
+    while (offset < content.size()) {
+        size_t length = nextChunkLength(data + offset, content.size() - offset);
+        chunks.push_back({offset, length});
+        offset += length;
+    }
+    return chunks;
+}
+
+// Size above which blobs are chunked, from "chunking.threshold" (0 = disabled)
+size_t chunkingThreshold() {
+    return cachedConfig().chunkingThreshold;
+}
+
+bool shouldChunkBlob(size_t contentSize) {
+    size_t threshold = chunkingThreshold();
+    return threshold > 0 && contentSize > threshold;
+}
+
+// Store content as chunk blobs plus a manifest, returns the manifest hash,
+// or "" when an object could not be written. With writeFlag false only the
+// id is computed.
+string storeChunkedBlob(const string& content, bool writeFlag) {
+    vector<pair<size_t, size_t>> chunks = splitIntoChunks(content);
+    vector<string> chunkHashes(chunks.size());
+    vector<string> chunkErrors(chunks.size());
+
+    {
+        // Hash and compress chunks in parallel
+        TaskGroup group(sharedThreadPool());
+        for (size_t i = 0; i < chunks.size(); i++) {
+            group.run([&content, &chunks, &chunkHashes, &chunkErrors, i, writeFlag]() {
+                auto [offset, length] = chunks[i];
+                string blobData = "blob " + to_string(length) + '\0' + content.substr(offset, length);
+                chunkHashes[i] = computeSHA1FromString(blobData);
+                if (writeFlag && !storeObject(".mygit", chunkHashes[i], blobData, chunkErrors[i])) {
+                    chunkHashes[i].clear();
+                }
+            });
+        }
+        if (!group.wait()) return "";
+    }
+    for (size_t i = 0; i < chunks.size(); i++) {
+        if (chunkHashes[i].empty()) {
+            cerr << "Error: " << chunkErrors[i] << "\n";
+            return "";
+        }
+    }
+
+    string manifest;
+    for (size_t i = 0; i < chunks.size(); i++) {
+        manifest += chunkHashes[i] + " " + to_string(chunks[i].second) + "\n";
+    }
+
+    string manifestObject = "chunked " + to_string(manifest.size()) + '\0' + manifest;
+    string manifestHash = computeSHA1FromString(manifestObject);
+    string error;
+    if (writeFlag && !storeObject(".mygit", manifestHash, manifestObject, error)) {
+        cerr << "Error: " << error << "\n";
+        return "";
+    }
+    return manifestHash;
+}
+
+// Object id for file content: a chunked manifest for large files when
+// chunking is enabled, otherwise the plain blob hash
+string computeBlobHash(const string& content) {
+    if (shouldChunkBlob(content.size())) {
+        return storeChunkedBlob(content, false);
+    }
+    string blobContent = "blob " + to_string(content.size()) + '\0' + content;
+    return computeSHA1FromString(blobContent);
+}
+
+// Size of the blob a manifest describes, without reading any chunk
+size_t chunkedBlobSize(string_view manifest) {
+    size_t totalSize = 0;
+    size_t lineStart = 0;
+    while (lineStart < manifest.size()) {
+        size_t lineEnd = manifest.find('\n', lineStart);
+        if (lineEnd == string_view::npos) lineEnd = manifest.size();
+        size_t space = manifest.find(' ', lineStart);
+        if (space != string_view::npos && space < lineEnd) {
+            totalSize += strtoull(string(manifest.substr(space + 1, lineEnd - space - 1)).c_str(), nullptr, 10);
+        }
+        lineStart = lineEnd + 1;
+    }
+    return totalSize;
+}
+
+// Rebuild the full blob object ("blob <size>\0<content>") from a manifest
+string reassembleChunkedBlob(const string& manifest, const string& gitDir) {
+    vector<pair<string, size_t>> chunks;
+    size_t totalSize = 0;
+
+    istringstream manifestStream(manifest);
+    string chunkHash;
+    size_t chunkLength;
+    while (manifestStream >> chunkHash >> chunkLength) {
+        chunks.push_back({chunkHash, chunkLength});
+        totalSize += chunkLength;
+    }
+
+    string header = "blob " + to_string(totalSize);
+    string result;
+    result.reserve(header.size() + 1 + totalSize);
+    result += header;
+    result += '\0';
+
+    for (const auto& [hash, length] : chunks) {
+        size_t start = result.size();
+        bool ok = streamObject(
+            hash, [length = length](const string& type, size_t size) { return type == "blob" && size == length; },
+            [&result](const char* data, size_t dataLength) {
+                result.append(data, dataLength);
+                return true;
+            },
+            gitDir);
+        if (!ok || result.size() - start != length) {
+            cerr << "Error: Chunk " << hash << " is missing or corrupt\n";
+            return "";
+        }
+    }
+    return result;
+}
@@ -11,6 +11,8 @@
 #include <zlib.h>
 #include "header.h"
 #include <algorithm>
+#include <thread>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 using namespace std;
@@ -25,15 +27,6 @@ string getCurrentTimestamp() {
     return ss.str();
 }
 
-// Function to update the branch reference
-void updateRef(const string& commitHash) {
-    fs::create_directories(".mygit/refs/heads");
-    ofstream branchFile(".mygit/refs/heads/master");
-    if (branchFile) {
-        branchFile << commitHash;
-    }
-}
-
 // Function to write to log file (NEW FUNCTION)
 void writeToLog(const string& oldHash, const string& newHash, const string& message) {
     // Create logs directory if it doesn't exist
@@ -74,31 +67,63 @@ string compressData(const string& data) {
         return "";
     }
     
+    countStat(STAT_BYTES_DEFLATED, data.length());
     return string(reinterpret_cast<char*>(compressedData.data()), compressedSize);
 }
 
-// Function to write compressed object to store
-void writeCompressedObject(const string& hash, const string& content) {
-    string objectDir = ".mygit/objects/" + hash.substr(0, 2);
+// Write a compressed object under gitDir/objects; error is set on failure
+bool storeObject(const string& gitDir, const string& hash, const string& content, string& error) {
+    string objectDir = gitDir + "/objects/" + hash.substr(0, 2);
     string objectPath = objectDir + "/" + hash.substr(2); // No .gz extension
     
-    fs::create_directories(objectDir);
+    // Objects are content-addressed, so an existing file already holds this content
+    countStat(STAT_FILES_STATED);
+    error_code ec;
+    if (fs::exists(objectPath, ec)) {
+        countStat(STAT_OBJECTS_SKIPPED);
+        return true;
+    }
+    
+    fs::create_directories(objectDir, ec);
     
     // Compress the content
     string compressedData = compressData(content);
     if (compressedData.empty()) {
-        cerr << "Error: Failed to compress object\n";
-        return;
+        error = "Failed to compress object";
+        return false;
     }
     
-    ofstream objectFile(objectPath, ios::binary);
+    // Write to a temporary file and rename it into place, so that concurrent
+    // writers of the same object never see a partially written file
+    ostringstream tempName;
+    tempName << objectPath << ".tmp" << getpid() << "_" << this_thread::get_id();
+    string tempPath = tempName.str();
+    
+    ofstream objectFile(tempPath, ios::binary);
     if (!objectFile) {
-        cerr << "Error: Could not write to object store\n";
-        return;
+        error = "Could not write to object store";
+        return false;
     }
     
     objectFile.write(compressedData.c_str(), compressedData.size());
     objectFile.close();
+    
+    fs::rename(tempPath, objectPath, ec);
+    if (ec) {
+        fs::remove(tempPath, ec);
+        error = "Could not write to object store";
+        return false;
+    }
+    countStat(STAT_OBJECTS_WRITTEN);
+    return true;
+}
+
+// Store an object in the current repository, reporting failures on stderr
+void writeCompressedObject(const string& hash, const string& content) {
+    string error;
+    if (!storeObject(".mygit", hash, content, error)) {
+        cerr << "Error: " << error << "\n";
+    }
 }
 
 // Function to create a tree from the current directory (like write-tree)
@@ -108,78 +133,66 @@ string createTreeFromWorkingDirectory() {
 }
 
 // Alternative: Create tree from index (if you want to use staging area)
-string createTreeFromIndex() {
-    ifstream indexFile(".mygit/index");
-    if (!indexFile) {
-        cerr << "Error: No staged files. Use 'mygit add' first.\n";
-        return "";
-    }
+// Write the tree object for one directory of staged files, subtrees first.
+// Paths are relative to the directory; returns the tree's hash.
+string writeIndexTree(const vector<const IndexEntry*>& entries, size_t prefixLength) {
+    map<string, string> treeEntries; // name -> "mode name\0<binary sha>"
+    map<string, vector<const IndexEntry*>> subdirectories;
 
-    vector<tuple<string, string, string>> entries; // mode, hash, path
-    string line;
-    
-    // Parse index entries
-    while (getline(indexFile, line)) {
-        if (line.empty()) continue;
-        
-        istringstream iss(line);
-        string mode, type, hash, path;
-        
-        // Parse your index format: "100644 hash path" or "100644 Blob hash path"
-        if (line.find(" Blob ") != string::npos) {
-            // Format: "100644 Blob hash path"
-            iss >> mode >> type >> hash;
-            getline(iss, path);
-            path = path.substr(1); // Remove leading space
+    for (const IndexEntry* entry : entries) {
+        string relative = entry->path.substr(prefixLength);
+        size_t slash = relative.find('/');
+        if (slash == string::npos) {
+            ObjectId id;
+            hexToObjectId(entry->hash, id);
+            treeEntries[relative] = entry->mode + " " + relative + '\0' +
+                                    string(reinterpret_cast<const char*>(id.bytes.data()), id.bytes.size());
         } else {
-            // Format: "100644 hash path"
-            iss >> mode >> hash;
-            getline(iss, path);
-            path = path.substr(1); // Remove leading space
+            subdirectories[relative.substr(0, slash)].push_back(entry);
         }
-        
-        entries.push_back({mode, hash, path});
     }
 
-    if (entries.empty()) {
-        cerr << "Error: Nothing to commit (empty index)\n";
-        return "";
+    for (const auto& [name, children] : subdirectories) {
+        string subtreeHash = writeIndexTree(children, prefixLength + name.size() + 1);
+        ObjectId id;
+        hexToObjectId(subtreeHash, id);
+        treeEntries[name] = "40000 " + name + '\0' +
+                            string(reinterpret_cast<const char*>(id.bytes.data()), id.bytes.size());
     }
 
-    // Sort entries by path
-    sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
-        return get<2>(a) < get<2>(b);
-    });
-
-    // Build tree content in Git format
+    // Git tree entry format: [mode] [filename]\0[20-byte binary SHA], sorted by name
     string treeContent;
-    for (const auto& entry : entries) {
-        string mode = get<0>(entry);
-        string hash = get<1>(entry);
-        string path = get<2>(entry);
-        
-        // Git tree entry format: [mode] [filename]\0[20-byte binary SHA]
-        treeContent += mode + " " + path + '\0';
-        
-        // Convert hex hash to binary
-        for (size_t i = 0; i < hash.length(); i += 2) {
-            string byteStr = hash.substr(i, 2);
-            char byte = static_cast<char>(stoi(byteStr, nullptr, 16));
-            treeContent += byte;
-        }
+    for (const auto& pair : treeEntries) {
+        treeContent += pair.second;
     }
 
-    // Create tree object with header
-    string header = "tree " + to_string(treeContent.length());
-    string completeTree = header + '\0' + treeContent;
-    
-    // Calculate hash and store
+    string completeTree = "tree " + to_string(treeContent.length()) + '\0' + treeContent;
     string treeHash = computeSHA1FromString(completeTree);
     writeCompressedObject(treeHash, completeTree);
-    
     return treeHash;
 }
 
+string createTreeFromIndex() {
+    TraceSpan span("createTreeFromIndex");
+    if (!fs::exists(".mygit/index")) {
+        cerr << "Error: No staged files. Use 'mygit add' first.\n";
+        return "";
+    }
+
+    vector<IndexEntry> entries = loadIndex();
+    if (entries.empty()) {
+        cerr << "Error: Nothing to commit (empty index)\n";
+        return "";
+    }
+
+    // Directories become nested tree objects, as write-tree produces
+    vector<const IndexEntry*> entryPointers;
+    for (const IndexEntry& entry : entries) {
+        entryPointers.push_back(&entry);
+    }
+    return writeIndexTree(entryPointers, 0);
+}
+
 // Function to create a commit
 string createCommit(const string& message, const string& treeHash, const string& parentHash) {
     string authorInfo = "Author <author@example.com>";
@@ -212,6 +225,7 @@ string createCommit(const string& message, const string& treeHash, const string&
 
 // Function to clear the index after commit
 bool clearIndex() {
+    TraceSpan span("clearIndex");
     ofstream indexFile(".mygit/index", ios::trunc);
     if (!indexFile) {
         cerr << "Error: Cannot clear index file\n";
@@ -267,12 +281,14 @@ int handleCommit(int argc, char* argv[]) {
     // Write to log file BEFORE updating HEAD (NEW)
     writeToLog(parentHash, commitHash, message);
 
-    // Update HEAD and refs
-    writeHEAD(commitHash);
-    updateRef(commitHash);
+    // Move the current branch (or a detached HEAD); fails if another
+    // process moved it since parentHash was read
+    if (!writeHEAD(commitHash, parentHash)) {
+        return 1;
+    }
     
-    // Clear the index after successful commit
-    clearIndex();
+    // The index is kept: it now matches the commit, and its stat data and
+    // skip-worktree entries are still valid
     
     // Display commit information (Git-like output)
     cout << commitHash << endl;
@@ -0,0 +1,403 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <map>
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+#include <openssl/sha.h>
+#include "header.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+// Commit-graph file (.mygit/objects/info/commit-graph)
+//
+//   header   "MGCG" | version (u32) | commit count N (u32)
+//   fanout   256 x u32: number of commits whose first id byte is <= i
+//   ids      N x 20-byte commit ids, sorted
+//   records  N x 40 bytes: tree id (20) | parent 1 position (u32) |
+//            parent 2 position (u32) | generation (u32) | commit time (u64)
+//   trailer  SHA-1 of everything above
+//
+// All integers are big-endian. Positions index into the sorted id table.
+// A commit with more than two parents, or with a parent that is not in the
+// graph, stores COMMIT_GRAPH_READ_OBJECT in a parent slot; readers then
+// parse the commit object instead, so the graph never hides a parent.
+
+const char COMMIT_GRAPH_MAGIC[4] = {'M', 'G', 'C', 'G'};
+const uint32_t COMMIT_GRAPH_VERSION = 2;
+const uint32_t COMMIT_GRAPH_NO_PARENT = 0xFFFFFFFF;
+const uint32_t COMMIT_GRAPH_READ_OBJECT = 0xFFFFFFFE;
+const size_t COMMIT_GRAPH_HEADER_SIZE = 12;
+const size_t COMMIT_GRAPH_FANOUT_SIZE = 256 * 4;
+const size_t COMMIT_GRAPH_RECORD_SIZE = 40;
+
+string commitGraphPath() {
+    return ".mygit/objects/info/commit-graph";
+}
+
+uint32_t readBE32(const unsigned char* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+uint64_t readBE64(const unsigned char* p) {
+    return (uint64_t(readBE32(p)) << 32) | readBE32(p + 4);
+}
+
+void appendBE32(string& out, uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        out.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+void appendBE64(string& out, uint64_t value) {
+    appendBE32(out, static_cast<uint32_t>(value >> 32));
+    appendBE32(out, static_cast<uint32_t>(value & 0xFFFFFFFF));
+}
+
+// Loaded commit-graph file; empty when missing or invalid
+struct CommitGraphFile {
+    string data;
+    uint32_t count = 0;
+    const unsigned char* fanout = nullptr;
+    const unsigned char* ids = nullptr;
+    const unsigned char* records = nullptr;
+};
+
+// Parse the commit-graph file; empty (count 0) if missing or invalid
+CommitGraphFile readCommitGraphFile() {
+    CommitGraphFile g;
+    ifstream file(commitGraphPath(), ios::binary);
+    if (!file) return g;
+
+    g.data.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+    const unsigned char* base = reinterpret_cast<const unsigned char*>(g.data.data());
+    if (g.data.size() < COMMIT_GRAPH_HEADER_SIZE + COMMIT_GRAPH_FANOUT_SIZE + SHA_DIGEST_LENGTH ||
+        memcmp(base, COMMIT_GRAPH_MAGIC, 4) != 0) {
+        cerr << "Warning: Ignoring invalid commit-graph file\n";
+        g.data.clear();
+        return g;
+    }
+    if (readBE32(base + 4) != COMMIT_GRAPH_VERSION) {
+        // Version 1 kept only two parents; rewriting replaces it
+        cerr << "Warning: Ignoring old commit-graph file (run 'mygit commit-graph write')\n";
+        g.data.clear();
+        return g;
+    }
+
+    uint32_t count = readBE32(base + 8);
+    size_t expected = COMMIT_GRAPH_HEADER_SIZE + COMMIT_GRAPH_FANOUT_SIZE +
+                      size_t(count) * (SHA_DIGEST_LENGTH + COMMIT_GRAPH_RECORD_SIZE) + SHA_DIGEST_LENGTH;
+    if (g.data.size() != expected) {
+        cerr << "Warning: Ignoring truncated commit-graph file\n";
+        g.data.clear();
+        return g;
+    }
+
+    // A torn or corrupted file must not feed wrong parents to readers
+    unsigned char checksum[SHA_DIGEST_LENGTH];
+    SHA1(base, expected - SHA_DIGEST_LENGTH, checksum);
+    if (memcmp(checksum, base + expected - SHA_DIGEST_LENGTH, SHA_DIGEST_LENGTH) != 0) {
+        cerr << "Warning: Ignoring commit-graph file with a bad checksum\n";
+        g.data.clear();
+        return g;
+    }
+
+    g.count = count;
+    g.fanout = base + COMMIT_GRAPH_HEADER_SIZE;
+    g.ids = g.fanout + COMMIT_GRAPH_FANOUT_SIZE;
+    g.records = g.ids + size_t(count) * SHA_DIGEST_LENGTH;
+    return g;
+}
+
+CommitGraphFile& commitGraphStorage() {
+    static CommitGraphFile graph = readCommitGraphFile();
+    return graph;
+}
+
+const CommitGraphFile& loadedCommitGraph() {
+    return commitGraphStorage();
+}
+
+// Re-read the file after it changed; only safe while no other thread uses it
+void reloadCommitGraph() {
+    commitGraphStorage() = readCommitGraphFile();
+}
+
+// Fill a summary from the record at a position in the graph; false when
+// the record does not hold every parent and the object must be read
+bool commitGraphEntryAt(const CommitGraphFile& graph, uint32_t position, CommitSummary& summary) {
+    ObjectId id;
+    memcpy(id.bytes.data(), graph.ids + size_t(position) * SHA_DIGEST_LENGTH, SHA_DIGEST_LENGTH);
+    summary.commitHash = objectIdToHex(id);
+
+    const unsigned char* record = graph.records + size_t(position) * COMMIT_GRAPH_RECORD_SIZE;
+    ObjectId tree;
+    memcpy(tree.bytes.data(), record, SHA_DIGEST_LENGTH);
+    summary.treeHash = objectIdToHex(tree);
+
+    summary.parents.clear();
+    for (int i = 0; i < 2; i++) {
+        uint32_t parent = readBE32(record + 20 + 4 * i);
+        if (parent == COMMIT_GRAPH_NO_PARENT) continue;
+        if (parent >= graph.count) return false; // COMMIT_GRAPH_READ_OBJECT or corrupt
+        ObjectId parentId;
+        memcpy(parentId.bytes.data(), graph.ids + size_t(parent) * SHA_DIGEST_LENGTH, SHA_DIGEST_LENGTH);
+        summary.parents.push_back(objectIdToHex(parentId));
+    }
+
+    summary.generation = readBE32(record + 28);
+    summary.timestamp = static_cast<long long>(readBE64(record + 32));
+    return true;
+}
+
+// Look up a commit in the commit-graph using the fanout table and binary search
+bool lookupCommitGraph(const string& commitHash, CommitSummary& summary) {
+    const CommitGraphFile& graph = loadedCommitGraph();
+    ObjectId id;
+    if (graph.count == 0 || !hexToObjectId(commitHash, id)) {
+        return false;
+    }
+
+    unsigned char firstByte = id.bytes[0];
+    uint32_t lo = firstByte == 0 ? 0 : readBE32(graph.fanout + 4 * (firstByte - 1));
+    uint32_t hi = readBE32(graph.fanout + 4 * firstByte);
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = memcmp(graph.ids + size_t(mid) * SHA_DIGEST_LENGTH, id.bytes.data(), SHA_DIGEST_LENGTH);
+        if (cmp == 0) return commitGraphEntryAt(graph, mid, summary);
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return false;
+}
+
+// Parse only the header fields of a commit object (tree, parents, commit time)
+bool parseCommitSummaryFromObject(const string& commitHash, CommitSummary& summary) {
+    string objectContent = readObjectFile(commitHash);
+    if (objectContent.empty()) return false;
+
+    auto [type, size, content] = parseObject(objectContent);
+    if (type != "commit") return false;
+    return parseCommitSummary(commitHash, content, summary);
+}
+
+// Parse the header lines of a commit object's content
+bool parseCommitSummary(const string& commitHash, const string& content, CommitSummary& summary) {
+    summary = CommitSummary();
+    summary.commitHash = commitHash;
+
+    size_t pos = 0;
+    while (pos < content.size()) {
+        size_t lineEnd = content.find('\n', pos);
+        if (lineEnd == string::npos) lineEnd = content.size();
+        if (lineEnd == pos) break; // blank line: message follows
+
+        string_view line(content.data() + pos, lineEnd - pos);
+        if (line.substr(0, 5) == "tree ") {
+            summary.treeHash = string(line.substr(5));
+        } else if (line.substr(0, 7) == "parent ") {
+            summary.parents.push_back(string(line.substr(7)));
+        } else if (line.substr(0, 10) == "committer ") {
+            // "... <email> <seconds> <timezone>"
+            size_t tzSpace = line.rfind(' ');
+            size_t timeSpace = tzSpace == string_view::npos ? string_view::npos : line.rfind(' ', tzSpace - 1);
+            if (timeSpace != string_view::npos) {
+                summary.timestamp = atoll(string(line.substr(timeSpace + 1, tzSpace - timeSpace - 1)).c_str());
+            }
+        }
+        pos = lineEnd + 1;
+    }
+    return !summary.treeHash.empty();
+}
+
+// Read a commit's summary from the commit-graph, falling back to the object
+bool readCommitSummary(const string& commitHash, CommitSummary& summary) {
+    if (lookupCommitGraph(commitHash, summary)) {
+        countStat(STAT_CACHE_HITS);
+        return true;
+    }
+    countStat(STAT_CACHE_MISSES);
+    return parseCommitSummaryFromObject(commitHash, summary);
+}
+
+// Commits to start from: HEAD, branch and tag refs, and every reflog entry
+vector<string> collectCommitGraphTips() {
+    vector<string> tips;
+    string head = getCurrentCommit();
+    if (!head.empty()) tips.push_back(head);
+
+    for (const auto& [ref, hash] : listRefs("refs/")) {
+        tips.push_back(hash);
+    }
+
+    ifstream logFile(".mygit/logs/HEAD");
+    string line;
+    while (getline(logFile, line)) {
+        istringstream iss(line);
+        string oldHash, newHash;
+        if (iss >> oldHash >> newHash && newHash.size() == 40) tips.push_back(newHash);
+    }
+    return tips;
+}
+
+// Build or extend the commit-graph. Commits already in the graph are kept
+// as-is and the walk stops at them, so only new history is parsed.
+bool writeCommitGraph(const vector<string>& tips, bool verbose) {
+    // Keyed by hex id; lowercase hex order equals binary id order
+    map<string, CommitSummary> commits;
+
+    const CommitGraphFile& graph = loadedCommitGraph();
+    for (uint32_t i = 0; i < graph.count; i++) {
+        CommitSummary summary;
+        if (commitGraphEntryAt(graph, i, summary)) {
+            commits[summary.commitHash] = summary;
+            continue;
+        }
+        // Parents beyond the record: re-read them, and walk any that are new
+        string hash = summary.commitHash;
+        if (parseCommitSummaryFromObject(hash, summary)) commits[hash] = summary;
+    }
+    size_t existingCount = commits.size();
+
+    // Walk parents from the tips until reaching known commits
+    vector<string> stack(tips.begin(), tips.end());
+    for (const auto& [hash, summary] : commits) {
+        for (const string& parent : summary.parents) {
+            if (!commits.count(parent)) stack.push_back(parent);
+        }
+    }
+    while (!stack.empty()) {
+        string hash = stack.back();
+        stack.pop_back();
+        if (commits.count(hash)) continue;
+
+        CommitSummary summary;
+        if (!parseCommitSummaryFromObject(hash, summary)) {
+            cerr << "Warning: Skipping unreadable commit " << hash << "\n";
+            continue;
+        }
+        for (const string& parent : summary.parents) {
+            stack.push_back(parent);
+        }
+        commits[hash] = summary;
+    }
+
+    // Generation numbers: 1 for root commits, else 1 + max over parents
+    for (auto& [hash, summary] : commits) {
+        if (summary.generation != 0) continue;
+        vector<string> pending = {hash};
+        while (!pending.empty()) {
+            CommitSummary& current = commits[pending.back()];
+            uint32_t maxParent = 0;
+            bool ready = true;
+            for (const string& parent : current.parents) {
+                auto it = commits.find(parent);
+                if (it == commits.end()) continue;
+                if (it->second.generation == 0) {
+                    pending.push_back(parent);
+                    ready = false;
+                    break;
+                }
+                maxParent = max(maxParent, it->second.generation);
+            }
+            if (ready) {
+                current.generation = maxParent + 1;
+                pending.pop_back();
+            }
+        }
+    }
+
+    map<string, uint32_t> positions;
+    uint32_t position = 0;
+    for (const auto& entry : commits) {
+        positions[entry.first] = position++;
+    }
+
+    // Serialize
+    string out(COMMIT_GRAPH_MAGIC, 4);
+    appendBE32(out, COMMIT_GRAPH_VERSION);
+    appendBE32(out, static_cast<uint32_t>(commits.size()));
+
+    vector<uint32_t> fanout(256, 0);
+    for (const auto& entry : commits) {
+        fanout[stoi(entry.first.substr(0, 2), nullptr, 16)]++;
+    }
+    uint32_t cumulative = 0;
+    for (uint32_t bucket : fanout) {
+        cumulative += bucket;
+        appendBE32(out, cumulative);
+    }
+
+    for (const auto& entry : commits) {
+        ObjectId id;
+        hexToObjectId(entry.first, id);
+        out.append(reinterpret_cast<const char*>(id.bytes.data()), SHA_DIGEST_LENGTH);
+    }
+
+    for (const auto& [hash, summary] : commits) {
+        ObjectId tree;
+        hexToObjectId(summary.treeHash, tree);
+        out.append(reinterpret_cast<const char*>(tree.bytes.data()), SHA_DIGEST_LENGTH);
+        for (size_t i = 0; i < 2; i++) {
+            uint32_t parent = COMMIT_GRAPH_NO_PARENT;
+            if (i < summary.parents.size()) {
+                auto it = positions.find(summary.parents[i]);
+                parent = it != positions.end() ? it->second : COMMIT_GRAPH_READ_OBJECT;
+            }
+            if (i == 1 && summary.parents.size() > 2) parent = COMMIT_GRAPH_READ_OBJECT;
+            appendBE32(out, parent);
+        }
+        appendBE32(out, summary.generation);
+        appendBE64(out, static_cast<uint64_t>(summary.timestamp));
+    }
+
+    unsigned char checksum[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(out.data()), out.size(), checksum);
+    out.append(reinterpret_cast<const char*>(checksum), SHA_DIGEST_LENGTH);
+
+    // Replace the file atomically
+    fs::create_directories(fs::path(commitGraphPath()).parent_path());
+    string tempPath = commitGraphPath() + ".tmp" + to_string(getpid());
+    ofstream graphFile(tempPath, ios::binary | ios::trunc);
+    if (!graphFile) {
+        cerr << "Error: Cannot write commit-graph file\n";
+        return false;
+    }
+    graphFile.write(out.data(), out.size());
+    graphFile.close();
+    fs::rename(tempPath, commitGraphPath());
+
+    if (verbose) {
+        cout << "Commit-graph: " << commits.size() << " commits ("
+             << commits.size() - existingCount << " new)\n";
+    }
+
+    // Changed-path filters are keyed by the same commits
+    return writeChangedPathFilters(commits, verbose);
+}
+
+// Command handler for main.cpp integration
+bool handleCommitGraph(int argc, char* argv[]) {
+    if (!fs::exists(".mygit")) {
+        cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
+        return false;
+    }
+
+    if (argc < 3 || string(argv[2]) != "write") {
+        cerr << "Usage: mygit commit-graph write [commit-sha...]\n";
+        return false;
+    }
+
+    vector<string> tips = collectCommitGraphTips();
+    for (int i = 3; i < argc; i++) {
+        tips.push_back(argv[i]);
+    }
+
+    return writeCommitGraph(tips, true);
+}
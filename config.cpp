@@ -0,0 +1,116 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include "header.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+// Trim spaces and tabs from both ends
+string trimConfigToken(const string& text) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+// Read a value from .mygit/config ("key = value" per line), or "" if unset
+string readConfigValue(const string& key, const string& gitDir) {
+    ifstream configFile(gitDir + "/config");
+    if (!configFile) return "";
+
+    string line;
+    while (getline(configFile, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        size_t eq = line.find('=');
+        if (eq == string::npos) continue;
+
+        if (trimConfigToken(line.substr(0, eq)) == key) {
+            return trimConfigToken(line.substr(eq + 1));
+        }
+    }
+    return "";
+}
+
+// Config values read on hot paths, loaded once per command
+CachedConfig loadCachedConfig() {
+    CachedConfig config;
+    string threshold = readConfigValue("chunking.threshold");
+    config.chunkingThreshold = threshold.empty() ? 0 : static_cast<size_t>(strtoull(threshold.c_str(), nullptr, 10));
+    config.blobCache = readConfigValue("checkout.blobCache") == "true";
+    config.preallocate = readConfigValue("checkout.preallocate") == "true";
+    return config;
+}
+
+CachedConfig& cachedConfigStorage() {
+    static CachedConfig config = loadCachedConfig();
+    return config;
+}
+
+const CachedConfig& cachedConfig() {
+    return cachedConfigStorage();
+}
+
+// Re-read after the config may have changed ("mygit serve" does this for
+// every forked command); only safe while no other thread uses it
+void reloadCachedConfig() {
+    cachedConfigStorage() = loadCachedConfig();
+}
+
+// Set a value in .mygit/config, replacing an existing entry for the key
+bool writeConfigValue(const string& key, const string& value) {
+    vector<string> lines;
+    bool replaced = false;
+
+    ifstream configFile(".mygit/config");
+    string line;
+    while (getline(configFile, line)) {
+        size_t eq = line.find('=');
+        if (eq != string::npos && trimConfigToken(line.substr(0, eq)) == key) {
+            if (!replaced) lines.push_back(key + " = " + value);
+            replaced = true;
+            continue;
+        }
+        lines.push_back(line);
+    }
+    configFile.close();
+
+    if (!replaced) lines.push_back(key + " = " + value);
+
+    ofstream outFile(".mygit/config", ios::trunc);
+    if (!outFile) {
+        cerr << "Error: Cannot write config file\n";
+        return false;
+    }
+    for (const string& configLine : lines) {
+        outFile << configLine << "\n";
+    }
+    return true;
+}
+
+// Command handler for main.cpp integration
+bool handleConfig(int argc, char* argv[]) {
+    if (!fs::exists(".mygit")) {
+        cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
+        return false;
+    }
+
+    if (argc == 3) {
+        string value = readConfigValue(argv[2]);
+        if (value.empty()) return false;
+        cout << value << "\n";
+        return true;
+    }
+
+    if (argc == 4) {
+        return writeConfigValue(argv[2], argv[3]);
+    }
+
+    cerr << "Usage: mygit config <key> [value]\n";
+    return false;
+}
@@ -0,0 +1,331 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include "header.h"
+
+using namespace std;
+
+// Line diff engine
+//
+// Lines are split with memchr (vectorized in libc) and interned to integer
+// ids, so comparisons are integer compares. The diff is histogram-style:
+// after trimming the common prefix and suffix of a region, the rarest line
+// common to both sides anchors the longest matching run around it, and the
+// two sides of the run are diffed recursively. Regions with no rare common
+// line fall back to Myers' O(ND) algorithm. The result marks changed lines
+// on each side, and unified hunks with context are built from those marks.
+
+// Lines occurring more often than this are not used as anchors
+const size_t DIFF_MAX_ANCHOR_OCCURRENCES = 64;
+
+// Myers gives up (marking the region changed) beyond this edit distance
+const int DIFF_MAX_MYERS_COST = 2048;
+
+// Bytes inspected for NUL when detecting binary content (as git does)
+const size_t DIFF_BINARY_SCAN_BYTES = 8000;
+
+bool isBinaryContent(string_view content) {
+    size_t scan = min(content.size(), DIFF_BINARY_SCAN_BYTES);
+    return memchr(content.data(), '\0', scan) != nullptr;
+}
+
+// Split into lines, each keeping its '\n' (the last one may lack it)
+void splitLines(string_view content, vector<string_view>& lines) {
+    const char* data = content.data();
+    size_t size = content.size();
+    size_t start = 0;
+    while (start < size) {
+        const void* newline = memchr(data + start, '\n', size - start);
+        size_t end = newline ? static_cast<const char*>(newline) - data + 1 : size;
+        lines.push_back(content.substr(start, end - start));
+        start = end;
+    }
+}
+
+// Both sides of a diff as interned line ids, plus the changed marks
+struct LineDiff {
+    vector<string_view> oldLines, newLines;
+    vector<uint32_t> oldIds, newIds;
+    vector<bool> oldChanged, newChanged;
+};
+
+void internLines(LineDiff& diff) {
+    unordered_map<string_view, uint32_t> ids;
+    ids.reserve(diff.oldLines.size() + diff.newLines.size());
+    auto intern = [&ids](const vector<string_view>& lines, vector<uint32_t>& out) {
+        out.reserve(lines.size());
+        for (string_view line : lines) {
+            out.push_back(ids.emplace(line, static_cast<uint32_t>(ids.size())).first->second);
+        }
+    };
+    intern(diff.oldLines, diff.oldIds);
+    intern(diff.newLines, diff.newIds);
+}
+
+// Half-open line ranges [oldStart, oldEnd) x [newStart, newEnd)
+struct DiffRegion {
+    size_t oldStart, oldEnd, newStart, newEnd;
+};
+
+void markRegionChanged(LineDiff& diff, const DiffRegion& region) {
+    fill(diff.oldChanged.begin() + region.oldStart, diff.oldChanged.begin() + region.oldEnd, true);
+    fill(diff.newChanged.begin() + region.newStart, diff.newChanged.begin() + region.newEnd, true);
+}
+
+// Myers' greedy O(ND) diff of a region, marking lines off the shortest
+// edit path. The V arrays of each round are kept for the backtrack, which
+// costs O(D^2) memory, hence DIFF_MAX_MYERS_COST.
+void myersDiff(LineDiff& diff, const DiffRegion& region) {
+    const uint32_t* a = diff.oldIds.data() + region.oldStart;
+    const uint32_t* b = diff.newIds.data() + region.newStart;
+    int n = static_cast<int>(region.oldEnd - region.oldStart);
+    int m = static_cast<int>(region.newEnd - region.newStart);
+    int maxCost = min(n + m, DIFF_MAX_MYERS_COST);
+    int offset = maxCost + 1;
+
+    // trace[d] is V[-d..d] as it was before round d
+    vector<int> v(2 * offset + 1, 0);
+    vector<vector<int>> trace;
+    int finalCost = -1;
+    for (int d = 0; d <= maxCost && finalCost < 0; d++) {
+        trace.emplace_back(v.begin() + offset - d, v.begin() + offset + d + 1);
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && v[offset + k - 1] < v[offset + k + 1]))
+                        ? v[offset + k + 1]
+                        : v[offset + k - 1] + 1;
+            int y = x - k;
+            while (x < n && y < m && a[x] == b[y]) {
+                x++;
+                y++;
+            }
+            v[offset + k] = x;
+            if (x >= n && y >= m) {
+                finalCost = d;
+                break;
+            }
+        }
+    }
+
+    if (finalCost < 0) {
+        markRegionChanged(diff, region);
+        return;
+    }
+
+    // Walk back through the saved V arrays; each step is one insert or delete
+    int x = n, y = m;
+    for (int d = finalCost; d > 0; d--) {
+        const vector<int>& previous = trace[d];
+        int k = x - y;
+        bool insertion = k == -d || (k != d && previous[d + k - 1] < previous[d + k + 1]);
+        int previousK = insertion ? k + 1 : k - 1;
+        int previousX = previous[d + previousK];
+        int previousY = previousX - previousK;
+        while (x > previousX && y > previousY) {
+            x--;
+            y--;
+        }
+        if (insertion) {
+            diff.newChanged[region.newStart + previousY] = true;
+        } else {
+            diff.oldChanged[region.oldStart + previousX] = true;
+        }
+        x = previousX;
+        y = previousY;
+    }
+}
+
+// Find the rarest line shared by both sides of a region and the longest
+// matching run through it. False if no line is rare enough.
+bool findHistogramAnchor(const LineDiff& diff, const DiffRegion& region, DiffRegion& run) {
+    unordered_map<uint32_t, vector<size_t>> occurrences;
+    for (size_t i = region.oldStart; i < region.oldEnd; i++) {
+        vector<size_t>& positions = occurrences[diff.oldIds[i]];
+        if (positions.size() <= DIFF_MAX_ANCHOR_OCCURRENCES) positions.push_back(i);
+    }
+
+    size_t bestCount = DIFF_MAX_ANCHOR_OCCURRENCES + 1;
+    size_t bestLength = 0;
+    for (size_t j = region.newStart; j < region.newEnd; j++) {
+        auto found = occurrences.find(diff.newIds[j]);
+        if (found == occurrences.end()) continue;
+        size_t count = found->second.size();
+        if (count > DIFF_MAX_ANCHOR_OCCURRENCES || count > bestCount) continue;
+
+        // Lines inside a run just measured would only find the same run again
+        size_t runEnd = j;
+        for (size_t i : found->second) {
+            size_t startOld = i, startNew = j;
+            while (startOld > region.oldStart && startNew > region.newStart &&
+                   diff.oldIds[startOld - 1] == diff.newIds[startNew - 1]) {
+                startOld--;
+                startNew--;
+            }
+            size_t endOld = i + 1, endNew = j + 1;
+            while (endOld < region.oldEnd && endNew < region.newEnd && diff.oldIds[endOld] == diff.newIds[endNew]) {
+                endOld++;
+                endNew++;
+            }
+            size_t length = endOld - startOld;
+            if (count < bestCount || length > bestLength) {
+                bestCount = count;
+                bestLength = length;
+                run = {startOld, endOld, startNew, endNew};
+            }
+            runEnd = max(runEnd, endNew - 1);
+        }
+        j = runEnd;
+    }
+    return bestLength > 0;
+}
+
+void computeLineDiff(LineDiff& diff) {
+    diff.oldChanged.assign(diff.oldIds.size(), false);
+    diff.newChanged.assign(diff.newIds.size(), false);
+
+    // Regions are independent once split, so an explicit stack replaces recursion
+    vector<DiffRegion> pending = {{0, diff.oldIds.size(), 0, diff.newIds.size()}};
+    while (!pending.empty()) {
+        DiffRegion region = pending.back();
+        pending.pop_back();
+
+        while (region.oldStart < region.oldEnd && region.newStart < region.newEnd &&
+               diff.oldIds[region.oldStart] == diff.newIds[region.newStart]) {
+            region.oldStart++;
+            region.newStart++;
+        }
+        while (region.oldStart < region.oldEnd && region.newStart < region.newEnd &&
+               diff.oldIds[region.oldEnd - 1] == diff.newIds[region.newEnd - 1]) {
+            region.oldEnd--;
+            region.newEnd--;
+        }
+        if (region.oldStart == region.oldEnd || region.newStart == region.newEnd) {
+            markRegionChanged(diff, region);
+            continue;
+        }
+
+        DiffRegion run;
+        if (findHistogramAnchor(diff, region, run)) {
+            pending.push_back({region.oldStart, run.oldStart, region.newStart, run.newStart});
+            pending.push_back({run.oldEnd, region.oldEnd, run.newEnd, region.newEnd});
+        } else {
+            myersDiff(diff, region);
+        }
+    }
+}
+
+// "start,count" for a hunk header; git omits ",1" and uses the line before
+// an empty range
+void writeHunkRange(OutputBuffer& out, size_t start, size_t count) {
+    if (count == 1) {
+        out << start + 1;
+        return;
+    }
+    out << (count == 0 ? start : start + 1) << ',' << count;
+}
+
+void writeDiffLine(OutputBuffer& out, char marker, string_view line) {
+    out << marker << line;
+    if (line.empty() || line.back() != '\n') {
+        out << "\n\\ No newline at end of file\n";
+    }
+}
+
+// Number of lines, counting a final line without '\n'
+size_t countLines(string_view content) {
+    size_t lines = 0;
+    const char* data = content.data();
+    const char* end = data + content.size();
+    while (const void* newline = memchr(data, '\n', end - data)) {
+        lines++;
+        data = static_cast<const char*>(newline) + 1;
+    }
+    return lines + (data != end ? 1 : 0);
+}
+
+// Lines added and removed between two texts, without building hunks
+void countChangedLines(string_view oldContent, string_view newContent, size_t& added, size_t& removed) {
+    if (oldContent.empty() || newContent.empty()) {
+        added = countLines(newContent);
+        removed = countLines(oldContent);
+        return;
+    }
+
+    TraceSpan span("countChangedLines");
+    LineDiff diff;
+    splitLines(oldContent, diff.oldLines);
+    splitLines(newContent, diff.newLines);
+    internLines(diff);
+    computeLineDiff(diff);
+    added = count(diff.newChanged.begin(), diff.newChanged.end(), true);
+    removed = count(diff.oldChanged.begin(), diff.oldChanged.end(), true);
+}
+
+void writeUnifiedDiff(OutputBuffer& out, string_view oldContent, string_view newContent, const DiffOptions& options) {
+    TraceSpan span("writeUnifiedDiff");
+    LineDiff diff;
+    splitLines(oldContent, diff.oldLines);
+    splitLines(newContent, diff.newLines);
+    internLines(diff);
+    computeLineDiff(diff);
+
+    size_t context = static_cast<size_t>(max(options.contextLines, 0));
+    size_t oldCount = diff.oldLines.size(), newCount = diff.newLines.size();
+    size_t i = 0, j = 0;
+
+    while (i < oldCount || j < newCount) {
+        // Skip to the next change; unchanged lines pair up one to one
+        while (i < oldCount && j < newCount && !diff.oldChanged[i] && !diff.newChanged[j]) {
+            i++;
+            j++;
+        }
+        if (i >= oldCount && j >= newCount) break;
+
+        // Extend the hunk while the gap to the next change fits in the context
+        size_t hunkOldStart = i - min(i, context), hunkNewStart = j - min(j, context);
+        size_t endOld = i, endNew = j;
+        while (true) {
+            while (endOld < oldCount && diff.oldChanged[endOld]) endOld++;
+            while (endNew < newCount && diff.newChanged[endNew]) endNew++;
+
+            size_t gap = 0;
+            while (endOld + gap < oldCount && endNew + gap < newCount &&
+                   !diff.oldChanged[endOld + gap] && !diff.newChanged[endNew + gap] && gap <= 2 * context) {
+                gap++;
+            }
+            bool moreChanges = endOld + gap < oldCount || endNew + gap < newCount;
+            if (moreChanges && gap <= 2 * context) {
+                endOld += gap;
+                endNew += gap;
+                continue;
+            }
+            break;
+        }
+        size_t trailing = min({context, oldCount - endOld, newCount - endNew});
+        size_t hunkOldEnd = endOld + trailing, hunkNewEnd = endNew + trailing;
+
+        out << "@@ -";
+        writeHunkRange(out, hunkOldStart, hunkOldEnd - hunkOldStart);
+        out << " +";
+        writeHunkRange(out, hunkNewStart, hunkNewEnd - hunkNewStart);
+        out << " @@\n";
+
+        size_t a = hunkOldStart, b = hunkNewStart;
+        while (a < hunkOldEnd || b < hunkNewEnd) {
+            if (a < hunkOldEnd && diff.oldChanged[a]) {
+                writeDiffLine(out, '-', diff.oldLines[a++]);
+            } else if (b < hunkNewEnd && diff.newChanged[b]) {
+                writeDiffLine(out, '+', diff.newLines[b++]);
+            } else {
+                writeDiffLine(out, ' ', diff.oldLines[a]);
+                a++;
+                b++;
+            }
+        }
+        i = hunkOldEnd;
+        j = hunkNewEnd;
+    }
+}
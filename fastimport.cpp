@@ -0,0 +1,590 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <unordered_set>
+#include <chrono>
+#include <iomanip>
+#include <charconv>
+#include <algorithm>
+#include "header.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+// fast-import: bulk history ingestion from a text stream on stdin
+//
+// Supported commands (a subset of git fast-import):
+//
+//   blob                      commit <ref>              reset <ref>
+//   mark :<n>                 mark :<n>                 from <commit>
+//   data <count|<<delim>      author <ident> <time> <tz>
+//   <raw bytes>               committer <ident> <time> <tz>
+//                             data <count|<<delim>      checkpoint
+//                             <message>                 progress <text>
+//                             from <commit>             done
+//                             merge <commit>
+//                             M <mode> <:mark|sha|inline> <path>
+//                             D <path>
+//                             deleteall
+//
+// Each branch keeps an in-memory tree that is only re-serialized along
+// modified paths. Objects go through a batched writer that compresses and
+// stores them in parallel, and refs are updated once at the end.
+//
+// "data <<delim" takes the lines up to one holding only delim, each with
+// its LF. Commits and trees are only given ids of objects that exist.
+
+// Pending objects are flushed once this many bytes are buffered
+const size_t IMPORT_BATCH_BYTES = 64 * 1024 * 1024;
+// Exact-count data is read in pieces this large, so a bogus count fails at
+// the end of the stream instead of allocating it up front
+const size_t IMPORT_DATA_READ_SIZE = 1 << 20;
+const size_t IMPORT_WRITE_TASK_SIZE = 256;
+
+struct ImportDir;
+
+// File or directory in an import tree
+struct ImportEntry {
+    string mode;                 // "100644" for files, "40000" for directories
+    string id;                   // blob id (files only)
+    unique_ptr<ImportDir> dir;   // contents (directories only)
+};
+
+// Directory in an import tree. treeId is the stored tree while the directory
+// is unmodified; directories from existing commits are loaded on first use.
+struct ImportDir {
+    string treeId;
+    bool loaded = true;
+    map<string, ImportEntry> entries;
+};
+
+struct ImportBranch {
+    string head;
+    string oldTip; // ref value before the import; all zeros if it did not exist
+    unique_ptr<ImportDir> root = make_unique<ImportDir>();
+};
+
+// Collects new objects and writes them in parallel batches
+class ImportObjectWriter {
+public:
+    void add(const string& hash, string object) {
+        if (!known.insert(hash).second) return;
+        pendingBytes += object.size();
+        totalBytes += object.size();
+        pending.push_back({hash, move(object)});
+        if (pendingBytes >= IMPORT_BATCH_BYTES) flush();
+    }
+
+    void flush() {
+        TaskGroup group(sharedThreadPool());
+        for (size_t start = 0; start < pending.size(); start += IMPORT_WRITE_TASK_SIZE) {
+            size_t end = min(start + IMPORT_WRITE_TASK_SIZE, pending.size());
+            group.run([this, start, end]() {
+                for (size_t i = start; i < end; i++) {
+                    writeCompressedObject(pending[i].first, pending[i].second);
+                }
+            });
+        }
+        group.wait();
+        pending.clear();
+        pendingBytes = 0;
+    }
+
+    size_t bytesWritten() const { return totalBytes; }
+    bool contains(const string& hash) const { return known.count(hash) != 0; }
+
+private:
+    vector<pair<string, string>> pending;
+    unordered_set<string> known;
+    size_t pendingBytes = 0;
+    size_t totalBytes = 0;
+};
+
+// Line reader over stdin that can push back one line
+class ImportStream {
+public:
+    bool nextLine(string& line) {
+        if (hasPushedBack) {
+            line = pushedBack;
+            hasPushedBack = false;
+            return true;
+        }
+        if (!getline(cin, line)) return false;
+        lineNumber++;
+        return true;
+    }
+
+    void pushBack(const string& line) {
+        pushedBack = line;
+        hasPushedBack = true;
+    }
+
+    // Read the payload of a "data <count>" or "data <<delim" line; error
+    // says what is wrong when it returns false
+    bool readData(const string& dataLine, string& data, string& error) {
+        data.clear();
+        if (dataLine.compare(0, 5, "data ") != 0) {
+            error = "expected 'data <count>' or 'data <<delim>'";
+            return false;
+        }
+        string_view spec = string_view(dataLine).substr(5);
+
+        if (spec.substr(0, 2) == "<<") {
+            string delimiter(spec.substr(2));
+            if (delimiter.empty()) {
+                error = "empty data delimiter";
+                return false;
+            }
+            string line;
+            while (getline(cin, line)) {
+                lineNumber++;
+                if (line == delimiter) return true;
+                data += line;
+                data += '\n';
+            }
+            error = "missing data delimiter '" + delimiter + "'";
+            return false;
+        }
+
+        size_t count = 0;
+        auto [end, ec] = from_chars(spec.data(), spec.data() + spec.size(), count);
+        if (ec != errc() || end != spec.data() + spec.size() || spec.empty()) {
+            error = "invalid data count '" + string(spec) + "'";
+            return false;
+        }
+        while (data.size() < count) {
+            size_t offset = data.size();
+            data.resize(offset + min(count - offset, IMPORT_DATA_READ_SIZE));
+            cin.read(data.data() + offset, data.size() - offset);
+            if (static_cast<size_t>(cin.gcount()) != data.size() - offset) {
+                error = "data ends after " + to_string(offset + cin.gcount()) + " of " + to_string(count) + " bytes";
+                return false;
+            }
+        }
+        lineNumber += std::count(data.begin(), data.end(), '\n');
+        if (cin.peek() == '\n') cin.get(); // optional LF after the data
+        return true;
+    }
+
+    size_t currentLine() const { return lineNumber; }
+
+private:
+    string pushedBack;
+    bool hasPushedBack = false;
+    size_t lineNumber = 0;
+};
+
+class FastImporter {
+public:
+    bool run();
+
+private:
+    bool importBlob();
+    bool importCommit(const string& ref);
+    bool importReset(const string& ref);
+    ImportBranch& branchFor(const string& ref);
+    bool resolveCommitish(const string& spec, string& commitHash);
+    bool resolveBlob(const string& dataref, TreeEntryMode mode, string& blobId);
+    void startBranchFrom(ImportBranch& branch, const string& commitHash);
+    ImportDir* descend(ImportDir& root, const string& path, bool create, string& leafName);
+    void loadDir(ImportDir& dir);
+    void removePath(ImportDir& dir, const string& path);
+    string storeDir(ImportDir& dir);
+    bool updateRefs();
+    bool fail(const string& message);
+
+    ImportStream stream;
+    ImportObjectWriter writer;
+    map<string, ImportBranch> branches;
+    map<string, string> marks;
+    map<string, string> importedTrees; // commit -> tree for commits made here
+    size_t blobCount = 0;
+    size_t commitCount = 0;
+    size_t treeCount = 0;
+};
+
+bool FastImporter::fail(const string& message) {
+    cerr << "fast-import: line " << stream.currentLine() << ": " << message << "\n";
+    return false;
+}
+
+// ":<mark>" or a full commit id; marks and ids of blobs are rejected
+bool FastImporter::resolveCommitish(const string& spec, string& commitHash) {
+    if (!spec.empty() && spec[0] == ':') {
+        auto it = marks.find(spec.substr(1));
+        if (it == marks.end() || importedTrees.count(it->second) == 0) return false;
+        commitHash = it->second;
+        return true;
+    }
+    if (!isValidSHA1(spec)) return false;
+
+    string type;
+    size_t size;
+    if (importedTrees.count(spec) == 0 && (!readObjectHeader(spec, type, size) || type != "commit")) return false;
+    commitHash = spec;
+    return true;
+}
+
+// ":<mark>" or the id of a blob in the store or this import. Submodule
+// entries (160000) name commits of another repository, so any id will do.
+bool FastImporter::resolveBlob(const string& dataref, TreeEntryMode mode, string& blobId) {
+    if (dataref[0] == ':') {
+        auto it = marks.find(dataref.substr(1));
+        if (it == marks.end()) return fail("unknown mark " + dataref);
+        blobId = it->second;
+        return true;
+    }
+    if (!isValidSHA1(dataref)) return fail("invalid blob id '" + dataref + "'");
+    blobId = dataref;
+    if (mode == TreeEntryMode::GITLINK || writer.contains(blobId)) return true;
+
+    string type;
+    size_t size;
+    if (!readObjectHeader(blobId, type, size)) return fail("unknown blob " + blobId);
+    if (type != "blob") return fail(blobId + " is a " + type + ", not a blob");
+    return true;
+}
+
+// Branch state for a ref, continuing from the ref's current tip the first
+// time the stream names it
+ImportBranch& FastImporter::branchFor(const string& ref) {
+    auto found = branches.find(ref);
+    if (found != branches.end()) return found->second;
+
+    ImportBranch& branch = branches[ref];
+    if (readRef(ref, branch.oldTip)) {
+        startBranchFrom(branch, branch.oldTip);
+    } else {
+        branch.oldTip = string(40, '0');
+    }
+    return branch;
+}
+
+// Point a branch at a commit; its tree is loaded lazily from the object store
+void FastImporter::startBranchFrom(ImportBranch& branch, const string& commitHash) {
+    if (branch.head == commitHash) return;
+
+    writer.flush(); // trees written by this import may be read back
+    string treeId;
+    auto it = importedTrees.find(commitHash);
+    treeId = it != importedTrees.end() ? it->second : getTreeSHAFromCommit(commitHash);
+
+    branch.head = commitHash;
+    branch.root = make_unique<ImportDir>();
+    branch.root->treeId = treeId;
+    branch.root->loaded = treeId.empty();
+}
+
+void FastImporter::loadDir(ImportDir& dir) {
+    if (dir.loaded) return;
+    TreeArena arena;
+    for (const TreeEntry& entry : readTreeEntries(arena, dir.treeId)) {
+        ImportEntry imported;
+        imported.mode = entry.modeString();
+        if (entry.isTree()) {
+            imported.dir = make_unique<ImportDir>();
+            imported.dir->treeId = entry.hex();
+            imported.dir->loaded = false;
+        } else {
+            imported.id = entry.hex();
+        }
+        dir.entries[string(entry.name)] = move(imported);
+    }
+    dir.loaded = true;
+}
+
+// Walk to the directory holding a path, marking every directory along the
+// path as modified. With create set, missing directories are added and files
+// in the way are replaced by directories, as git does for "M"; otherwise
+// nullptr is returned when a component is not a directory.
+ImportDir* FastImporter::descend(ImportDir& root, const string& path, bool create, string& leafName) {
+    ImportDir* current = &root;
+    size_t start = 0;
+    while (true) {
+        loadDir(*current);
+
+        size_t slash = path.find('/', start);
+        if (slash == string::npos) {
+            current->treeId.clear();
+            leafName = path.substr(start);
+            return current;
+        }
+
+        string name = path.substr(start, slash - start);
+        auto found = current->entries.find(name);
+        if (!create && (found == current->entries.end() || !found->second.dir)) return nullptr;
+        current->treeId.clear();
+
+        ImportEntry& entry = current->entries[name];
+        if (!entry.dir) {
+            entry = ImportEntry{"40000", "", make_unique<ImportDir>()};
+        }
+        current = entry.dir.get();
+        start = slash + 1;
+    }
+}
+
+// Remove a file or directory; a path that does not exist is ignored
+void FastImporter::removePath(ImportDir& root, const string& path) {
+    string leafName;
+    ImportDir* parent = descend(root, path, false, leafName);
+    if (parent) parent->entries.erase(leafName);
+}
+
+// Serialize modified directories bottom-up; unmodified ones keep their id.
+// Empty directories are dropped, as in git.
+string FastImporter::storeDir(ImportDir& dir) {
+    if (!dir.treeId.empty()) return dir.treeId;
+
+    string content;
+    for (auto it = dir.entries.begin(); it != dir.entries.end();) {
+        ImportEntry& entry = it->second;
+        string id = entry.id;
+        if (entry.dir) {
+            id = storeDir(*entry.dir);
+            if (entry.dir->loaded && entry.dir->entries.empty()) {
+                it = dir.entries.erase(it);
+                continue;
+            }
+        }
+
+        ObjectId binary;
+        hexToObjectId(id, binary);
+        content += entry.mode + " " + it->first + '\0';
+        content.append(reinterpret_cast<const char*>(binary.bytes.data()), binary.bytes.size());
+        ++it;
+    }
+
+    string object = "tree " + to_string(content.size()) + '\0' + content;
+    dir.treeId = computeSHA1FromString(object);
+    writer.add(dir.treeId, move(object));
+    treeCount++;
+    return dir.treeId;
+}
+
+bool FastImporter::importBlob() {
+    string line, mark, data;
+    if (!stream.nextLine(line)) return fail("unexpected end of stream in blob");
+    if (line.compare(0, 6, "mark :") == 0) {
+        mark = line.substr(6);
+        if (!stream.nextLine(line)) return fail("unexpected end of stream in blob");
+    }
+    string error;
+    if (!stream.readData(line, data, error)) return fail(error);
+
+    string object = "blob " + to_string(data.size()) + '\0' + data;
+    string hash = computeSHA1FromString(object);
+    writer.add(hash, move(object));
+    if (!mark.empty()) marks[mark] = hash;
+    blobCount++;
+    return true;
+}
+
+bool FastImporter::importCommit(const string& ref) {
+    ImportBranch& branch = branchFor(ref);
+    string line, mark, author, committer, message;
+    vector<string> parents;
+
+    if (!stream.nextLine(line)) return fail("unexpected end of stream in commit");
+    if (line.compare(0, 6, "mark :") == 0) {
+        mark = line.substr(6);
+        stream.nextLine(line);
+    }
+    if (line.compare(0, 7, "author ") == 0) {
+        author = line.substr(7);
+        stream.nextLine(line);
+    }
+    if (line.compare(0, 10, "committer ") != 0) return fail("expected 'committer'");
+    committer = line.substr(10);
+    if (author.empty()) author = committer;
+
+    string error;
+    if (!stream.nextLine(line)) return fail("expected commit message data");
+    if (!stream.readData(line, message, error)) return fail(error);
+
+    // Parents: explicit "from", else the branch's current head
+    bool hasFrom = false;
+    while (stream.nextLine(line)) {
+        if (line.compare(0, 5, "from ") == 0 || line.compare(0, 6, "merge ") == 0) {
+            string commitHash;
+            if (!resolveCommitish(line.substr(line.find(' ') + 1), commitHash)) {
+                return fail("unknown commit '" + line + "'");
+            }
+            if (line[0] == 'f') {
+                startBranchFrom(branch, commitHash);
+                hasFrom = true;
+            }
+            parents.push_back(commitHash);
+            continue;
+        }
+        stream.pushBack(line);
+        break;
+    }
+    if (!hasFrom && !branch.head.empty()) {
+        parents.insert(parents.begin(), branch.head);
+    }
+
+    // File changes until the next command
+    while (stream.nextLine(line)) {
+        if (line.empty()) continue;
+        if (line == "deleteall") {
+            branch.root = make_unique<ImportDir>();
+        } else if (line.compare(0, 2, "D ") == 0) {
+            removePath(*branch.root, line.substr(2));
+        } else if (line.compare(0, 2, "M ") == 0) {
+            istringstream iss(line.substr(2));
+            string mode, dataref, path;
+            iss >> mode >> dataref;
+            getline(iss, path);
+            if (!path.empty() && path[0] == ' ') path = path.substr(1);
+            if (dataref.empty() || path.empty()) return fail("expected 'M <mode> <dataref> <path>'");
+            if (mode == "644") mode = "100644";
+            if (mode == "755") mode = "100755";
+            TreeEntryMode entryMode;
+            if (!parseTreeEntryMode(mode, entryMode) || entryMode == TreeEntryMode::TREE) {
+                return fail("unsupported mode " + mode);
+            }
+
+            string blobId;
+            if (dataref == "inline") {
+                string data, dataLine;
+                if (!stream.nextLine(dataLine)) return fail("expected inline data");
+                if (!stream.readData(dataLine, data, error)) return fail(error);
+                string object = "blob " + to_string(data.size()) + '\0' + data;
+                blobId = computeSHA1FromString(object);
+                writer.add(blobId, move(object));
+                blobCount++;
+            } else if (!resolveBlob(dataref, entryMode, blobId)) {
+                return false;
+            }
+
+            string leafName;
+            ImportDir* parent = descend(*branch.root, path, true, leafName);
+            parent->entries[leafName] = ImportEntry{mode, blobId, nullptr};
+        } else {
+            stream.pushBack(line);
+            break;
+        }
+    }
+
+    string treeId = storeDir(*branch.root);
+
+    ostringstream content;
+    content << "tree " << treeId << "\n";
+    for (const string& parent : parents) {
+        content << "parent " << parent << "\n";
+    }
+    content << "author " << author << "\n";
+    content << "committer " << committer << "\n";
+    content << "\n" << message;
+    if (message.empty() || message.back() != '\n') content << "\n";
+
+    string body = content.str();
+    string object = "commit " + to_string(body.size()) + '\0' + body;
+    string commitHash = computeSHA1FromString(object);
+    writer.add(commitHash, move(object));
+
+    branch.head = commitHash;
+    importedTrees[commitHash] = treeId;
+    if (!mark.empty()) marks[mark] = commitHash;
+    commitCount++;
+    return true;
+}
+
+bool FastImporter::importReset(const string& ref) {
+    ImportBranch& branch = branchFor(ref);
+    branch.head.clear();
+    branch.root = make_unique<ImportDir>();
+
+    string line;
+    if (stream.nextLine(line)) {
+        if (line.compare(0, 5, "from ") == 0) {
+            string commitHash;
+            if (!resolveCommitish(line.substr(5), commitHash)) return fail("unknown commit '" + line + "'");
+            startBranchFrom(branch, commitHash);
+        } else {
+            stream.pushBack(line);
+        }
+    }
+    return true;
+}
+
+// Write every imported ref as a loose ref; a symbolic HEAD follows its
+// branch. A ref that moved since the import read it is not overwritten.
+bool FastImporter::updateRefs() {
+    for (const auto& [ref, branch] : branches) {
+        if (branch.head.empty() || branch.head == branch.oldTip) continue;
+        string error;
+        if (!updateRef(ref, branch.head, branch.oldTip, error)) {
+            cerr << "Error: " << error << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FastImporter::run() {
+    auto start = chrono::steady_clock::now();
+
+    string line;
+    while (stream.nextLine(line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        bool ok = true;
+        if (line == "blob") {
+            ok = importBlob();
+        } else if (line.compare(0, 7, "commit ") == 0) {
+            ok = importCommit(line.substr(7));
+        } else if (line.compare(0, 6, "reset ") == 0) {
+            ok = importReset(line.substr(6));
+        } else if (line == "checkpoint") {
+            writer.flush();
+        } else if (line.compare(0, 9, "progress ") == 0) {
+            standardOutput() << string_view(line).substr(9) << "\n";
+            standardOutput().flush(); // progress is meant to be seen while importing
+        } else if (line == "done") {
+            break;
+        } else {
+            ok = fail("unsupported command '" + line + "'");
+        }
+        if (!ok) return false;
+    }
+
+    writer.flush();
+    if (!updateRefs()) return false;
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if (seconds <= 0) seconds = 1e-9;
+    double megabytes = writer.bytesWritten() / (1024.0 * 1024.0);
+    ostringstream summary;
+    summary << "Imported " << commitCount << " commits, " << blobCount << " blobs, "
+         << treeCount << " trees in " << fixed << setprecision(2) << seconds << " s ("
+         << setprecision(0) << commitCount / seconds << " commits/s, "
+         << setprecision(1) << megabytes / seconds << " MB/s)\n";
+    standardOutput() << summary.str();
+    return true;
+}
+
+// Command handler for main.cpp integration
+bool handleFastImport(int argc, char* argv[]) {
+    if (!fs::exists(".mygit")) {
+        cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
+        return false;
+    }
+    if (argc > 2) {
+        cerr << "Error: Unexpected argument '" << argv[2] << "'\n";
+        cerr << "Usage: mygit fast-import < stream\n";
+        return false;
+    }
+
+    fs::create_directories(".mygit/refs/heads");
+    ios::sync_with_stdio(false);
+
+    FastImporter importer;
+    return importer.run();
+}
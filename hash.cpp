@@ -28,12 +28,9 @@ string computeSHA1(const string& fileContent) {
     EVP_DigestFinal_ex(mdctx, hash, &hash_len);
     EVP_MD_CTX_free(mdctx);
 
-    ostringstream oss;
-    oss << hex << setfill('0');
-    for (unsigned int i = 0; i < hash_len; i++) {
-        oss << setw(2) << static_cast<int>(hash[i]);
-    }
-    return oss.str();
+    string hex(2 * hash_len, '0');
+    formatHex(hash, hash_len, hex.data());
+    return hex;
 }
 
 bool writeBlob(const string& filePath, const string& hash) {
@@ -60,6 +57,8 @@ bool writeBlob(const string& filePath, const string& hash) {
 
     ofstream destFile(dirPath + "/" + fileName, ios::binary);
     destFile.write(reinterpret_cast<const char*>(compressedData.data()), compressedSize);
+    countStat(STAT_BYTES_DEFLATED, blobData.size());
+    countStat(STAT_OBJECTS_WRITTEN);
     return true;
 }
 
@@ -68,6 +67,20 @@ bool hashObject(const string& filePath, bool writeFlag) {
     ostringstream buffer;
     buffer << srcFile.rdbuf();
     string content = buffer.str();
+    countStat(STAT_FILES_OPENED);
+    countStat(STAT_FILES_HASHED);
+
+    // Large files are stored as chunked blobs when chunking is enabled
+    if (shouldChunkBlob(content.size())) {
+        string hash = storeChunkedBlob(content, writeFlag);
+        if (hash.empty()) return false;
+        cout << "SHA-1: " << hash << "\n";
+        if (writeFlag) {
+            cout << "Chunked blob written to: .mygit/objects/"
+                 << hash.substr(0, 2) << "/" << hash.substr(2) << "\n";
+        }
+        return true;
+    }
 
     string hash = computeSHA1(content);
     cout << "SHA-1: " << hash << "\n";
@@ -7,6 +7,18 @@
 #include <map>
 #include <set>
 #include <tuple>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <span>
+#include <memory>
+#include <unordered_map>
 #include <zlib.h>
 
 namespace fs = std::filesystem;
@@ -20,11 +32,51 @@ struct FileStatus {
     string workingHash;
 };
 
-struct TreeEntry {
+// One staged file; stat data (size < 0 when unknown) lets unchanged
+// working files skip re-hashing. skipWorktree entries are outside the
+// sparse checkout and may name a whole directory (mode 40000).
+struct IndexEntry {
     string mode;
-    string type;
-    string sha;
-    string name;
+    string hash;
+    string path;
+    long long mtimeNs = 0;
+    long long size = -1;
+    bool skipWorktree = false;
+};
+
+// Directories selected by .mygit/info/sparse-checkout (cone mode)
+struct SparseCheckout {
+    bool enabled = false;
+    set<string> recursive; // checked out with everything below them
+    set<string> parents;   // only their own files are checked out
+};
+
+// Line diff and rename detection settings
+struct DiffOptions {
+    int contextLines = 3;
+    bool detectRenames = true;
+    bool detectCopies = false;
+    int renameThreshold = 50; // minimum similarity, percent
+    int renameLimit = 1000;   // inexact detection skipped beyond limit^2 pairs
+    bool inexactRenames = true; // false: pair identical blobs only, reading no content
+};
+
+// One file-level difference between two trees. status is 'A', 'D', 'M',
+// 'R' (renamed) or 'C' (copied); similarity is set for R and C.
+struct TreeChange {
+    char status;
+    string oldPath, newPath;
+    string oldMode, newMode;
+    string oldSha, newSha;
+    int similarity = 0;
+};
+
+// Output options of ls-tree
+struct LsTreeOptions {
+    bool nameOnly = false;
+    bool recursive = false;  // -r: descend into subtrees
+    bool showTrees = false;  // -t: list subtrees too when recursing
+    bool longFormat = false; // --long: blob sizes
 };
 
 // Structure for commit information
@@ -38,16 +90,206 @@ struct CommitInfo {
     string message;
 };
 
+// Binary (20-byte) SHA-1 object id
+struct ObjectId {
+    array<unsigned char, 20> bytes{};
+
+    bool operator==(const ObjectId& other) const { return bytes == other.bytes; }
+    bool operator!=(const ObjectId& other) const { return bytes != other.bytes; }
+    bool operator<(const ObjectId& other) const { return bytes < other.bytes; }
+};
+
+// Kind of a tree entry, from its octal mode
+enum class TreeEntryMode : uint8_t { FILE, EXECUTABLE, SYMLINK, TREE, GITLINK };
+
+// One parsed tree entry. The name points into the tree content, which the
+// TreeArena that read the tree keeps alive.
+struct TreeEntry {
+    TreeEntryMode mode = TreeEntryMode::FILE;
+    ObjectId id;
+    string_view name;
+
+    bool isTree() const { return mode == TreeEntryMode::TREE; }
+    bool isBlob() const { return mode != TreeEntryMode::TREE && mode != TreeEntryMode::GITLINK; }
+    const char* modeString() const; // "100644", "40000", ...
+    const char* typeName() const;   // "blob", "tree" or "commit"
+    string hex() const;
+};
+
+// Storage for the trees read during one walk (see treearena.cpp). Inflated
+// tree contents and their parsed entries are bump-allocated from blocks
+// and freed together with the arena, so entries and names stay valid
+// until then. Trees may be read from several threads at once.
+class TreeArena {
+public:
+    TreeArena() = default;
+    TreeArena(const TreeArena&) = delete;
+    TreeArena& operator=(const TreeArena&) = delete;
+
+    bool read(const string& treeSHA, span<const TreeEntry>& entries, string& error,
+              const string& gitDir = ".mygit");
+    bool read(const ObjectId& id, span<const TreeEntry>& entries, string& error, const string& gitDir = ".mygit");
+    // Parse content that the arena keeps a reference to
+    bool parse(shared_ptr<const string> content, span<const TreeEntry>& entries);
+
+private:
+    char* allocate(size_t size, size_t alignment);
+    bool parseInto(string_view content, span<const TreeEntry>& entries);
+
+    mutex lock;
+    vector<unique_ptr<char[]>> blocks;
+    char* next = nullptr;
+    size_t remaining = 0;
+    size_t blockSize = 0;
+    vector<shared_ptr<const string>> pinned;
+};
+
+// Commit fields needed for history traversal (from the commit-graph or the object)
+struct CommitSummary {
+    string commitHash;
+    string treeHash;
+    vector<string> parents;
+    long long timestamp = 0;
+    uint32_t generation = 0; // 0 when not known from the commit-graph
+};
+
+// Scoped timing span written to the MYGIT_TRACE2 trace file (no-op when unset).
+// The name must stay valid until exit; use string literals.
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name);
+    ~TraceSpan();
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name;
+    long long startMicros;
+};
+
+// Fixed-size worker pool shared by parallel commands
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+    void submit(function<void()> task);
+    bool runPendingTask();
+    size_t size() const;
+
+private:
+    void workerLoop();
+
+    vector<thread> workers;
+    deque<function<void()>> tasks;
+    mutex queueMutex;
+    condition_variable queueCv;
+    bool stopping = false;
+};
+
+// Group of tasks on a pool that can be waited on together.
+// Waiting threads help run queued tasks, so nested groups don't deadlock.
+// An exception from a task is printed, and wait() then returns false.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool& pool);
+    ~TaskGroup();
+    void run(function<void()> task);
+    bool wait();
+
+private:
+    ThreadPool& pool;
+    atomic<size_t> pending{0};
+    atomic<bool> failed{false};
+    mutex doneMutex;
+    condition_variable doneCv;
+};
+
+// Buffered writer over a file descriptor; see output.cpp.
+// Line-buffered when the descriptor is a terminal.
+class OutputBuffer {
+public:
+    explicit OutputBuffer(int fd);
+    ~OutputBuffer();
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    void write(const char* data, size_t length);
+    void flush();
+    void writeNumber(unsigned long long value, size_t width = 0, char fill = ' ');
+    void writePadded(string_view text, size_t width); // left-aligned
+    void writeHex(const unsigned char* bytes, size_t length);
+
+    OutputBuffer& operator<<(string_view text);
+    OutputBuffer& operator<<(char c);
+    OutputBuffer& operator<<(int value);
+    OutputBuffer& operator<<(long value);
+    OutputBuffer& operator<<(long long value);
+    OutputBuffer& operator<<(unsigned value);
+    OutputBuffer& operator<<(unsigned long value);
+    OutputBuffer& operator<<(unsigned long long value);
+
+private:
+    void writeSigned(long long value);
+
+    int fd;
+    bool lineBuffered;
+    bool failed = false;
+    vector<char> buffer;
+    size_t used = 0;
+};
+
+// Error value returned by Repository calls; code NONE means success
+struct RepositoryError {
+    enum Code { NONE, NOT_A_REPOSITORY, NOT_FOUND, CORRUPT, IO_ERROR, INVALID_ARGUMENT };
+    Code code = NONE;
+    string message;
+
+    explicit operator bool() const { return code != NONE; }
+};
+
+// Handle on one repository for programs that link libmygit; see
+// repository.cpp. Paths are resolved against the repository, not the
+// process working directory, calls return errors instead of printing, and
+// one handle may be shared between threads.
+class Repository {
+public:
+    static RepositoryError open(const string& path, unique_ptr<Repository>& repository);
+
+    const string& workTree() const { return root; }
+    const string& gitDir() const { return gitDirectory; }
+
+    RepositoryError readObject(const string& id, string& type, string& content) const;
+    RepositoryError readObjectHeader(const string& id, string& type, size_t& size) const;
+    RepositoryError streamBlob(const string& id, const function<bool(const char*, size_t)>& onData) const;
+    RepositoryError writeObject(const string& type, const string& content, string& id) const;
+    RepositoryError readTree(const string& id, TreeArena& arena, span<const TreeEntry>& entries) const;
+    RepositoryError readCommit(const string& id, CommitSummary& commit) const;
+    RepositoryError resolveHead(string& commitId) const;
+    RepositoryError readIndex(vector<IndexEntry>& entries) const;
+    RepositoryError configValue(const string& key, string& value) const;
+
+private:
+    Repository(string root, string gitDirectory);
+    RepositoryError objectReadError(const string& id) const;
+
+    string root;
+    string gitDirectory;
+    mutable mutex cacheMutex;
+    mutable unordered_map<string, shared_ptr<const string>> treeCache; // tree contents
+    mutable unordered_map<string, CommitSummary> commitCache;
+};
+
 // Core Git operations
 bool initialize();
 bool hashObject(const string& filePath, bool writeFlag);
 bool catFile(const string& hash, bool printContent, bool displaySize, bool displayType);
 void add(const string& filename);
-void addtoindex(const string& filePath, const string& hash);
+void addtoindex(const string& filePath, const string& hash, bool recordStat = false, const string& mode = "100644");
+size_t stageDeletions(const string& path);
 string computeSHA1(const string& filePath);
-string writeTree(const fs::path& dirPath);
+string writeTree(const fs::path& dirPath, bool verbose = false);
 bool isHidden(const fs::path& path);
-void lsTree(const string& treeSHA, bool nameOnly);
+bool lsTree(const string& treeSHA, const LsTreeOptions& options);
 int handleCommit(int argc, char* argv[]);
 string computeSHA1FromString(const string& content);
 string computeHashForFile(const string& filePath); // Added this declaration
@@ -74,8 +316,14 @@ string computeWorkingFileHash(const string& filePath);
 
 // Utility functions for object handling
 string readObjectFile(const string& hash);
+string readRawObjectFile(const string& hash);
+bool readObjectHeader(const string& hash, string& type, size_t& size, const string& gitDir = ".mygit");
+bool streamObject(const string& hash, const function<bool(const string&, size_t)>& onHeader,
+                  const function<bool(const char*, size_t)>& onData, const string& gitDir = ".mygit");
+bool isValidSHA1(const string& sha);
+bool writeAll(int fd, const char* data, size_t length);
+bool writeBlobToFd(const string& blobSHA, int fd, bool preallocate, string& error);
 tuple<string, size_t, string> parseObject(const string& objectContent);
-TreeEntry parseTreeEntry(const string& data, size_t& pos);
 string decompressData(const string& compressedData);
 string decompressData(const vector<unsigned char>& compressedData); // Overloaded version
 
@@ -84,30 +332,50 @@ void catFile(const string& flag, const string& hash);
 void printFileContent(const string& hash);
 void printFileSize(const string& hash);
 void printFileType(const string& hash);
+bool handleCatFileBatch(int argc, char* argv[]);
 
 // Add/staging functions
-bool addFileToStaging(const string& filePath);
+bool addFileToStaging(const string& filePath, const string& mode = "100644");
 bool isHiddenFile(const fs::path& path);
 
-// HEAD and reference management
-string readHEAD();
-void writeHEAD(const string& commitHash);
+// HEAD and reference management (refs.cpp)
+string readHEAD(const string& gitDir = ".mygit");
+bool writeHEAD(const string& commitHash, const string& oldHash = "");
+string currentBranch(const string& gitDir = ".mygit");
+bool setSymbolicHEAD(const string& refName, string& error);
+bool detachHEAD(const string& commitHash, string& error);
+bool isValidRefName(const string& name);
+bool readRef(const string& refName, string& commitHash, const string& gitDir = ".mygit");
+bool updateRef(const string& refName, const string& commitHash, const string& oldHash, string& error);
+bool deleteRef(const string& refName, string& error);
+map<string, string> listRefs(const string& prefix, const string& gitDir = ".mygit");
+bool packRefs(bool all, size_t& packedCount, string& error);
+string resolveRevision(const string& name);
+bool handleBranch(int argc, char* argv[]);
+bool handleTag(int argc, char* argv[]);
+bool handlePackRefs(int argc, char* argv[]);
+bool handleRevParse(int argc, char* argv[]);
 bool objectExists(const string& sha);
 
 // Tree operations
 string getTreeSHAFromCommit(const string& commitSHA);
-vector<TreeEntry> readTreeEntries(const string& treeSHA);
-bool restoreTree(const string& treeSHA, const fs::path& currentPath);
-void clearWorkingDirectory();
+span<const TreeEntry> readTreeEntries(TreeArena& arena, const string& treeSHA);
+span<const TreeEntry> readTreeEntries(TreeArena& arena, const ObjectId& treeId);
+bool parseTreeEntry(string_view content, size_t& pos, TreeEntry& entry);
+bool parseTreeEntryMode(string_view text, TreeEntryMode& mode);
+string joinTreePath(const string& prefix, string_view name);
 
 // Checkout operations
-bool checkout(const string& commitSHA);
+bool checkout(const string& commitSHA, const string& branchRef = "");
+bool checkoutTree(const string& fromTreeSHA, const string& toTreeSHA, bool discardLocalChanges);
+bool checkoutPreallocate();
 
 // Reset operations
 bool reset(const vector<string>& args);
 bool removeFromIndex(const string& filePath);
 bool clearIndex(); // void return type to match commit.cpp
 bool resetToCommit(const string& commitSHA);
+bool resetIndexToCommit(const string& commitSHA);
 bool resetFilesToHEAD(const vector<string>& filePaths);
 map<string, string> getIndexedFiles();
 
@@ -116,9 +384,136 @@ bool show(const string& commitSHA);
 void showCommit(const string& commitSHA);
 void showHEAD();
 void showTreeDiff(const string& oldTreeSHA, const string& newTreeSHA, const string& prefix);
+void collectTreeChanges(const string& oldTreeSHA, const string& newTreeSHA, const string& prefix,
+                        vector<TreeChange>& changes);
+string readBlobContent(const string& blobSHA);
 CommitInfo parseCommitObject(const string& commitSHA);
 
+// Object store writes
+string compressData(const string& data);
+bool storeObject(const string& gitDir, const string& hash, const string& content, string& error);
+void writeCompressedObject(const string& hash, const string& content);
+
+// Chunked blobs for large files
+bool shouldChunkBlob(size_t contentSize);
+string storeChunkedBlob(const string& content, bool writeFlag);
+string computeBlobHash(const string& content);
+string reassembleChunkedBlob(const string& manifest, const string& gitDir = ".mygit");
+size_t chunkedBlobSize(string_view manifest);
+
+// Repository configuration (.mygit/config)
+struct CachedConfig {
+    size_t chunkingThreshold = 0; // chunking.threshold (0 = disabled)
+    bool blobCache = false;       // checkout.blobCache
+    bool preallocate = false;     // checkout.preallocate
+};
+string readConfigValue(const string& key, const string& gitDir = ".mygit");
+const CachedConfig& cachedConfig();
+void reloadCachedConfig();
+bool writeConfigValue(const string& key, const string& value);
+bool handleConfig(int argc, char* argv[]);
+
+// Bulk import
+bool handleFastImport(int argc, char* argv[]);
+
+// Object ids
+bool hexToObjectId(const string& hex, ObjectId& id);
+string objectIdToHex(const ObjectId& id);
+
+// Commit-graph
+string commitGraphPath();
+bool lookupCommitGraph(const string& commitHash, CommitSummary& summary);
+bool parseCommitSummaryFromObject(const string& commitHash, CommitSummary& summary);
+bool parseCommitSummary(const string& commitHash, const string& content, CommitSummary& summary);
+bool readCommitSummary(const string& commitHash, CommitSummary& summary);
+bool writeCommitGraph(const vector<string>& tips, bool verbose);
+void reloadCommitGraph();
+bool handleCommitGraph(int argc, char* argv[]);
+uint32_t readBE32(const unsigned char* p);
+void appendBE32(string& out, uint32_t value);
+
+// Changed-path Bloom filters
+enum BloomResult { BLOOM_NO_FILTER, BLOOM_DEFINITELY_NOT, BLOOM_MAYBE };
+string bloomFilterPath();
+string normalizeRepoPath(string path);
+void collectChangedPaths(const string& oldTreeSHA, const string& newTreeSHA,
+                         const string& prefix, set<string>& paths);
+BloomResult queryChangedPathFilter(const string& commitHash, const string& path);
+bool commitTouchesPath(const CommitSummary& commit, const string& path);
+bool writeChangedPathFilters(const map<string, CommitSummary>& commits, bool verbose);
+void reloadChangedPathFilters();
+
+// Per-command counters (--stats)
+enum StatCounter {
+    STAT_OBJECTS_READ,
+    STAT_BYTES_INFLATED,
+    STAT_BYTES_DEFLATED,
+    STAT_OBJECTS_WRITTEN,
+    STAT_OBJECTS_SKIPPED,
+    STAT_FILES_STATED,
+    STAT_FILES_OPENED,
+    STAT_FILES_HASHED,
+    STAT_CACHE_HITS,
+    STAT_CACHE_MISSES,
+    STAT_DIRECTORIES_SCANNED,
+    STAT_COUNTER_COUNT
+};
+void countStat(StatCounter counter, uint64_t amount = 1);
+bool isStatsOption(const string& arg);
+void extractStatsOption(int& argc, char* argv[]);
+void resetStats();
+
+// Index file (.mygit/index)
+vector<IndexEntry> loadIndex();
+bool readIndexFile(const string& path, vector<IndexEntry>& entries);
+bool storeIndex(const vector<IndexEntry>& entries);
+bool appendIndexEntry(const IndexEntry& entry);
+bool statFile(const string& path, long long& mtimeNs, long long& size);
+bool fillIndexStat(IndexEntry& entry);
+long long indexFileMtime();
+bool indexStatMatches(const IndexEntry& entry, long long indexMtimeNs);
+void warmResidentIndex();
+
+// Line diff and rename detection
+void detectRenames(vector<TreeChange>& changes, const DiffOptions& options);
+bool isBinaryContent(string_view content);
+void writeUnifiedDiff(OutputBuffer& out, string_view oldContent, string_view newContent, const DiffOptions& options);
+size_t countLines(string_view content);
+void countChangedLines(string_view oldContent, string_view newContent, size_t& added, size_t& removed);
+
+// Uncompressed blob cache for checkout
+bool blobCacheEnabled();
+bool materializeFromBlobCache(const string& path, const string& blobSHA, string& error);
+void trimBlobCache();
+
+// Sparse checkout
+SparseCheckout loadSparseCheckout();
+bool sparseIncludesDirectory(const SparseCheckout& sparse, const string& dir);
+bool sparseIncludesPath(const SparseCheckout& sparse, const string& path);
+void collectSparseTree(const string& treeSHA, const string& prefix, const SparseCheckout& sparse,
+                       map<string, string>& files, vector<IndexEntry>& skipped,
+                       map<string, string>* modes = nullptr);
+bool handleSparseCheckout(int argc, char* argv[]);
+
+// Tracing
+bool traceEnabled();
+void initializeTrace();
+
+// Thread pool
+size_t configuredThreadCount();
+ThreadPool& sharedThreadPool();
+
+// Buffered output
+OutputBuffer& standardOutput();
+char* formatDecimal(unsigned long long value, char* end);
+void formatHex(const unsigned char* bytes, size_t length, char* out);
+
 // Log operations
 bool handleLog(int argc, char* argv[]);
 
+// Resident server (serve --socket)
+bool residentCachesEnabled();
+bool handleServe(int argc, char* argv[], const function<int(int, char*[])>& runCommand);
+bool runThroughServer(int argc, char* argv[], int& status);
+
 #endif
\ No newline at end of file
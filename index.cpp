@@ -0,0 +1,233 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <map>
+#include <ctime>
+#include <sys/stat.h>
+#include "header.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+// Index file (.mygit/index), one entry per line:
+//
+//   <mode> <hash> <path>[\t<mtime-ns> <size>][\tskip-worktree]
+//
+// The optional stat suffix records the working file as it was when the
+// entry was written, so status and reset can skip re-hashing files that
+// have not been touched since. skip-worktree marks entries outside the
+// sparse checkout; a directory left out as a whole is a single entry with
+// mode 40000 and its tree id. Older "<mode> Blob <hash> <path>" lines are
+// still accepted.
+
+const string INDEX_PATH = ".mygit/index";
+
+// Parse one index line; false for blank or malformed lines
+bool parseIndexLine(const string& line, IndexEntry& entry) {
+    if (line.empty()) return false;
+
+    // Tab-separated suffixes: stat data and flags
+    size_t tab = line.find('\t');
+    string body = line.substr(0, tab);
+    string statPart;
+    entry.skipWorktree = false;
+    while (tab != string::npos) {
+        size_t next = line.find('\t', tab + 1);
+        string field = line.substr(tab + 1, next == string::npos ? string::npos : next - tab - 1);
+        if (field == "skip-worktree") {
+            entry.skipWorktree = true;
+        } else {
+            statPart = field;
+        }
+        tab = next;
+    }
+
+    istringstream iss(body);
+    string typeOrHash;
+    iss >> entry.mode >> typeOrHash;
+    if (typeOrHash == "Blob") {
+        iss >> entry.hash;
+    } else {
+        entry.hash = typeOrHash;
+    }
+
+    getline(iss, entry.path);
+    if (!entry.path.empty() && entry.path[0] == ' ') {
+        entry.path = entry.path.substr(1);
+    }
+    entry.path = normalizeRepoPath(entry.path);
+
+    entry.mtimeNs = 0;
+    entry.size = -1;
+    if (!statPart.empty()) {
+        istringstream statStream(statPart);
+        statStream >> entry.mtimeNs >> entry.size;
+    }
+    return !entry.path.empty() && !entry.hash.empty();
+}
+
+string formatIndexLine(const IndexEntry& entry) {
+    string line = entry.mode + " " + entry.hash + " " + entry.path;
+    if (entry.size >= 0) {
+        line += "\t" + to_string(entry.mtimeNs) + " " + to_string(entry.size);
+    }
+    if (entry.skipWorktree) {
+        line += "\tskip-worktree";
+    }
+    return line;
+}
+
+// Parsed index kept by "mygit serve" and inherited by the commands it
+// forks. It is reused while the file's inode, size and mtime are unchanged.
+// An index written in the last second is not cached, since a second write
+// within the same timestamp could leave all three the same.
+struct ResidentIndex {
+    mutex lock;
+    bool valid = false;
+    ino_t inode = 0;
+    long long size = 0, mtimeNs = 0;
+    vector<IndexEntry> entries;
+};
+
+ResidentIndex& residentIndex() {
+    static ResidentIndex& cache = *new ResidentIndex; // never freed, like the tree cache
+    return cache;
+}
+
+// Make the cached index match the file; the caller holds cache.lock.
+// False when the file is missing or too new to cache.
+bool syncResidentIndex(ResidentIndex& cache) {
+    struct stat info;
+    if (stat(INDEX_PATH.c_str(), &info) != 0) {
+        cache.valid = false;
+        return false;
+    }
+    long long mtimeNs = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+    if (cache.valid && cache.inode == info.st_ino && cache.size == info.st_size && cache.mtimeNs == mtimeNs) {
+        return true;
+    }
+
+    cache.valid = false;
+    if (info.st_mtim.tv_sec >= time(nullptr) - 1) return false;
+    readIndexFile(INDEX_PATH, cache.entries);
+    cache.inode = info.st_ino;
+    cache.size = info.st_size;
+    cache.mtimeNs = mtimeNs;
+    cache.valid = true;
+    return true;
+}
+
+// Load the index into the resident cache ahead of the next command
+void warmResidentIndex() {
+    ResidentIndex& cache = residentIndex();
+    lock_guard<mutex> guard(cache.lock);
+    syncResidentIndex(cache);
+}
+
+// Read the index, sorted by path; when a path appears more than once the
+// last line wins (add appends)
+vector<IndexEntry> loadIndex() {
+    vector<IndexEntry> entries;
+    if (residentCachesEnabled()) {
+        ResidentIndex& cache = residentIndex();
+        lock_guard<mutex> guard(cache.lock);
+        if (syncResidentIndex(cache)) return cache.entries;
+    }
+    readIndexFile(INDEX_PATH, entries);
+    return entries;
+}
+
+// Read an index file at path; false if it cannot be opened
+bool readIndexFile(const string& path, vector<IndexEntry>& entries) {
+    TraceSpan span("readIndex");
+    map<string, IndexEntry> byPath;
+
+    ifstream indexFile(path);
+    if (!indexFile) return false;
+    string line;
+    while (getline(indexFile, line)) {
+        IndexEntry entry;
+        if (parseIndexLine(line, entry)) {
+            byPath[entry.path] = entry;
+        }
+    }
+
+    entries.clear();
+    entries.reserve(byPath.size());
+    for (auto& pair : byPath) {
+        entries.push_back(move(pair.second));
+    }
+    return true;
+}
+
+// Replace the index with the given entries
+bool storeIndex(const vector<IndexEntry>& entries) {
+    TraceSpan span("storeIndex");
+    string tempPath = INDEX_PATH + ".tmp";
+    ofstream indexFile(tempPath, ios::trunc);
+    if (!indexFile) {
+        cerr << "Error: Cannot write to index file\n";
+        return false;
+    }
+    for (const IndexEntry& entry : entries) {
+        indexFile << formatIndexLine(entry) << "\n";
+    }
+    indexFile.close();
+
+    error_code ec;
+    fs::rename(tempPath, INDEX_PATH, ec);
+    if (ec) {
+        cerr << "Error: Cannot write to index file\n";
+        return false;
+    }
+    return true;
+}
+
+// Append one entry without rewriting the index
+bool appendIndexEntry(const IndexEntry& entry) {
+    TraceSpan span("appendIndexEntry");
+    ofstream indexFile(INDEX_PATH, ios::app);
+    if (!indexFile) {
+        cerr << "Error: Cannot open index file" << endl;
+        return false;
+    }
+    indexFile << formatIndexLine(entry) << "\n";
+    return true;
+}
+
+// Modification time (ns) and size of a file; false if it cannot be stat'ed
+bool statFile(const string& path, long long& mtimeNs, long long& size) {
+    struct stat info;
+    countStat(STAT_FILES_STATED);
+    if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+    mtimeNs = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+    size = static_cast<long long>(info.st_size);
+    return true;
+}
+
+// Record the working file's current stat data in the entry
+bool fillIndexStat(IndexEntry& entry) {
+    return statFile(entry.path, entry.mtimeNs, entry.size);
+}
+
+long long indexFileMtime() {
+    long long mtimeNs = 0, size = 0;
+    statFile(INDEX_PATH, mtimeNs, size);
+    return mtimeNs;
+}
+
+// True if the working file still matches the entry's recorded stat data.
+// Files modified in the same instant the index was written are "racy" and
+// never trusted, since a later change may not have moved the mtime.
+bool indexStatMatches(const IndexEntry& entry, long long indexMtimeNs) {
+    if (entry.size < 0) return false;
+
+    long long mtimeNs, size;
+    if (!statFile(entry.path, mtimeNs, size)) return false;
+    return size == entry.size && mtimeNs == entry.mtimeNs && mtimeNs < indexMtimeNs;
+}
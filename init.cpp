@@ -3,6 +3,7 @@
 #include <iostream>
 #include <fstream>
 #include <stdexcept>  
+#include "header.h"
 
 using namespace std;
 namespace fs = filesystem;
@@ -10,11 +11,12 @@ namespace fs = filesystem;
 bool initialize() 
 {
     string dir_name = ".mygit";
-    cout << dir_name << " ";
+    OutputBuffer& out = standardOutput();
+    out << dir_name << " ";
 
     // Check if repository already exists and handle it gracefully
     if (fs::exists(dir_name)) {
-        std::cout << "A git repository already exists in " << dir_name << "\n";
+        out << "A git repository already exists in " << dir_name << "\n";
         return false;  // Return false to indicate no new initialization was done
     }
 
@@ -30,13 +32,13 @@ bool initialize()
         ofstream file(dir_name + "/index");
         if (file.is_open()) {
             file.close();
-            cout << "File created: " << dir_name + "/index" << '\n';
+            out << "File created: " << dir_name + "/index" << '\n';
         }
 
         // Create HEAD file pointing to master branch
         ofstream headFile(dir_name + "/HEAD");
         if (headFile.is_open()) {
-            headFile << "";
+            headFile << "ref: refs/heads/master\n";
             headFile.close();
         } else {
             std::cerr << "Error: Could not create HEAD file\n";
@@ -4,70 +4,158 @@
 #include <filesystem>
 #include <vector>
 #include <string>
+#include <queue>
+#include <unordered_set>
+#include <climits>
+#include <ctime>
+#include <iomanip>
+#include <charconv>
 #include "header.h"
 
 namespace fs = std::filesystem;
 using namespace std;
 
-// Function to read the commit log and return commit details
-vector<string> readCommitLog() {
-    vector<string> commits;
-    ifstream logFile(".mygit/logs/HEAD");
-    if (!logFile) {
-        cout << "No commits found (log file doesn't exist).\n";
-        return commits;
+// Options accepted by the log command
+struct LogOptions {
+    string startCommit;
+    long long maxCount = -1;
+    long long since = LLONG_MIN;
+    long long until = LLONG_MAX;
+    bool oneline = false;
+    string path;
+};
+
+// Parse a --since/--until value: seconds since the epoch or YYYY-MM-DD (UTC)
+bool parseLogDate(const string& value, long long& result) {
+    if (!value.empty() && value.find_first_not_of("0123456789") == string::npos) {
+        result = stoll(value);
+        return true;
     }
 
-    string line;
-    while (getline(logFile, line)) {
-        if (!line.empty()) {
-            commits.push_back(line);
+    tm date = {};
+    istringstream iss(value);
+    iss >> get_time(&date, "%Y-%m-%d");
+    if (iss.fail()) {
+        return false;
+    }
+    result = static_cast<long long>(timegm(&date));
+    return true;
+}
+
+// Print one commit. The message and committer are only in the commit
+// object, so every printed commit is read and inflated even when the walk
+// took its summary from the commit-graph.
+void printLogEntry(const CommitSummary& summary, bool oneline) {
+    OutputBuffer& out = standardOutput();
+    string objectContent = readObjectFile(summary.commitHash);
+    if (objectContent.empty()) return;
+
+    auto [type, size, content] = parseObject(objectContent);
+
+    size_t messageStart = content.find("\n\n");
+    messageStart = messageStart == string::npos ? content.size() : messageStart + 2;
+
+    if (oneline) {
+        size_t lineEnd = content.find('\n', messageStart);
+        if (lineEnd == string::npos) lineEnd = content.size();
+        out << summary.commitHash.substr(0, 7) << " "
+             << string_view(content).substr(messageStart, lineEnd - messageStart) << "\n";
+        return;
+    }
+
+    // Committer line: "committer <name> <email> <seconds> <timezone>"
+    string committer, date;
+    size_t committerPos = content.find("\ncommitter ");
+    if (committerPos != string::npos && committerPos < messageStart) {
+        size_t lineStart = committerPos + 11;
+        size_t lineEnd = content.find('\n', lineStart);
+        string line = content.substr(lineStart, lineEnd - lineStart);
+        size_t tzSpace = line.rfind(' ');
+        size_t timeSpace = tzSpace == string::npos ? string::npos : line.rfind(' ', tzSpace - 1);
+        if (timeSpace != string::npos) {
+            committer = line.substr(0, timeSpace);
+            date = line.substr(timeSpace + 1);
+        } else {
+            committer = line;
         }
     }
 
-    return commits;
+    string message = content.substr(messageStart);
+    while (!message.empty() && message.back() == '\n') message.pop_back();
+
+    out << "Commit: " << summary.commitHash << "\n";
+    for (const string& parent : summary.parents) {
+        out << "Parent: " << parent << "\n";
+    }
+    out << "Committer: " << committer << "\n";
+    out << "Date: " << date << "\n";
+    out << "Message: " << message << "\n";
+    out << "\n"; // Blank line between commits
 }
 
-void displayCommitLog() {
-    vector<string> commits = readCommitLog();
-    
-    if (commits.empty()) {
-        cout << "No commits found.\n";
+// Walk parent links from the start commit, newest commit time first.
+// Output is streamed, and the walk stops as soon as -n or --since is satisfied.
+void displayCommitLog(const LogOptions& options) {
+    OutputBuffer& out = standardOutput();
+    string start = options.startCommit.empty() ? getCurrentCommit() : options.startCommit;
+    if (start.empty()) {
+        out << "No commits found.\n";
         return;
     }
 
-    // Display commits from latest to oldest (reverse order)
-    for (auto it = commits.rbegin(); it != commits.rend(); ++it) {
-        string line = *it;
-        
-        // Parse log format: "oldHash newHash committerInfo timestamp commit: message"
-        istringstream ss(line);
-        string oldHash, newHash, committerInfo, timestamp, commitPrefix, message;
-        
-        // Read the components
-        ss >> oldHash >> newHash >> committerInfo >> timestamp >> commitPrefix;
-        
-        // Get the rest as message (after "commit: ")
-        getline(ss, message);
-        if (!message.empty() && message[0] == ' ') {
-            message = message.substr(1); // Remove leading space
-        }
+    CommitSummary startSummary;
+    if (!readCommitSummary(start, startSummary)) {
+        cerr << "Error: Cannot read commit " << start << "\n";
+        return;
+    }
 
-        // Display commit information
-        cout << "Commit: " << newHash << "\n";
-        
-        // Don't show parent if it's the initial commit (all zeros)
-        if (oldHash != string(40, '0')) {
-            cout << "Parent: " << oldHash << "\n";
+    // Max-heap on commit time; parents and times come from the commit-graph
+    // when possible, so commits that are walked but not printed are not read
+    auto olderFirst = [](const CommitSummary& a, const CommitSummary& b) {
+        return a.timestamp < b.timestamp;
+    };
+    priority_queue<CommitSummary, vector<CommitSummary>, decltype(olderFirst)> queue(olderFirst);
+    unordered_set<string> seen;
+
+    queue.push(startSummary);
+    seen.insert(start);
+
+    long long shown = 0;
+    while (!queue.empty()) {
+        if (options.maxCount >= 0 && shown >= options.maxCount) break;
+
+        CommitSummary current = queue.top();
+        queue.pop();
+
+        // Everything still queued is older than --since
+        if (current.timestamp < options.since) break;
+
+        for (const string& parent : current.parents) {
+            if (!seen.insert(parent).second) continue;
+            CommitSummary parentSummary;
+            if (readCommitSummary(parent, parentSummary)) {
+                queue.push(parentSummary);
+            } else {
+                cerr << "Warning: Cannot read parent commit " << parent << "\n";
+            }
         }
-        
-        cout << "Committer: " << committerInfo << "\n";
-        cout << "Date: " << timestamp << "\n";
-        cout << "Message: " << message << "\n";
-        cout << "\n"; // Blank line between commits
+
+        if (current.timestamp > options.until) continue;
+
+        // Changed-path filters rule out most commits without a tree diff
+        if (!options.path.empty() && !commitTouchesPath(current, options.path)) continue;
+
+        printLogEntry(current, options.oneline);
+        shown++;
     }
 }
 
+// Parse a -n count: a non-negative decimal number and nothing else
+bool parseLogCount(string_view text, long long& count) {
+    auto [end, ec] = from_chars(text.data(), text.data() + text.size(), count);
+    return ec == errc() && end == text.data() + text.size() && !text.empty() && count >= 0;
+}
+
 // Main function to handle the log command
 bool handleLog(int argc, char* argv[]) {
     // Check if repository exists
@@ -75,7 +163,45 @@ bool handleLog(int argc, char* argv[]) {
         cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
         return false;
     }
-    
-    displayCommitLog();
+
+    LogOptions options;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        string value;
+
+        if (arg == "--" && i + 1 < argc) {
+            options.path = argv[++i];
+        } else if (arg == "--oneline") {
+            options.oneline = true;
+        } else if ((arg == "-n" && i + 1 < argc) ||
+                   (arg.size() > 1 && arg[0] == '-' && isdigit(static_cast<unsigned char>(arg[1])))) {
+            value = arg == "-n" ? argv[++i] : arg.substr(1); // -n 10 or -10
+            if (!parseLogCount(value, options.maxCount)) {
+                cerr << "Error: Invalid commit count '" << value << "'\n";
+                return false;
+            }
+        } else if (arg.rfind("--since=", 0) == 0 || arg.rfind("--until=", 0) == 0 ||
+                   ((arg == "--since" || arg == "--until") && i + 1 < argc)) {
+            bool isSince = arg.rfind("--since", 0) == 0;
+            value = arg.find('=') != string::npos ? arg.substr(8) : argv[++i];
+            long long parsed;
+            if (!parseLogDate(value, parsed)) {
+                cerr << "Error: Invalid date '" << value << "' (use seconds or YYYY-MM-DD)\n";
+                return false;
+            }
+            (isSince ? options.since : options.until) = parsed;
+        } else if (!arg.empty() && arg[0] != '-' && options.startCommit.empty()) {
+            options.startCommit = resolveRevision(arg); // branch, tag or commit
+            if (options.startCommit.empty()) {
+                cerr << "Error: Unknown revision '" << arg << "'\n";
+                return false;
+            }
+        } else {
+            cerr << "Usage: mygit log [-n <count>] [--since <date>] [--until <date>] [--oneline] [commit-sha] [-- <path>]\n";
+            return false;
+        }
+    }
+
+    displayCommitLog(options);
     return true;
-}
\ No newline at end of file
+}
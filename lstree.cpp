@@ -1,120 +1,190 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <filesystem>
 #include <vector>
 #include <string>
-#include <iomanip>
-#include <openssl/sha.h>
-#include <zlib.h>
-#include <cstring> 
+#include <memory>
 #include "header.h"
 
 using namespace std;
 namespace fs = filesystem;
 
-// Function to parse git object header
-pair<string, size_t> parseHeader(const string& content) {
-    size_t nullPos = content.find('\0');
-    if (nullPos == string::npos) {
-        return {"", 0};
+// ls-tree [-r] [-t] [--long]
+//
+// A recursive listing walks the tree depth-first in tree order. When a
+// tree is reached, all its subtrees are queued on the shared pool, so the
+// workers read ahead while the walk prints. If the walk reaches a subtree
+// that no worker has started yet, it reads that subtree itself rather than
+// waiting in the queue. With --long, blob sizes come from the object headers
+// and are read by the same task that reads the tree. All trees of one
+// listing are read into a single TreeArena, freed when the listing ends.
+
+// Blob headers read per task for --long
+const size_t LS_TREE_SIZE_BATCH = 256;
+
+// One tree's entries, plus blob sizes for --long (-1 for non-blobs)
+struct TreeListing {
+    span<const TreeEntry> entries;
+    vector<long long> sizes;
+};
+
+// A subtree read ahead of the walk; whoever claims it first reads it
+struct PrefetchedTree {
+    ObjectId id;
+    atomic<bool> claimed{false};
+    mutex lock;
+    condition_variable readyCv;
+    bool ready = false;
+    TreeListing listing;
+};
+
+TreeListing readTreeListing(TreeArena& arena, const ObjectId& treeId, bool withSizes) {
+    TreeListing listing;
+    listing.entries = readTreeEntries(arena, treeId);
+    if (!withSizes) return listing;
+
+    // Header reads of large directories are spread over the pool
+    listing.sizes.assign(listing.entries.size(), -1);
+    TaskGroup group(sharedThreadPool());
+    for (size_t start = 0; start < listing.entries.size(); start += LS_TREE_SIZE_BATCH) {
+        group.run([&listing, start]() {
+            size_t end = min(start + LS_TREE_SIZE_BATCH, listing.entries.size());
+            for (size_t i = start; i < end; i++) {
+                if (!listing.entries[i].isBlob()) continue;
+                string type;
+                size_t size;
+                if (readObjectHeader(listing.entries[i].hex(), type, size)) {
+                    listing.sizes[i] = static_cast<long long>(size);
+                }
+            }
+        });
     }
-    
-    string header = content.substr(0, nullPos);
-    istringstream iss(header);
-    string type;
-    size_t size;
-    iss >> type >> size;
-    
-    return {type, nullPos + 1};
+    group.wait();
+    return listing;
 }
 
-// Function to read a tree object from a file
-vector<TreeEntry> readTree(const string& treeSHA) {
-    vector<TreeEntry> entries;
-    
-    // FIXED: Remove .gz extension to match your write-tree implementation
-    string objectPath = ".mygit/objects/" + treeSHA.substr(0, 2) + "/" + 
-                       treeSHA.substr(2);  // No .gz extension
-    
-    // Read compressed file
-    ifstream file(objectPath, ios::binary);
-    if (!file) {
-        cerr << "Error: Could not open tree object file: " << objectPath << endl;
-        return entries;
-    }
-    
-    // Read the entire file into a vector
-    vector<unsigned char> compressedData(
-        (istreambuf_iterator<char>(file)),
-        istreambuf_iterator<char>()
-    );
-    
-    // Decompress the data using utility function
-    string decompressed = decompressData(compressedData);
-    if (decompressed.empty()) {
-        cerr << "Error: Decompression failed for tree object\n";
-        return entries;
+void loadPrefetchedTree(TreeArena& arena, PrefetchedTree& tree, bool withSizes) {
+    if (tree.claimed.exchange(true)) return;
+    TreeListing listing = readTreeListing(arena, tree.id, withSizes);
+    {
+        lock_guard<mutex> guard(tree.lock);
+        tree.listing = move(listing);
+        tree.ready = true;
     }
-    
-    // Parse header
-    auto [type, contentStart] = parseHeader(decompressed);
-    if (type != "tree") {
-        cerr << "Error: Invalid tree object format\n";
-        return entries;
+    tree.readyCv.notify_all();
+}
+
+// Entries of a prefetched subtree, reading it here if no worker has started
+TreeListing takePrefetchedTree(TreeArena& arena, PrefetchedTree& tree, bool withSizes) {
+    loadPrefetchedTree(arena, tree, withSizes);
+    unique_lock<mutex> guard(tree.lock);
+    tree.readyCv.wait(guard, [&tree]() { return tree.ready; });
+    return move(tree.listing);
+}
+
+void printLsTreeEntry(OutputBuffer& out, const TreeEntry& entry, const string& path, long long size,
+                      const LsTreeOptions& options) {
+    if (options.nameOnly) {
+        out << path << "\n";
+        return;
     }
-    
-    // Parse entries using utility function
-    size_t pos = contentStart;
-    while (pos < decompressed.length()) {
-        TreeEntry entry = parseTreeEntry(decompressed, pos);
-        if (entry.sha.empty()) break;  // Break if parsing failed
-        entries.push_back(entry);
+    out << entry.modeString() << " " << entry.typeName() << " ";
+    out.writeHex(entry.id.bytes.data(), entry.id.bytes.size());
+    if (options.longFormat) {
+        out << " ";
+        if (size < 0) {
+            out << "      -";
+        } else {
+            out.writeNumber(static_cast<unsigned long long>(size), 7);
+        }
     }
-    
-    return entries;
+    out << "\t" << path << "\n";
 }
 
-// Function to list the contents of a tree object
-void lsTree(const string& treeSHA, bool nameOnly) {
-    vector<TreeEntry> entries = readTree(treeSHA);
-    if (entries.empty()) {
-        cerr << "Error: No entries found for tree SHA: " << treeSHA << endl;
-        return;
+void listTree(TreeArena& arena, const TreeListing& listing, const string& prefix, const LsTreeOptions& options,
+              TaskGroup& prefetch) {
+    OutputBuffer& out = standardOutput();
+    bool withSizes = options.longFormat;
+
+    // Queue every subtree of this level before descending into the first one
+    vector<shared_ptr<PrefetchedTree>> subtrees;
+    if (options.recursive) {
+        for (const TreeEntry& entry : listing.entries) {
+            if (!entry.isTree()) continue;
+            auto subtree = make_shared<PrefetchedTree>();
+            subtree->id = entry.id;
+            prefetch.run([&arena, subtree, withSizes]() { loadPrefetchedTree(arena, *subtree, withSizes); });
+            subtrees.push_back(subtree);
+        }
     }
-    
-    // Display entries based on the flag
-    for (const auto& entry : entries) {
-        if (nameOnly) {
-            cout << entry.name << endl;
+
+    size_t nextSubtree = 0;
+    for (size_t i = 0; i < listing.entries.size(); i++) {
+        const TreeEntry& entry = listing.entries[i];
+        string path = joinTreePath(prefix, entry.name);
+        long long size = withSizes ? listing.sizes[i] : -1;
+
+        if (entry.isTree() && options.recursive) {
+            if (options.showTrees) printLsTreeEntry(out, entry, path, size, options);
+            TreeListing children = takePrefetchedTree(arena, *subtrees[nextSubtree++], withSizes);
+            listTree(arena, children, path, options, prefetch);
         } else {
-            cout << entry.mode << " " << entry.type << " " 
-                 << entry.sha << "\t" << entry.name << endl;
+            printLsTreeEntry(out, entry, path, size, options);
         }
     }
 }
 
+// Function to list the contents of a tree object
+bool lsTree(const string& treeSHA, const LsTreeOptions& options) {
+    TraceSpan span("lsTree");
+    ObjectId treeId;
+    if (!hexToObjectId(treeSHA, treeId)) {
+        cerr << "Error: Invalid SHA format\n";
+        return false;
+    }
+    TreeArena arena;
+    TreeListing listing = readTreeListing(arena, treeId, options.longFormat);
+    if (listing.entries.empty()) {
+        cerr << "Error: No entries found for tree SHA: " << treeSHA << "\n";
+        return false;
+    }
+
+    TaskGroup prefetch(sharedThreadPool());
+    listTree(arena, listing, "", options, prefetch);
+    prefetch.wait();
+    return true;
+}
+
 // ADDED: Command handler function for main.cpp integration
 bool handleLsTree(int argc, char* argv[]) {
+    const char* usage = "Usage: mygit ls-tree [-r] [-t] [--long] [--name-only] <tree-sha>\n";
     if (argc < 3) {
-        cerr << "Usage: mygit ls-tree [--name-only] <tree-sha>\n";
+        cerr << usage;
         return false;
     }
-    
+
     // Check if repository exists
     if (!fs::exists(".mygit")) {
         cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
         return false;
     }
-    
-    bool nameOnly = false;
+
+    LsTreeOptions options;
     string treeSHA;
-    
+
     // Parse arguments
     for (int i = 2; i < argc; i++) {
         string arg = argv[i];
         if (arg == "--name-only") {
-            nameOnly = true;
+            options.nameOnly = true;
+        } else if (arg == "-r") {
+            options.recursive = true;
+        } else if (arg == "-t") {
+            options.showTrees = true;
+        } else if (arg == "--long" || arg == "-l") {
+            options.longFormat = true;
+        } else if (arg[0] == '-') {
+            cerr << usage;
+            return false;
         } else {
             if (treeSHA.empty()) {
                 treeSHA = arg;
@@ -124,18 +194,17 @@ bool handleLsTree(int argc, char* argv[]) {
             }
         }
     }
-    
+
     if (treeSHA.empty()) {
         cerr << "Error: No tree SHA specified\n";
         return false;
     }
-    
+
     // Validate SHA format (basic check)
     if (treeSHA.length() != 40) {
         cerr << "Error: Invalid SHA format\n";
         return false;
     }
-    
-    lsTree(treeSHA, nameOnly);
-    return true;
-}
\ No newline at end of file
+
+    return lsTree(treeSHA, options);
+}
@@ -10,18 +10,27 @@ namespace fs = filesystem;
 
 
 
-bool isValidSHA1(const string& sha) {
-    // Check if the SHA is exactly 40 characters long and is hexadecimal
-    return sha.size() == 40 && regex_match(sha, regex("^[a-fA-F0-9]{40}$"));
-}
+int runCommand(int argc, char* argv[]) {
+    if (argc < 2) {
+        cerr << "Error: No command provided.\n";
+        return 1;
+    }
 
-int main(int argc, char* argv[]) {
+    // --stats goes before the command name; strip it before commands parse arguments
+    extractStatsOption(argc, argv);
     if (argc < 2) {
         cerr << "Error: No command provided.\n";
         return 1;
     }
 
     const string command = argv[1];
+
+    // Whole-command span for MYGIT_TRACE2. The name is created before the
+    // trace is initialized so it outlives the exit-time flush.
+    static const string commandSpanName = "mygit " + command;
+    initializeTrace();
+    TraceSpan commandSpan(commandSpanName.c_str());
+
     if (command == "init") {
         if (argc != 2) {
             cerr << "Usage: .mygit init\n";
@@ -33,7 +42,7 @@ int main(int argc, char* argv[]) {
         if (!success) {
             cerr << "Error: Failed to initialize the git directory or the git is already initialized./\n";
         } else {
-            cout << "Git directory created successfully\n";
+            standardOutput() << "Git directory created successfully\n";
         }
     }
    
@@ -59,6 +68,12 @@ int main(int argc, char* argv[]) {
         }
     }
     else if (command == "cat-file") {
+        if (argc >= 3 && string(argv[2]).rfind("--batch", 0) == 0) {
+            if (!handleCatFileBatch(argc, argv)) {
+                return 1;
+            }
+            return 0;
+        }
         if (argc < 4) {
             cerr << "Usage: .mygit cat-file <options> <SHA>\n";
             return 1;
@@ -99,40 +114,27 @@ int main(int argc, char* argv[]) {
     }
     else if (command == "write-tree") 
    {
-    if (argc != 2) {
-        cerr << "Usage: ./mygit write-tree\n";
+    bool verbose = argc == 3 && (string(argv[2]) == "-v" || string(argv[2]) == "--verbose");
+    if (argc != 2 && !verbose) {
+        cerr << "Usage: ./mygit write-tree [-v]\n";
         return 1;
     } 
     else {
         fs::path rootDir = fs::current_path();
-        cout << "Creating tree structure for: " << rootDir << '\n';
 
-        
-        string rootTreeHash = writeTree(rootDir);
-        cout << "Root tree hash: " << rootTreeHash << '\n';
+        // Subdirectories are written in parallel; -v reports each one
+        string rootTreeHash = writeTree(rootDir, verbose);
+        if (rootTreeHash.empty()) {
+            return 1;
+        }
+        standardOutput() << "Root tree hash: " << rootTreeHash << '\n';
     }
   }
    else if (command == "ls-tree") 
    {
-   if (argc > 4) {
-        cerr << "Error: Too many arguments. Usage: ./mygit ls-tree [--name-only] <tree_sha>" << endl;
-        return 1;
-    }
-
-    if (argc < 3) {
-        cerr << "Error: Missing arguments. Usage: ./mygit ls-tree [--name-only] <tree_sha>" << endl;
+    if (!handleLsTree(argc, argv)) {
         return 1;
     }
-
-    bool nameOnly = false;
-    string treeSHA; 
-    if (string(argv[2]) == "--name-only") {
-        nameOnly = true;
-        treeSHA = argv[3];
-    } else {
-        treeSHA = argv[2];
-    }
-    lsTree(treeSHA, nameOnly);
   }
   else  if (command=="commit") {
         if(argc<2||argc >4)
@@ -145,11 +147,9 @@ int main(int argc, char* argv[]) {
 
     else if (command=="log")
     {
-        if(argc!=2)
-        {
-            cerr<<"Usage: "<<argv[0]<<" "<<"log"<<endl;
+        if (!handleLog(argc, argv)) {
+            return 1;
         }
-        return handleLog(argc, argv);
     }
 
 
@@ -167,18 +167,7 @@ int main(int argc, char* argv[]) {
 
 
    else if (command == "checkout") {
-        if(argc < 3) {
-            cout << "Usage: ./mygit checkout <commit-sha>\n";
-            return 1;
-        }
-        
-        string commitSha = argv[2];
-        if (!isValidSHA1(commitSha)) {
-            cerr << "Error: Invalid commit SHA format.\n";
-            return 1;
-        }
-        
-        if (!checkout(commitSha)) {  // Now matches function name
+        if (!handleCheckout(argc, argv)) {
             return 1;
         }
     }
@@ -197,26 +186,92 @@ else if (command == "show") {
     }
 }
 
+else if (command == "commit-graph") {
+    if (!handleCommitGraph(argc, argv)) {
+        return 1;
+    }
+}
+
+else if (command == "fast-import") {
+    if (!handleFastImport(argc, argv)) {
+        return 1;
+    }
+}
+
+else if (command == "sparse-checkout") {
+    if (!handleSparseCheckout(argc, argv)) {
+        return 1;
+    }
+}
+
+else if (command == "config") {
+    if (!handleConfig(argc, argv)) {
+        return 1;
+    }
+}
+
+else if (command == "branch") {
+    if (!handleBranch(argc, argv)) {
+        return 1;
+    }
+}
+
+else if (command == "tag") {
+    if (!handleTag(argc, argv)) {
+        return 1;
+    }
+}
+
+else if (command == "pack-refs") {
+    if (!handlePackRefs(argc, argv)) {
+        return 1;
+    }
+}
+
+else if (command == "rev-parse") {
+    if (!handleRevParse(argc, argv)) {
+        return 1;
+    }
+}
+
+else if (command == "serve") {
+    if (!handleServe(argc, argv, runCommand)) {
+        return 1;
+    }
+}
+
 // Also add help command for better user experience:
 else if (command == "help" || command == "--help") {
-    cout << "MyGit - A simple Git implementation\n\n";
-    cout << "Available commands:\n";
-    cout << "  init                     - Initialize a new repository\n";
-    cout << "  add <file>              - Add file to staging area\n";
-    cout << "  commit [-m message]     - Create a new commit\n";
-    cout << "  status                  - Show working tree status\n";
-    cout << "  log                     - Show commit history\n";
-    cout << "  show [commit-sha]       - Show commit details and diff\n";
-    cout << "  checkout <commit-sha>   - Switch to a commit\n";
-    cout << "  reset [options]         - Reset changes\n";
-    cout << "    reset                 - Unstage all files\n";
-    cout << "    reset <file>          - Unstage specific file\n";
-    cout << "    reset --hard <sha>    - Reset to commit (destructive)\n";
-    cout << "  hash-object [-w] <file> - Create object from file\n";
-    cout << "  cat-file <options> <sha>- Show object contents\n";
-    cout << "  write-tree              - Create tree from index\n";
-    cout << "  ls-tree [--name-only] <tree-sha> - List tree contents\n";
-    cout << "\nFor more information on a specific command, try: mygit <command> --help\n";
+    OutputBuffer& out = standardOutput();
+    out << "MyGit - A simple Git implementation\n\n";
+    out << "Available commands:\n";
+    out << "  init                     - Initialize a new repository\n";
+    out << "  add <file>              - Add file to staging area\n";
+    out << "  commit [-m message]     - Create a new commit\n";
+    out << "  status                  - Show working tree status\n";
+    out << "  log [-n N] [--oneline]  - Show commit history\n";
+    out << "  show [--stat|--name-only|--name-status] [-U<n>] [-M] [-C] [commit-sha] - Show commit details and diff\n";
+    out << "  checkout [-b <new-branch>] <branch|commit> - Switch to a branch or commit\n";
+    out << "  branch [<name> [<commit>] | -d <name>] - List, create or delete branches\n";
+    out << "  tag [<name> [<commit>] | -d <name>] - List, create or delete tags\n";
+    out << "  pack-refs [--all]       - Move tags (and with --all, branches) into packed-refs\n";
+    out << "  rev-parse <revision>... - Print the commit id of a branch, tag or HEAD\n";
+    out << "  reset [options]         - Reset changes\n";
+    out << "    reset                 - Unstage all files\n";
+    out << "    reset <file>          - Unstage specific file\n";
+    out << "    reset --hard <sha>    - Reset to commit (destructive)\n";
+    out << "  hash-object [-w] <file> - Create object from file\n";
+    out << "  cat-file <options> <sha>- Show object contents\n";
+    out << "  cat-file --batch[-check] [--batch-all-objects] - Answer object ids read from stdin\n";
+    out << "  write-tree [-v]         - Create tree from working directory\n";
+    out << "  ls-tree [-r] [-t] [--long] [--name-only] <tree-sha> - List tree contents\n";
+    out << "  config <key> [value]    - Get or set a repository option\n";
+    out << "  sparse-checkout set <dir>... | list | disable - Check out only some directories\n";
+    out << "  commit-graph write      - Build or extend the commit-graph file\n";
+    out << "  fast-import             - Import history from a stream on stdin\n";
+    out << "  serve [--socket <path>] [--report|--stop] - Keep caches warm and run commands for clients\n";
+    out << "\nPut --stats (or --stats=json) before any command to print work counters on exit.\n";
+    out << "\nFor more information on a specific command, try: mygit <command> --help\n";
 }
     
      else {
@@ -227,3 +282,12 @@ else if (command == "help" || command == "--help") {
 
     return 0;
 }
+
+int main(int argc, char* argv[]) {
+    // Hand the command to a running "mygit serve" when there is one
+    int status;
+    if (runThroughServer(argc, argv, status)) {
+        return status;
+    }
+    return runCommand(argc, argv);
+}
@@ -0,0 +1,184 @@
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include "header.h"
+
+using namespace std;
+
+// Buffered output through write(2)
+//
+// Commands that print a lot (show, log, ls-tree, status, checkout) write
+// into one 64 KiB buffer. It reaches the descriptor when it fills up, when
+// flush() is called, and at exit. On a terminal each complete line is
+// written at once, so interactive output still appears as it is produced.
+// Numbers and hex ids are formatted by hand instead of through iostream
+// manipulators.
+
+const size_t OUTPUT_BUFFER_SIZE = 1 << 16;
+
+// "00" "01" ... "99", for formatting two digits at a time
+struct DigitPairs {
+    char text[200];
+    constexpr DigitPairs() : text() {
+        for (int i = 0; i < 100; i++) {
+            text[2 * i] = static_cast<char>('0' + i / 10);
+            text[2 * i + 1] = static_cast<char>('0' + i % 10);
+        }
+    }
+};
+constexpr DigitPairs DIGIT_PAIRS;
+
+// Write value's digits backwards ending at end; returns the first digit
+char* formatDecimal(unsigned long long value, char* end) {
+    while (value >= 100) {
+        const char* pair = DIGIT_PAIRS.text + 2 * (value % 100);
+        value /= 100;
+        *--end = pair[1];
+        *--end = pair[0];
+    }
+    if (value >= 10) {
+        const char* pair = DIGIT_PAIRS.text + 2 * value;
+        *--end = pair[1];
+        *--end = pair[0];
+    } else {
+        *--end = static_cast<char>('0' + value);
+    }
+    return end;
+}
+
+// Lowercase hex of length bytes into out (2 * length chars)
+void formatHex(const unsigned char* bytes, size_t length, char* out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < length; i++) {
+        out[2 * i] = digits[bytes[i] >> 4];
+        out[2 * i + 1] = digits[bytes[i] & 0x0F];
+    }
+}
+
+OutputBuffer::OutputBuffer(int fd) : fd(fd), lineBuffered(isatty(fd)), buffer(OUTPUT_BUFFER_SIZE) {}
+
+OutputBuffer::~OutputBuffer() {
+    flush();
+}
+
+void OutputBuffer::flush() {
+    const char* data = buffer.data();
+    size_t remaining = used;
+    used = 0;
+    while (remaining > 0 && !failed) {
+        ssize_t written = ::write(fd, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            failed = true; // closed pipe or full disk: drop the rest
+            break;
+        }
+        data += written;
+        remaining -= static_cast<size_t>(written);
+    }
+}
+
+void OutputBuffer::write(const char* data, size_t length) {
+    if (length > buffer.size() - used) {
+        flush();
+        if (length >= buffer.size()) {
+            // Too big to buffer: write straight through
+            while (length > 0 && !failed) {
+                ssize_t written = ::write(fd, data, length);
+                if (written < 0) {
+                    if (errno == EINTR) continue;
+                    failed = true;
+                    break;
+                }
+                data += written;
+                length -= static_cast<size_t>(written);
+            }
+            return;
+        }
+    }
+    memcpy(buffer.data() + used, data, length);
+    used += length;
+    if (lineBuffered && memchr(data, '\n', length)) flush();
+}
+
+void OutputBuffer::writeNumber(unsigned long long value, size_t width, char fill) {
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* start = formatDecimal(value, end);
+    for (size_t length = end - start; length < width; length++) *this << fill;
+    write(start, end - start);
+}
+
+void OutputBuffer::writePadded(string_view text, size_t width) {
+    write(text.data(), text.size());
+    for (size_t length = text.size(); length < width; length++) *this << ' ';
+}
+
+void OutputBuffer::writeHex(const unsigned char* bytes, size_t length) {
+    char chunk[128];
+    while (length > 0) {
+        size_t count = min(length, sizeof(chunk) / 2);
+        formatHex(bytes, count, chunk);
+        write(chunk, 2 * count);
+        bytes += count;
+        length -= count;
+    }
+}
+
+void OutputBuffer::writeSigned(long long value) {
+    if (value < 0) {
+        *this << '-';
+        writeNumber(0ULL - static_cast<unsigned long long>(value));
+    } else {
+        writeNumber(static_cast<unsigned long long>(value));
+    }
+}
+
+OutputBuffer& OutputBuffer::operator<<(string_view text) {
+    write(text.data(), text.size());
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::operator<<(char c) {
+    if (used == buffer.size()) flush();
+    buffer[used++] = c;
+    if (lineBuffered && c == '\n') flush();
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::operator<<(int value) {
+    writeSigned(value);
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::operator<<(long value) {
+    writeSigned(value);
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::operator<<(long long value) {
+    writeSigned(value);
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::operator<<(unsigned value) {
+    writeNumber(value);
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::operator<<(unsigned long value) {
+    writeNumber(value);
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::operator<<(unsigned long long value) {
+    writeNumber(value);
+    return *this;
+}
+
+// Buffered stdout, flushed when the process exits
+OutputBuffer& standardOutput() {
+    static OutputBuffer output(STDOUT_FILENO);
+    return output;
+}
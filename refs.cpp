@@ -0,0 +1,502 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "header.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+// Branches, tags and HEAD
+//
+// A ref is a name under refs/ ("refs/heads/master", "refs/tags/v1.0")
+// holding a commit id. It is stored either as a loose file .mygit/<name>
+// containing "<id>\n", or as a line "<id> <name>" of .mygit/packed-refs,
+// whose lines are sorted by name. A loose ref overrides a packed one of the
+// same name.
+//
+// Lookups try the loose file, then binary-search packed-refs, which is
+// mapped into memory once per process and remapped only when it changes.
+// A lookup costs one failed open plus O(log n) compares, however many tags
+// there are. Updates write a single loose file through "<name>.lock", so
+// their cost does not depend on the number of refs either. pack-refs moves
+// loose refs into packed-refs.
+//
+// HEAD is either symbolic, "ref: refs/heads/<branch>", and then follows
+// that branch, or detached, holding a commit id. An empty HEAD (as written
+// by older versions before the first commit) is on master.
+
+const string PACKED_REFS_HEADER = "# pack-refs with: sorted\n";
+const string SYMBOLIC_REF_PREFIX = "ref: ";
+const string DEFAULT_BRANCH_REF = "refs/heads/master";
+const string NULL_OBJECT_ID(40, '0');
+
+// First line of a small file, without the newline; false if it cannot be read
+bool readRefFile(const string& path, string& line) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    char buffer[512];
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    if (length < 0) return false;
+    line.assign(buffer, static_cast<size_t>(length));
+    size_t newline = line.find('\n');
+    if (newline != string::npos) line.resize(newline);
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+    return true;
+}
+
+// Replace path with content through path.lock, so readers see either the
+// old or the new file. With expectedOld set, the current value (read by
+// currentValue while the lock is held) must match it; NULL_OBJECT_ID means
+// the ref must not exist yet.
+bool replaceRefFile(const string& path, const string& content, const string& expectedOld,
+                    const function<string()>& currentValue, string& error) {
+    string lockPath = path + ".lock";
+    int fd = open(lockPath.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno == ENOENT) {
+        error_code ec;
+        fs::create_directories(fs::path(path).parent_path(), ec);
+        fd = open(lockPath.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    }
+    if (fd < 0) {
+        error = errno == EEXIST ? "Cannot lock " + path + ": " + lockPath + " exists (another mygit running?)"
+                                : "Cannot create " + lockPath;
+        return false;
+    }
+
+    bool ok = true;
+    if (!expectedOld.empty()) {
+        string current = currentValue();
+        if (current.empty()) current = NULL_OBJECT_ID;
+        if (current != expectedOld) {
+            error = expectedOld == NULL_OBJECT_ID ? path + " already exists" : path + " was changed by another process";
+            ok = false;
+        }
+    }
+    if (ok && !writeAll(fd, content.data(), content.size())) {
+        error = "Cannot write " + lockPath;
+        ok = false;
+    }
+    if (close(fd) != 0 && ok) {
+        error = "Cannot write " + lockPath;
+        ok = false;
+    }
+    if (ok && rename(lockPath.c_str(), path.c_str()) != 0) {
+        error = "Cannot update " + path;
+        ok = false;
+    }
+    if (!ok) unlink(lockPath.c_str());
+    return ok;
+}
+
+// Whether name is usable as a ref: no empty or dot-leading components, no
+// "..", "@{", ".lock" suffix, spaces, control or glob characters
+bool isValidRefName(const string& name) {
+    if (name.empty() || name.back() == '/' || name.back() == '.') return false;
+    if (name.find("..") != string::npos || name.find("@{") != string::npos) return false;
+    if (name.size() >= 5 && name.compare(name.size() - 5, 5, ".lock") == 0) return false;
+    bool componentStart = true;
+    for (char c : name) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (byte <= ' ' || byte == 0x7f || strchr("~^:?*[\\", c)) return false;
+        if (componentStart && (c == '/' || c == '.')) return false;
+        componentStart = c == '/';
+    }
+    return true;
+}
+
+// packed-refs mapped into memory; body holds the sorted "<id> <name>" lines
+struct PackedRefs {
+    const char* data = nullptr;
+    size_t size = 0;
+    size_t bodyStart = 0;
+    ino_t inode = 0;
+    off_t fileSize = 0;
+    long long mtimeNs = 0;
+
+    PackedRefs() = default;
+    PackedRefs(const PackedRefs&) = delete;
+    PackedRefs& operator=(const PackedRefs&) = delete;
+    ~PackedRefs() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+
+    bool matches(const struct stat& info) const {
+        return inode == info.st_ino && fileSize == info.st_size &&
+               mtimeNs == static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+    }
+};
+
+shared_ptr<const PackedRefs> mapPackedRefs(const string& path) {
+    auto packed = make_shared<PackedRefs>();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return packed;
+    struct stat info;
+    if (fstat(fd, &info) == 0) {
+        packed->inode = info.st_ino;
+        packed->fileSize = info.st_size;
+        packed->mtimeNs = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+        if (info.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                packed->data = static_cast<const char*>(mapped);
+                packed->size = static_cast<size_t>(info.st_size);
+            }
+        }
+    }
+    close(fd);
+
+    // Header lines come first
+    while (packed->bodyStart < packed->size && packed->data[packed->bodyStart] == '#') {
+        const void* newline = memchr(packed->data + packed->bodyStart, '\n', packed->size - packed->bodyStart);
+        packed->bodyStart = newline ? static_cast<const char*>(newline) - packed->data + 1 : packed->size;
+    }
+    return packed;
+}
+
+// The packed-refs of gitDir, remapped when the file has been replaced.
+// Callers keep the returned mapping alive for as long as they read it.
+shared_ptr<const PackedRefs> loadPackedRefs(const string& gitDir) {
+    static mutex lock;
+    static auto& cache = *new map<string, shared_ptr<const PackedRefs>>; // never freed, so forked commands exit without touching it
+    string path = gitDir + "/packed-refs";
+    struct stat info;
+    bool exists = stat(path.c_str(), &info) == 0;
+
+    lock_guard<mutex> guard(lock);
+    shared_ptr<const PackedRefs>& cached = cache[path];
+    if (cached && (exists ? cached->matches(info) : cached->inode == 0)) return cached;
+    cached = mapPackedRefs(path);
+    return cached;
+}
+
+// Id and name of the line starting at pos; next is the start of the next line
+void parsePackedLine(const PackedRefs& packed, size_t pos, string_view& id, string_view& name, size_t& next) {
+    const char* line = packed.data + pos;
+    const void* newline = memchr(line, '\n', packed.size - pos);
+    size_t length = newline ? static_cast<const char*>(newline) - line : packed.size - pos;
+    next = pos + length + 1;
+    if (length < 42 || line[40] != ' ') {
+        id = {};
+        name = {};
+        return;
+    }
+    id = string_view(line, 40);
+    name = string_view(line + 41, length - 41);
+}
+
+// Start of the first line whose name is not less than name
+size_t packedRefLowerBound(const PackedRefs& packed, string_view name) {
+    size_t low = packed.bodyStart;
+    size_t high = packed.size;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        while (mid > low && packed.data[mid - 1] != '\n') mid--;
+        string_view lineId, lineName;
+        size_t next;
+        parsePackedLine(packed, mid, lineId, lineName, next);
+        if (lineName < name) {
+            low = min(next, packed.size);
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool findPackedRef(const PackedRefs& packed, string_view refName, string& commitHash) {
+    size_t pos = packedRefLowerBound(packed, refName);
+    if (pos >= packed.size) return false;
+    string_view id, name;
+    size_t next;
+    parsePackedLine(packed, pos, id, name, next);
+    if (name != refName) return false;
+    commitHash.assign(id);
+    return true;
+}
+
+// Commit id of a full ref name; false if the ref does not exist
+bool readRef(const string& refName, string& commitHash, const string& gitDir) {
+    string line;
+    if (readRefFile(gitDir + "/" + refName, line)) {
+        if (!isValidSHA1(line)) return false;
+        commitHash = line;
+        return true;
+    }
+    return findPackedRef(*loadPackedRefs(gitDir), refName, commitHash);
+}
+
+string readRefOrEmpty(const string& refName, const string& gitDir) {
+    string commitHash;
+    readRef(refName, commitHash, gitDir);
+    return commitHash;
+}
+
+// Point refName at commitHash. With oldHash set the update only happens if
+// the ref still holds oldHash (NULL_OBJECT_ID: if it does not exist yet).
+bool updateRef(const string& refName, const string& commitHash, const string& oldHash, string& error) {
+    if (!isValidRefName(refName) || refName.compare(0, 5, "refs/") != 0) {
+        error = "Invalid ref name '" + refName + "'";
+        return false;
+    }
+    return replaceRefFile(".mygit/" + refName, commitHash + "\n", oldHash,
+                          [&refName]() { return readRefOrEmpty(refName, ".mygit"); }, error);
+}
+
+// Remove a ref, both its loose file and its packed-refs line
+bool deleteRef(const string& refName, string& error) {
+    shared_ptr<const PackedRefs> packed = loadPackedRefs(".mygit");
+    size_t pos = packedRefLowerBound(*packed, refName);
+    string_view id, name;
+    size_t next = pos;
+    if (pos < packed->size) parsePackedLine(*packed, pos, id, name, next);
+    bool inPacked = pos < packed->size && name == refName;
+
+    // The packed line goes first, so the ref never reappears with an older value
+    if (inPacked) {
+        string content(packed->data, pos);
+        if (next < packed->size) content.append(packed->data + next, packed->size - next);
+        if (!replaceRefFile(".mygit/packed-refs", content, "", nullptr, error)) return false;
+    }
+
+    string path = ".mygit/" + refName;
+    if (unlink(path.c_str()) == 0) return true;
+    if (errno != ENOENT) {
+        error = "Cannot remove " + path;
+        return false;
+    }
+    if (!inPacked) {
+        error = "Ref '" + refName + "' not found";
+        return false;
+    }
+    return true;
+}
+
+// All refs whose names start with prefix ("refs/tags/"), loose ones
+// overriding packed ones
+map<string, string> listRefs(const string& prefix, const string& gitDir) {
+    map<string, string> refs;
+    shared_ptr<const PackedRefs> packed = loadPackedRefs(gitDir);
+    for (size_t pos = packedRefLowerBound(*packed, prefix); pos < packed->size;) {
+        string_view id, name;
+        size_t next;
+        parsePackedLine(*packed, pos, id, name, next);
+        if (name.compare(0, prefix.size(), prefix) != 0) break;
+        refs[string(name)] = string(id);
+        pos = next;
+    }
+
+    error_code ec;
+    fs::path looseRoot = fs::path(gitDir) / prefix;
+    if (!fs::is_directory(looseRoot, ec)) return refs;
+    for (auto it = fs::recursive_directory_iterator(looseRoot, ec); !ec && it != fs::recursive_directory_iterator();
+         it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        string name = prefix + fs::relative(it->path(), looseRoot, ec).generic_string();
+        if (name.size() >= 5 && name.compare(name.size() - 5, 5, ".lock") == 0) continue;
+        string line;
+        if (readRefFile(it->path().string(), line) && isValidSHA1(line)) refs[name] = line;
+    }
+    return refs;
+}
+
+// Move loose refs into packed-refs: tags and refs that are already packed,
+// plus branches with all. Branch tips change often, so by default they stay
+// loose, where an update rewrites one small file.
+bool packRefs(bool all, size_t& packedCount, string& error) {
+    map<string, string> refs = listRefs("refs/", ".mygit");
+    shared_ptr<const PackedRefs> packed = loadPackedRefs(".mygit");
+
+    string content = PACKED_REFS_HEADER;
+    vector<pair<string, string>> loosePacked;
+    packedCount = 0;
+    for (const auto& [name, id] : refs) {
+        string packedId;
+        bool wasPacked = findPackedRef(*packed, name, packedId);
+        if (!all && !wasPacked && name.compare(0, 10, "refs/tags/") != 0) continue;
+        content += id + " " + name + "\n";
+        packedCount++;
+        string line;
+        if (readRefFile(".mygit/" + name, line)) loosePacked.push_back({name, id});
+    }
+    if (!replaceRefFile(".mygit/packed-refs", content, "", nullptr, error)) return false;
+
+    // Loose files that still hold the packed value are now redundant
+    for (const auto& [name, id] : loosePacked) {
+        string path = ".mygit/" + name;
+        string line;
+        if (readRefFile(path, line) && line == id) unlink(path.c_str());
+    }
+    return true;
+}
+
+// Branch HEAD is on ("refs/heads/master"), or "" when HEAD is detached
+string currentBranch(const string& gitDir) {
+    string head;
+    readRefFile(gitDir + "/HEAD", head);
+    if (head.empty()) return DEFAULT_BRANCH_REF;
+    if (head.compare(0, SYMBOLIC_REF_PREFIX.size(), SYMBOLIC_REF_PREFIX) == 0) {
+        return head.substr(SYMBOLIC_REF_PREFIX.size());
+    }
+    return "";
+}
+
+// Commit HEAD resolves to; "" before the first commit
+string readHEAD(const string& gitDir) {
+    string head;
+    readRefFile(gitDir + "/HEAD", head);
+    if (isValidSHA1(head)) return head;
+    string branch = currentBranch(gitDir);
+    return branch.empty() ? "" : readRefOrEmpty(branch, gitDir);
+}
+
+// Move HEAD to commitHash: the current branch when HEAD is symbolic, HEAD
+// itself when detached. oldHash guards against concurrent updates.
+bool writeHEAD(const string& commitHash, const string& oldHash) {
+    string error;
+    string branch = currentBranch(".mygit");
+    bool ok = branch.empty() ? replaceRefFile(".mygit/HEAD", commitHash + "\n", oldHash,
+                                              []() { return readHEAD(".mygit"); }, error)
+                             : updateRef(branch, commitHash, oldHash, error);
+    if (!ok) cerr << "Error: " << error << "\n";
+    return ok;
+}
+
+bool setSymbolicHEAD(const string& refName, string& error) {
+    return replaceRefFile(".mygit/HEAD", SYMBOLIC_REF_PREFIX + refName + "\n", "", nullptr, error);
+}
+
+bool detachHEAD(const string& commitHash, string& error) {
+    return replaceRefFile(".mygit/HEAD", commitHash + "\n", "", nullptr, error);
+}
+
+// Full commit id for a revision: an id, HEAD, a full ref name, a tag or a
+// branch (in that order, as in git); "" if nothing matches
+string resolveRevision(const string& name) {
+    if (isValidSHA1(name)) return name;
+    if (name == "HEAD") return readHEAD(".mygit");
+    string commitHash;
+    for (const char* prefix : {"", "refs/", "refs/tags/", "refs/heads/"}) {
+        string refName = prefix + name;
+        if (refName.compare(0, 5, "refs/") != 0 || !isValidRefName(refName)) continue;
+        if (readRef(refName, commitHash, ".mygit")) return commitHash;
+    }
+    return "";
+}
+
+// branch and tag share everything but the namespace and the listing format
+bool handleRefCommand(int argc, char* argv[], const string& kind, const string& prefix) {
+    const string usage = "Usage: mygit " + kind + " [<name> [<commit>] | -d <name>]\n";
+    if (!fs::exists(".mygit")) {
+        cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
+        return false;
+    }
+
+    if (argc == 2) {
+        OutputBuffer& out = standardOutput();
+        string current = prefix == "refs/heads/" ? currentBranch(".mygit") : "";
+        for (const auto& entry : listRefs(prefix, ".mygit")) {
+            if (prefix == "refs/heads/") out << (entry.first == current ? "* " : "  ");
+            out << string_view(entry.first).substr(prefix.size()) << "\n";
+        }
+        return true;
+    }
+
+    string arg = argv[2];
+    string error;
+    if (arg == "-d" || arg == "--delete") {
+        if (argc != 4) {
+            cerr << usage;
+            return false;
+        }
+        string refName = prefix + argv[3];
+        if (refName == currentBranch(".mygit")) {
+            cerr << "Error: Cannot delete branch '" << argv[3] << "': HEAD is on it\n";
+            return false;
+        }
+        if (!deleteRef(refName, error)) {
+            cerr << "Error: " << error << "\n";
+            return false;
+        }
+        standardOutput() << "Deleted " << kind << " " << argv[3] << "\n";
+        return true;
+    }
+
+    if (arg[0] == '-' || argc > 4) {
+        cerr << usage;
+        return false;
+    }
+    string refName = prefix + arg;
+    if (!isValidRefName(refName)) {
+        cerr << "Error: '" << arg << "' is not a valid " << kind << " name\n";
+        return false;
+    }
+    string start = argc == 4 ? argv[3] : "HEAD";
+    string commitHash = resolveRevision(start);
+    string type;
+    size_t size;
+    if (commitHash.empty() || !readObjectHeader(commitHash, type, size) || type != "commit") {
+        cerr << "Error: Not a valid commit: " << start << "\n";
+        return false;
+    }
+    if (!updateRef(refName, commitHash, NULL_OBJECT_ID, error)) {
+        cerr << "Error: " << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool handleBranch(int argc, char* argv[]) {
+    return handleRefCommand(argc, argv, "branch", "refs/heads/");
+}
+
+bool handleTag(int argc, char* argv[]) {
+    return handleRefCommand(argc, argv, "tag", "refs/tags/");
+}
+
+bool handlePackRefs(int argc, char* argv[]) {
+    if (!fs::exists(".mygit")) {
+        cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
+        return false;
+    }
+    bool all = argc == 3 && string(argv[2]) == "--all";
+    if (argc > 3 || (argc == 3 && !all)) {
+        cerr << "Usage: mygit pack-refs [--all]\n";
+        return false;
+    }
+    size_t packedCount;
+    string error;
+    if (!packRefs(all, packedCount, error)) {
+        cerr << "Error: " << error << "\n";
+        return false;
+    }
+    standardOutput() << "Packed " << packedCount << " ref" << (packedCount == 1 ? "" : "s") << "\n";
+    return true;
+}
+
+bool handleRevParse(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: mygit rev-parse <revision>...\n";
+        return false;
+    }
+    OutputBuffer& out = standardOutput();
+    for (int i = 2; i < argc; i++) {
+        string commitHash = resolveRevision(argv[i]);
+        if (commitHash.empty()) {
+            cerr << "Error: Unknown revision '" << argv[i] << "'\n";
+            return false;
+        }
+        out << commitHash << "\n";
+    }
+    return true;
+}
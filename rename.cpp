@@ -0,0 +1,210 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include "header.h"
+
+using namespace std;
+
+// Rename and copy detection for tree diffs
+//
+// Exact renames are paired by blob id without reading any content. The
+// remaining added files are compared with the deleted ones (and with the
+// old side of modified files when copies are wanted) through fingerprints.
+// A fingerprint maps the hash of each line to its byte count; long lines
+// are cut every 64 bytes so binary files fingerprint too. Similarity is the
+// number of shared bytes over the size of the larger file, as in git. If
+// sources x destinations exceeds renameLimit squared, or inexactRenames is
+// off, only exact matches are reported.
+
+// Longest span hashed as one fingerprint piece
+const size_t FINGERPRINT_SPAN = 64;
+
+// Hash of a span -> bytes of content in spans with that hash
+struct Fingerprint {
+    vector<pair<uint32_t, uint32_t>> spans; // sorted by hash
+    size_t size = 0;
+};
+
+uint32_t hashSpan(const char* data, size_t length) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+    }
+    return hash;
+}
+
+Fingerprint computeFingerprint(string_view content) {
+    Fingerprint fingerprint;
+    fingerprint.size = content.size();
+
+    unordered_map<uint32_t, uint32_t> counts;
+    size_t start = 0;
+    while (start < content.size()) {
+        size_t limit = min(content.size() - start, FINGERPRINT_SPAN);
+        const void* newline = memchr(content.data() + start, '\n', limit);
+        size_t length = newline ? static_cast<const char*>(newline) - (content.data() + start) + 1 : limit;
+        counts[hashSpan(content.data() + start, length)] += static_cast<uint32_t>(length);
+        start += length;
+    }
+
+    fingerprint.spans.assign(counts.begin(), counts.end());
+    sort(fingerprint.spans.begin(), fingerprint.spans.end());
+    return fingerprint;
+}
+
+// Similarity in percent: shared bytes over the larger size
+int fingerprintSimilarity(const Fingerprint& a, const Fingerprint& b) {
+    size_t larger = max(a.size, b.size);
+    if (larger == 0) return 100;
+
+    size_t shared = 0;
+    auto i = a.spans.begin(), j = b.spans.begin();
+    while (i != a.spans.end() && j != b.spans.end()) {
+        if (i->first < j->first) {
+            ++i;
+        } else if (j->first < i->first) {
+            ++j;
+        } else {
+            shared += min(i->second, j->second);
+            ++i;
+            ++j;
+        }
+    }
+    return static_cast<int>(shared * 100 / larger);
+}
+
+// Keep the changes not marked in dropped
+void dropChanges(vector<TreeChange>& changes, const vector<bool>& dropped) {
+    vector<TreeChange> kept;
+    kept.reserve(changes.size());
+    for (size_t i = 0; i < changes.size(); i++) {
+        if (!dropped[i]) kept.push_back(move(changes[i]));
+    }
+    changes = move(kept);
+}
+
+void detectRenames(vector<TreeChange>& changes, const DiffOptions& options) {
+    if (!options.detectRenames) return;
+    TraceSpan span("detectRenames");
+
+    // Sources: deleted files, plus modified files' old side for copies
+    vector<size_t> deleted, added, modified;
+    for (size_t i = 0; i < changes.size(); i++) {
+        if (changes[i].status == 'D') deleted.push_back(i);
+        else if (changes[i].status == 'A') added.push_back(i);
+        else if (changes[i].status == 'M') modified.push_back(i);
+    }
+    if (added.empty() || (deleted.empty() && !options.detectCopies)) return;
+
+    vector<bool> removed(changes.size(), false);   // deletions turned into renames
+    vector<bool> paired(changes.size(), false);    // additions that found a source
+
+    auto pairUp = [&](size_t destination, size_t source, int similarity) {
+        TreeChange& change = changes[destination];
+        const TreeChange& from = changes[source];
+        bool rename = from.status == 'D' && !removed[source];
+        change.status = rename ? 'R' : 'C';
+        change.oldPath = from.oldPath;
+        change.oldMode = from.oldMode;
+        change.oldSha = from.oldSha;
+        change.similarity = similarity;
+        paired[destination] = true;
+        if (rename) removed[source] = true;
+    };
+
+    // Exact matches by blob id
+    unordered_map<string, vector<size_t>> sourcesById;
+    for (size_t i : deleted) sourcesById[changes[i].oldSha].push_back(i);
+    if (options.detectCopies) {
+        for (size_t i : modified) sourcesById[changes[i].oldSha].push_back(i);
+    }
+    for (size_t destination : added) {
+        auto found = sourcesById.find(changes[destination].newSha);
+        if (found == sourcesById.end()) continue;
+        // Prefer a deletion not yet used, so a moved file reads as a rename
+        size_t source = found->second.front();
+        for (size_t candidate : found->second) {
+            if (changes[candidate].status == 'D' && !removed[candidate]) {
+                source = candidate;
+                break;
+            }
+        }
+        if (!options.detectCopies && removed[source]) continue;
+        pairUp(destination, source, 100);
+    }
+
+    // Inexact matches through fingerprints, within the rename limit
+    vector<size_t> destinations, sources;
+    for (size_t i : added) {
+        if (!paired[i]) destinations.push_back(i);
+    }
+    for (size_t i : deleted) {
+        if (!removed[i] || options.detectCopies) sources.push_back(i);
+    }
+    if (options.detectCopies) {
+        sources.insert(sources.end(), modified.begin(), modified.end());
+    }
+    if (destinations.empty() || sources.empty() || !options.inexactRenames) {
+        dropChanges(changes, removed);
+        return;
+    }
+
+    size_t limit = static_cast<size_t>(max(options.renameLimit, 0));
+    if (destinations.size() * sources.size() > limit * limit) {
+        cerr << "warning: inexact rename detection was skipped due to too many files ("
+             << destinations.size() << " added, " << sources.size() << " candidate sources; limit "
+             << limit << ")\n";
+    } else {
+        // Fingerprint every candidate once, in parallel
+        vector<size_t> candidates = destinations;
+        candidates.insert(candidates.end(), sources.begin(), sources.end());
+        vector<Fingerprint> fingerprints(candidates.size());
+        {
+            TaskGroup group(sharedThreadPool());
+            for (size_t k = 0; k < candidates.size(); k++) {
+                group.run([&, k]() {
+                    const TreeChange& change = changes[candidates[k]];
+                    bool isDestination = k < destinations.size();
+                    fingerprints[k] = computeFingerprint(readBlobContent(isDestination ? change.newSha : change.oldSha));
+                });
+            }
+            group.wait();
+        }
+
+        // Score all pairs over the threshold, then take the best first
+        struct RenameScore {
+            int similarity;
+            size_t destination, source;
+        };
+        vector<RenameScore> scores;
+        for (size_t d = 0; d < destinations.size(); d++) {
+            const Fingerprint& target = fingerprints[d];
+            for (size_t s = 0; s < sources.size(); s++) {
+                const Fingerprint& origin = fingerprints[destinations.size() + s];
+                // Files whose sizes alone rule out the threshold are skipped
+                size_t smaller = min(target.size, origin.size), larger = max(target.size, origin.size);
+                if (larger > 0 && smaller * 100 < larger * static_cast<size_t>(options.renameThreshold)) continue;
+
+                int similarity = fingerprintSimilarity(target, origin);
+                if (similarity >= options.renameThreshold) {
+                    scores.push_back({similarity, destinations[d], sources[s]});
+                }
+            }
+        }
+        stable_sort(scores.begin(), scores.end(),
+                    [](const RenameScore& a, const RenameScore& b) { return a.similarity > b.similarity; });
+
+        for (const RenameScore& score : scores) {
+            if (paired[score.destination]) continue;
+            const TreeChange& source = changes[score.source];
+            if (source.status == 'D' && removed[score.source] && !options.detectCopies) continue;
+            pairUp(score.destination, score.source, min(score.similarity, 99));
+        }
+    }
+
+    dropChanges(changes, removed);
+}
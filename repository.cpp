@@ -0,0 +1,201 @@
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <memory>
+#include "header.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+// Repository handle (libmygit)
+//
+// The command-line tool works on the repository in the current directory
+// and reports problems on stderr. Programs that link libmygit use a
+// Repository instead: it is opened once from any path inside the working
+// tree, every call resolves paths against its .mygit directory, and
+// failures come back as a RepositoryError. Objects are read through the
+// same streaming inflater as the CLI. Tree contents and parsed commits are
+// cached per handle; they are content-addressed, so cached entries never go
+// stale. readTree parses into the caller's TreeArena, which keeps the
+// content alive for as long as the entries are used.
+// The caches are guarded by a mutex and object reads keep their inflate
+// state per thread, so a handle can be used from several threads at once.
+
+// Cached trees and commits kept per handle before the caches start over
+const size_t REPOSITORY_CACHE_LIMIT = 65536;
+
+RepositoryError repositoryError(RepositoryError::Code code, const string& message) {
+    RepositoryError error;
+    error.code = code;
+    error.message = message;
+    return error;
+}
+
+Repository::Repository(string root, string gitDirectory) : root(move(root)), gitDirectory(move(gitDirectory)) {}
+
+// Open the repository containing path (the directory or any parent with .mygit)
+RepositoryError Repository::open(const string& path, unique_ptr<Repository>& repository) {
+    error_code ec;
+    fs::path directory = fs::absolute(path, ec).lexically_normal();
+    if (ec) return repositoryError(RepositoryError::IO_ERROR, "Cannot resolve " + path);
+
+    while (true) {
+        if (fs::is_directory(directory / ".mygit" / "objects", ec)) {
+            repository.reset(new Repository(directory.string(), (directory / ".mygit").string()));
+            return {};
+        }
+        if (!directory.has_parent_path() || directory.parent_path() == directory) break;
+        directory = directory.parent_path();
+    }
+    return repositoryError(RepositoryError::NOT_A_REPOSITORY, "Not a mygit repository: " + path);
+}
+
+// Why an object could not be read: absent, or present but unreadable
+RepositoryError Repository::objectReadError(const string& id) const {
+    error_code ec;
+    string objectPath = gitDirectory + "/objects/" + id.substr(0, 2) + "/" + id.substr(2);
+    if (!fs::exists(objectPath, ec)) {
+        return repositoryError(RepositoryError::NOT_FOUND, "Object " + id + " not found");
+    }
+    return repositoryError(RepositoryError::CORRUPT, "Object " + id + " is corrupt");
+}
+
+RepositoryError Repository::readObject(const string& id, string& type, string& content) const {
+    if (!isValidSHA1(id)) return repositoryError(RepositoryError::INVALID_ARGUMENT, "Invalid object id " + id);
+
+    content.clear();
+    bool ok = streamObject(
+        id,
+        [&](const string& objectType, size_t size) {
+            type = objectType;
+            content.reserve(size);
+            return true;
+        },
+        [&content](const char* data, size_t length) {
+            content.append(data, length);
+            return true;
+        },
+        gitDirectory);
+    return ok ? RepositoryError() : objectReadError(id);
+}
+
+RepositoryError Repository::readObjectHeader(const string& id, string& type, size_t& size) const {
+    if (!isValidSHA1(id)) return repositoryError(RepositoryError::INVALID_ARGUMENT, "Invalid object id " + id);
+    return ::readObjectHeader(id, type, size, gitDirectory) ? RepositoryError() : objectReadError(id);
+}
+
+// Blob content in blocks, without holding the blob in memory
+RepositoryError Repository::streamBlob(const string& id, const function<bool(const char*, size_t)>& onData) const {
+    if (!isValidSHA1(id)) return repositoryError(RepositoryError::INVALID_ARGUMENT, "Invalid object id " + id);
+
+    bool isBlob = false, stopped = false;
+    bool ok = streamObject(
+        id,
+        [&isBlob](const string& type, size_t) {
+            isBlob = type == "blob";
+            return isBlob;
+        },
+        [&](const char* data, size_t length) {
+            if (onData(data, length)) return true;
+            stopped = true;
+            return false;
+        },
+        gitDirectory);
+    if (ok || stopped) return {};
+    if (!isBlob && objectReadError(id).code == RepositoryError::CORRUPT) {
+        string type;
+        size_t size;
+        if (::readObjectHeader(id, type, size, gitDirectory)) {
+            return repositoryError(RepositoryError::INVALID_ARGUMENT, "Object " + id + " is a " + type + ", not a blob");
+        }
+    }
+    return objectReadError(id);
+}
+
+RepositoryError Repository::writeObject(const string& type, const string& content, string& id) const {
+    if (type != "blob" && type != "tree" && type != "commit") {
+        return repositoryError(RepositoryError::INVALID_ARGUMENT, "Unknown object type " + type);
+    }
+    string object = type + " " + to_string(content.size()) + '\0' + content;
+    id = computeSHA1FromString(object);
+
+    string error;
+    if (!storeObject(gitDirectory, id, object, error)) {
+        return repositoryError(RepositoryError::IO_ERROR, error);
+    }
+    return {};
+}
+
+RepositoryError Repository::readTree(const string& id, TreeArena& arena, span<const TreeEntry>& entries) const {
+    shared_ptr<const string> content;
+    {
+        lock_guard<mutex> guard(cacheMutex);
+        auto cached = treeCache.find(id);
+        if (cached != treeCache.end()) content = cached->second;
+    }
+
+    if (!content) {
+        string type, data;
+        RepositoryError error = readObject(id, type, data);
+        if (error) return error;
+        if (type != "tree") return repositoryError(RepositoryError::INVALID_ARGUMENT, "Object " + id + " is not a tree");
+        content = make_shared<const string>(move(data));
+
+        lock_guard<mutex> guard(cacheMutex);
+        if (treeCache.size() >= REPOSITORY_CACHE_LIMIT) treeCache.clear();
+        treeCache.emplace(id, content);
+    }
+
+    if (!arena.parse(content, entries)) return repositoryError(RepositoryError::CORRUPT, "Tree " + id + " is corrupt");
+    return {};
+}
+
+RepositoryError Repository::readCommit(const string& id, CommitSummary& commit) const {
+    {
+        lock_guard<mutex> guard(cacheMutex);
+        auto cached = commitCache.find(id);
+        if (cached != commitCache.end()) {
+            commit = cached->second;
+            return {};
+        }
+    }
+
+    string type, content;
+    RepositoryError error = readObject(id, type, content);
+    if (error) return error;
+    if (type != "commit") return repositoryError(RepositoryError::INVALID_ARGUMENT, "Object " + id + " is not a commit");
+    if (!parseCommitSummary(id, content, commit)) {
+        return repositoryError(RepositoryError::CORRUPT, "Commit " + id + " is corrupt");
+    }
+
+    lock_guard<mutex> guard(cacheMutex);
+    if (commitCache.size() >= REPOSITORY_CACHE_LIMIT) commitCache.clear();
+    commitCache.emplace(id, commit);
+    return {};
+}
+
+// Commit HEAD points at; NOT_FOUND before the first commit
+RepositoryError Repository::resolveHead(string& commitId) const {
+    commitId = readHEAD(gitDirectory);
+    if (commitId.empty()) return repositoryError(RepositoryError::NOT_FOUND, "No commits yet");
+    return {};
+}
+
+// Staged entries sorted by path; empty when nothing has been staged
+RepositoryError Repository::readIndex(vector<IndexEntry>& entries) const {
+    string indexPath = gitDirectory + "/index";
+    entries.clear();
+    error_code ec;
+    if (!fs::exists(indexPath, ec)) return {};
+    if (!readIndexFile(indexPath, entries)) {
+        return repositoryError(RepositoryError::IO_ERROR, "Cannot read " + indexPath);
+    }
+    return {};
+}
+
+RepositoryError Repository::configValue(const string& key, string& value) const {
+    value = readConfigValue(key, gitDirectory);
+    if (value.empty()) return repositoryError(RepositoryError::NOT_FOUND, "Config key " + key + " is not set");
+    return {};
+}
@@ -13,61 +13,38 @@ using namespace std;
 
 // Remove a specific file from the index
 bool removeFromIndex(const string& filePath) {
-    ifstream indexFile(".mygit/index");
-    if (!indexFile) {
+    OutputBuffer& out = standardOutput();
+    TraceSpan span("removeFromIndex");
+    if (!fs::exists(".mygit/index")) {
         cerr << "Error: No index file found\n";
         return false;
     }
     
-    vector<string> indexLines;
-    string line;
-    bool found = false;
+    vector<IndexEntry> entries = loadIndex();
+    string target = normalizeRepoPath(filePath);
+    size_t before = entries.size();
     
-    // Read all lines except the one we want to remove
-    while (getline(indexFile, line)) {
-        if (line.empty()) continue;
-        
-        // Parse index format: "mode hash filename"
-        istringstream iss(line);
-        string mode, hash, filename;
-        iss >> mode >> hash;
-        
-        // Get the rest as filename
-        getline(iss, filename);
-        if (!filename.empty() && filename[0] == ' ') {
-            filename = filename.substr(1);
-        }
-        
-        if (filename != filePath) {
-            indexLines.push_back(line);
-        } else {
-            found = true;
-        }
-    }
-    indexFile.close();
+    entries.erase(remove_if(entries.begin(), entries.end(),
+                            [&target](const IndexEntry& e) { return e.path == target; }),
+                  entries.end());
     
-    if (!found) {
+    if (entries.size() == before) {
         cerr << "Error: '" << filePath << "' is not in the index\n";
         return false;
     }
     
     // Write back the modified index
-    ofstream outFile(".mygit/index");
-    if (!outFile) {
-        cerr << "Error: Cannot write to index file\n";
+    if (!storeIndex(entries)) {
         return false;
     }
     
-    for (const string& indexLine : indexLines) {
-        outFile << indexLine << "\n";
-    }
-    
-    cout << "Unstaged '" << filePath << "'\n";
+    out << "Unstaged '" << filePath << "'\n";
     return true;
 }
 
 // Reset to a specific commit (hard reset)
 bool resetToCommit(const string& commitSHA) {
+    OutputBuffer& out = standardOutput();
     // Validate commit exists
     if (!objectExists(commitSHA)) {
         cerr << "Error: Commit " << commitSHA << " does not exist\n";
@@ -81,67 +58,87 @@ bool resetToCommit(const string& commitSHA) {
         return false;
     }
     
-    cout << "Resetting to commit " << commitSHA << "\n";
+    out << "Resetting to commit " << commitSHA << "\n";
     
-    // Clear working directory
-    clearWorkingDirectory();
-    
-    // Restore files from the commit's tree
-    if (!restoreTree(treeSHA, ".")) {
+    // Rewrite only what differs from HEAD, then any locally modified files;
+    // the index is rebuilt from the commit's tree
+    string currentCommit = getCurrentCommit();
+    string currentTree = currentCommit.empty() ? "" : getTreeSHAFromCommit(currentCommit);
+    if (!checkoutTree(currentTree, treeSHA, true)) {
         cerr << "Error: Failed to restore files from commit\n";
         return false;
     }
     
-    // Clear the index (unstage everything)
-    clearIndex();
-    
     // Update HEAD to point to this commit
     writeHEAD(commitSHA);
     
-    cout << "HEAD is now at " << commitSHA.substr(0, 8) << "\n";
+    out << "HEAD is now at " << commitSHA.substr(0, 8) << "\n";
     return true;
 }
 
+// Mixed reset: make the index mirror a commit's tree without touching the
+// working tree. Stat data is kept for entries whose blob is unchanged, and
+// directories outside the sparse checkout stay skip-worktree entries.
+bool resetIndexToCommit(const string& commitSHA) {
+    if (commitSHA.empty()) return clearIndex(); // nothing committed yet
+
+    string treeSHA = getTreeSHAFromCommit(commitSHA);
+    if (treeSHA.empty()) {
+        cerr << "Error: Cannot extract tree from commit\n";
+        return false;
+    }
+
+    map<string, IndexEntry> index;
+    for (IndexEntry& entry : loadIndex()) {
+        string path = entry.path;
+        index[path] = move(entry);
+    }
+
+    map<string, string> targetFiles, targetModes;
+    vector<IndexEntry> newIndex;
+    collectSparseTree(treeSHA, "", loadSparseCheckout(), targetFiles, newIndex, &targetModes);
+    for (const auto& [path, blobSHA] : targetFiles) {
+        auto existing = index.find(path);
+        if (existing != index.end() && !existing->second.skipWorktree && existing->second.hash == blobSHA) {
+            newIndex.push_back(existing->second);
+            newIndex.back().mode = targetModes[path];
+            continue;
+        }
+        IndexEntry entry;
+        entry.mode = targetModes[path];
+        entry.hash = blobSHA;
+        entry.path = path;
+        newIndex.push_back(move(entry));
+    }
+    sort(newIndex.begin(), newIndex.end(),
+         [](const IndexEntry& a, const IndexEntry& b) { return a.path < b.path; });
+    return storeIndex(newIndex);
+}
+
 // Get files that are currently in the index
 map<string, string> getIndexedFiles() {
     map<string, string> indexedFiles;
-    
-    ifstream indexFile(".mygit/index");
-    if (!indexFile) {
-        return indexedFiles;
+    for (const IndexEntry& entry : loadIndex()) {
+        if (entry.skipWorktree) continue;
+        indexedFiles[entry.path] = entry.hash;
     }
-    
-    string line;
-    while (getline(indexFile, line)) {
-        if (line.empty()) continue;
-        
-        istringstream iss(line);
-        string mode, hash, filename;
-        iss >> mode >> hash;
-        
-        getline(iss, filename);
-        if (!filename.empty() && filename[0] == ' ') {
-            filename = filename.substr(1);
-        }
-        
-        if (!filename.empty()) {
-            indexedFiles[filename] = hash;
-        }
-    }
-    
     return indexedFiles;
 }
 
 // Reset specific files to HEAD (mixed reset for specific files)
 bool resetFilesToHEAD(const vector<string>& filePaths) {
+    OutputBuffer& out = standardOutput();
     string currentCommit = getCurrentCommit();
     if (currentCommit.empty()) {
         cerr << "Error: No commits found (cannot reset to HEAD)\n";
         return false;
     }
     
-    // Get files from current commit
-    map<string, string> committedFiles = getCommittedFiles();
+    // Get files, with their modes, from the current commit
+    map<string, string> committedFiles, committedModes;
+    vector<IndexEntry> skipped;
+    collectSparseTree(getTreeSHAFromCommit(currentCommit), "", SparseCheckout(), committedFiles, skipped,
+                      &committedModes);
     
     for (const string& filePath : filePaths) {
         // Check if file exists in current commit
@@ -158,9 +155,9 @@ bool resetFilesToHEAD(const vector<string>& filePaths) {
         
         // Add back to index with the committed version
         string commitHash = it->second;
-        addtoindex(filePath, commitHash);
+        addtoindex(filePath, commitHash, false, committedModes[it->first]);
         
-        cout << "Reset '" << filePath << "' to HEAD\n";
+        out << "Reset '" << filePath << "' to HEAD\n";
     }
     
     return true;
@@ -168,9 +165,10 @@ bool resetFilesToHEAD(const vector<string>& filePaths) {
 
 // Main reset function that handles different reset types
 bool reset(const vector<string>& args) {
+    OutputBuffer& out = standardOutput();
     if (args.empty()) {
-        // No arguments: unstage all files (git reset)
-        return clearIndex();
+        // No arguments: unstage all changes (git reset)
+        return resetIndexToCommit(getCurrentCommit());
     }
     
     // Check for --hard flag
@@ -184,6 +182,9 @@ bool reset(const vector<string>& args) {
         } else if (args[i].length() == 40 && objectExists(args[i])) {
             // Looks like a commit SHA
             commitSHA = args[i];
+        } else if (!fs::exists(args[i]) && !resolveRevision(args[i]).empty()) {
+            // A branch, tag or HEAD that is not also a file name
+            commitSHA = resolveRevision(args[i]);
         } else {
             // Assume it's a file path
             filePaths.push_back(args[i]);
@@ -202,10 +203,10 @@ bool reset(const vector<string>& args) {
     }
     
     if (!commitSHA.empty() && filePaths.empty()) {
-        // Soft/mixed reset to commit (just move HEAD and clear index)
-        writeHEAD(commitSHA);
-        clearIndex();
-        cout << "Reset HEAD to " << commitSHA.substr(0, 8) << "\n";
+        // Mixed reset to commit (move HEAD and reset the index to its tree)
+        if (!writeHEAD(commitSHA)) return false;
+        if (!resetIndexToCommit(commitSHA)) return false;
+        out << "Reset HEAD to " << commitSHA.substr(0, 8) << "\n";
         return true;
     }
     
@@ -218,8 +219,8 @@ bool reset(const vector<string>& args) {
         return resetFilesToHEAD(filePaths);
     }
     
-    // Default: clear index
-    return clearIndex();
+    // Default: reset the index to HEAD
+    return resetIndexToCommit(getCurrentCommit());
 }
 
 // Command handler for main.cpp integration
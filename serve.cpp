@@ -0,0 +1,595 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/signalfd.h>
+#include "header.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+// Resident server (mygit serve --socket <path>)
+//
+// The daemon keeps the parsed index, tree entries and the commit-graph in
+// memory and runs each command in a child forked from itself, so the child
+// starts with those caches already filled. A client sends its arguments
+// and working directory in one length-prefixed frame (4-byte big-endian
+// length, then NUL-terminated fields), with its stdin, stdout and stderr
+// attached as SCM_RIGHTS. The child writes straight to the client's
+// descriptors; the reply frame carries only the exit status. Requests from
+// another directory get "local" back and the client runs the command
+// itself. Between requests the daemon re-reads whatever changed on disk:
+// the index, the commit-graph, and the trees of a new HEAD.
+//
+// Request frames:  run <cwd> <argv...> | stats | stop
+// Reply frames:    exit <status> | local | stats <report> | stopping
+
+const string SERVE_SOCKET_PATH = ".mygit/serve.sock";
+
+// Largest frame either side accepts
+const uint32_t SERVE_MAX_FRAME = 1 << 20;
+
+// Power-of-two microsecond buckets; the last one also takes anything slower
+const int SERVE_LATENCY_BUCKETS = 32;
+
+// Idle time after which the daemon refreshes its caches anyway
+const int SERVE_IDLE_REFRESH_MS = 1000;
+
+bool residentCaches = false;
+
+// True in the daemon and the commands it forks
+bool residentCachesEnabled() {
+    return residentCaches;
+}
+
+// Socket the CLI connects to: MYGIT_SOCKET, or the default under .mygit
+string serverSocketPath() {
+    const char* env = getenv("MYGIT_SOCKET");
+    return env && *env ? env : SERVE_SOCKET_PATH;
+}
+
+bool makeSocketAddress(const string& path, sockaddr_un& address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return false;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+int connectToSocket(const string& path) {
+    sockaddr_un address;
+    if (!makeSocketAddress(path, address)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Send one frame, with descriptors attached to its first byte
+bool sendFrame(int fd, const string& payload, const int* fds = nullptr, size_t fdCount = 0) {
+    uint32_t length = htonl(static_cast<uint32_t>(payload.size()));
+    string frame(reinterpret_cast<const char*>(&length), sizeof(length));
+    frame += payload;
+
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        iovec io = {frame.data() + sent, frame.size() - sent};
+        msghdr message = {};
+        message.msg_iov = &io;
+        message.msg_iovlen = 1;
+
+        vector<char> control;
+        if (sent == 0 && fdCount > 0) {
+            control.assign(CMSG_SPACE(fdCount * sizeof(int)), 0);
+            message.msg_control = control.data();
+            message.msg_controllen = control.size();
+            cmsghdr* header = CMSG_FIRSTHDR(&message);
+            header->cmsg_level = SOL_SOCKET;
+            header->cmsg_type = SCM_RIGHTS;
+            header->cmsg_len = CMSG_LEN(fdCount * sizeof(int));
+            memcpy(CMSG_DATA(header), fds, fdCount * sizeof(int));
+        }
+
+        ssize_t written = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sent += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Receive one frame and any descriptors sent with it
+bool receiveFrame(int fd, string& payload, vector<int>& fds) {
+    char lengthBytes[4];
+    size_t received = 0;
+    while (received < sizeof(lengthBytes)) {
+        iovec io = {lengthBytes + received, sizeof(lengthBytes) - received};
+        char control[CMSG_SPACE(3 * sizeof(int))];
+        msghdr message = {};
+        message.msg_iov = &io;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        ssize_t count = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+            if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) continue;
+            size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; i++) {
+                int passed;
+                memcpy(&passed, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+                fds.push_back(passed);
+            }
+        }
+        received += static_cast<size_t>(count);
+    }
+
+    uint32_t length;
+    memcpy(&length, lengthBytes, sizeof(length));
+    length = ntohl(length);
+    if (length > SERVE_MAX_FRAME) return false;
+
+    payload.assign(length, '\0');
+    received = 0;
+    while (received < length) {
+        ssize_t count = read(fd, payload.data() + received, length - received);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        received += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+vector<string> splitFrameFields(const string& payload) {
+    vector<string> fields;
+    size_t start = 0;
+    while (start < payload.size()) {
+        size_t end = payload.find('\0', start);
+        if (end == string::npos) end = payload.size();
+        fields.push_back(payload.substr(start, end - start));
+        start = end + 1;
+    }
+    return fields;
+}
+
+string joinFrameFields(const vector<string>& fields) {
+    string payload;
+    for (const string& field : fields) {
+        payload += field;
+        payload += '\0';
+    }
+    return payload;
+}
+
+// Client side: run the command in a live daemon for this directory.
+// False if there is none (or it declined), so the caller runs it locally.
+bool runThroughServer(int argc, char* argv[], int& status) {
+    int commandIndex = 1;
+    while (commandIndex < argc && isStatsOption(argv[commandIndex])) commandIndex++;
+    if (commandIndex >= argc) return false;
+    string command = argv[commandIndex];
+    if (command == "serve" || command == "init" || getenv("MYGIT_NO_SERVER") || traceEnabled()) {
+        return false;
+    }
+
+    string path = serverSocketPath();
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0 || !S_ISSOCK(info.st_mode)) return false;
+    int fd = connectToSocket(path);
+    if (fd < 0) return false;
+
+    error_code ec;
+    vector<string> fields = {"run", fs::current_path(ec).string()};
+    for (int i = 0; i < argc; i++) fields.push_back(argv[i]);
+    int stdio[3] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO};
+    if (!sendFrame(fd, joinFrameFields(fields), stdio, 3)) {
+        close(fd);
+        return false;
+    }
+
+    // The command has been handed over; from here on it must not run twice
+    string reply;
+    vector<int> unused;
+    bool replied = receiveFrame(fd, reply, unused);
+    close(fd);
+    vector<string> answer = splitFrameFields(reply);
+    if (replied && answer.size() == 1 && answer[0] == "local") return false;
+    if (!replied || answer.size() != 2 || answer[0] != "exit") {
+        cerr << "Error: Lost connection to mygit serve at " << path << "\n";
+        status = 1;
+        return true;
+    }
+    status = atoi(answer[1].c_str());
+    return true;
+}
+
+// Request latencies of one command
+struct LatencyHistogram {
+    uint64_t buckets[SERVE_LATENCY_BUCKETS] = {};
+    uint64_t count = 0;
+    long long maxMicros = 0;
+};
+
+int latencyBucket(long long micros) {
+    int bucket = 0;
+    while (bucket < SERVE_LATENCY_BUCKETS - 1 && (1LL << bucket) <= micros) bucket++;
+    return bucket;
+}
+
+// Bucket i holds latencies below 2^i microseconds
+long long bucketLimitMicros(int bucket) {
+    return 1LL << bucket;
+}
+
+string formatMicros(long long micros) {
+    char text[32];
+    if (micros < 1000) snprintf(text, sizeof(text), "%lldus", micros);
+    else if (micros < 1000000) snprintf(text, sizeof(text), "%.1fms", micros / 1000.0);
+    else snprintf(text, sizeof(text), "%.2fs", micros / 1000000.0);
+    return text;
+}
+
+// Upper bound of the bucket holding the given fraction of requests
+long long latencyPercentile(const LatencyHistogram& histogram, double fraction) {
+    uint64_t wanted = static_cast<uint64_t>(fraction * histogram.count + 0.999999);
+    uint64_t seen = 0;
+    for (int i = 0; i < SERVE_LATENCY_BUCKETS; i++) {
+        seen += histogram.buckets[i];
+        if (seen >= wanted) return min(bucketLimitMicros(i), histogram.maxMicros);
+    }
+    return histogram.maxMicros;
+}
+
+string formatLatencyReport(const map<string, LatencyHistogram>& latencies) {
+    string report;
+    char line[160];
+    snprintf(line, sizeof(line), "%-16s %8s %9s %9s %9s %9s\n", "command", "requests", "p50", "p90", "p99", "max");
+    report += line;
+    for (const auto& [command, histogram] : latencies) {
+        snprintf(line, sizeof(line), "%-16s %8llu %9s %9s %9s %9s\n", command.c_str(),
+                 static_cast<unsigned long long>(histogram.count),
+                 formatMicros(latencyPercentile(histogram, 0.50)).c_str(),
+                 formatMicros(latencyPercentile(histogram, 0.90)).c_str(),
+                 formatMicros(latencyPercentile(histogram, 0.99)).c_str(),
+                 formatMicros(histogram.maxMicros).c_str());
+        report += line;
+    }
+
+    // One bar per non-empty bucket, scaled to the command's fullest bucket
+    for (const auto& [command, histogram] : latencies) {
+        report += "\n" + command + "\n";
+        uint64_t fullest = 1;
+        for (uint64_t count : histogram.buckets) fullest = max(fullest, count);
+        for (int i = 0; i < SERVE_LATENCY_BUCKETS; i++) {
+            if (histogram.buckets[i] == 0) continue;
+            string from = i == 0 ? "0us" : formatMicros(bucketLimitMicros(i - 1));
+            snprintf(line, sizeof(line), "  %8s - %-8s %8llu  %s\n", from.c_str(),
+                     formatMicros(bucketLimitMicros(i)).c_str(), static_cast<unsigned long long>(histogram.buckets[i]),
+                     string(max<size_t>(1, histogram.buckets[i] * 40 / fullest), '#').c_str());
+            report += line;
+        }
+    }
+    return report;
+}
+
+// Identity of a file as seen by the cache refresh; all zero when absent
+struct FileIdentity {
+    ino_t inode = 0;
+    off_t size = 0;
+    long long mtimeNs = 0;
+
+    bool operator!=(const FileIdentity& other) const {
+        return inode != other.inode || size != other.size || mtimeNs != other.mtimeNs;
+    }
+};
+
+FileIdentity fileIdentity(const string& path) {
+    FileIdentity identity;
+    struct stat info;
+    if (stat(path.c_str(), &info) == 0) {
+        identity.inode = info.st_ino;
+        identity.size = info.st_size;
+        identity.mtimeNs = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+    }
+    return identity;
+}
+
+// A command running in a forked child
+struct RunningRequest {
+    string command;
+    int connection;
+    chrono::steady_clock::time_point start;
+};
+
+struct ServerState {
+    string root;
+    int listenFd = -1;
+    int signalFd = -1;
+    sigset_t originalMask;
+    function<int(int, char*[])> runCommand;
+    map<pid_t, RunningRequest> running;
+    map<string, LatencyHistogram> latencies;
+    FileIdentity commitGraph;
+    FileIdentity bloomFilters;
+    string warmedHead;
+    bool stopping = false;
+};
+
+void warmTree(TreeArena& arena, const string& treeSHA) {
+    for (const TreeEntry& entry : readTreeEntries(arena, treeSHA)) {
+        if (entry.isTree()) warmTree(arena, entry.hex());
+    }
+}
+
+// Bring the caches up to date with the repository. Runs on the daemon's
+// only thread, before any child is forked from the new state.
+void refreshResidentCaches(ServerState& server) {
+    reloadCachedConfig();
+    warmResidentIndex();
+
+    FileIdentity commitGraph = fileIdentity(commitGraphPath());
+    if (commitGraph != server.commitGraph) {
+        reloadCommitGraph();
+        server.commitGraph = commitGraph;
+    }
+
+    FileIdentity bloomFilters = fileIdentity(bloomFilterPath());
+    if (bloomFilters != server.bloomFilters) {
+        reloadChangedPathFilters();
+        server.bloomFilters = bloomFilters;
+    }
+
+    string head = readHEAD();
+    if (!head.empty() && head != server.warmedHead) {
+        string tree = getTreeSHAFromCommit(head);
+        if (!tree.empty()) {
+            TreeArena arena;
+            warmTree(arena, tree);
+        }
+        server.warmedHead = head;
+    }
+}
+
+void startRequest(ServerState& server, int connection, vector<string>& fields, vector<int>& fds) {
+    auto start = chrono::steady_clock::now();
+    if (fields.size() < 4 || fields[1] != server.root || fds.size() != 3) {
+        sendFrame(connection, joinFrameFields({"local"}));
+        close(connection);
+        return;
+    }
+
+    cout.flush();
+    cerr.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        sigprocmask(SIG_SETMASK, &server.originalMask, nullptr);
+        close(server.listenFd);
+        close(server.signalFd);
+        close(connection);
+        for (const auto& [child, request] : server.running) close(request.connection);
+        for (int& fd : fds) {
+            if (fd <= STDERR_FILENO) fd = fcntl(fd, F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+        }
+        for (int i = 0; i < 3; i++) dup2(fds[i], i);
+        for (int fd : fds) {
+            if (fd > STDERR_FILENO) close(fd);
+        }
+
+        vector<char*> argv;
+        for (size_t i = 2; i < fields.size(); i++) argv.push_back(fields[i].data());
+        argv.push_back(nullptr);
+        resetStats();
+        reloadCachedConfig();
+        exit(server.runCommand(static_cast<int>(argv.size() - 1), argv.data()));
+    }
+
+    for (int fd : fds) close(fd);
+    if (pid < 0) {
+        sendFrame(connection, joinFrameFields({"local"}));
+        close(connection);
+        return;
+    }
+    size_t commandField = 3;
+    while (commandField + 1 < fields.size() && isStatsOption(fields[commandField])) commandField++;
+    server.running[pid] = {fields[commandField], connection, start};
+}
+
+void acceptRequest(ServerState& server) {
+    int connection = accept4(server.listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (connection < 0) return;
+
+    // Only the daemon's own user may run commands through it
+    ucred peer;
+    socklen_t peerSize = sizeof(peer);
+    timeval timeout = {5, 0};
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    string payload;
+    vector<int> fds;
+    if (getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &peer, &peerSize) != 0 || peer.uid != getuid() ||
+        !receiveFrame(connection, payload, fds)) {
+        for (int fd : fds) close(fd);
+        close(connection);
+        return;
+    }
+
+    vector<string> fields = splitFrameFields(payload);
+    string verb = fields.empty() ? "" : fields[0];
+    if (verb == "run") {
+        startRequest(server, connection, fields, fds);
+        return;
+    }
+
+    for (int fd : fds) close(fd);
+    if (verb == "stats") {
+        sendFrame(connection, joinFrameFields({"stats", formatLatencyReport(server.latencies)}));
+    } else if (verb == "stop") {
+        sendFrame(connection, joinFrameFields({"stopping"}));
+        server.stopping = true;
+    }
+    close(connection);
+}
+
+// Reap finished commands, record their latency and answer their clients
+void reapRequests(ServerState& server, bool block) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, block ? 0 : WNOHANG)) > 0) {
+        auto found = server.running.find(pid);
+        if (found == server.running.end()) continue;
+        RunningRequest& request = found->second;
+
+        long long micros = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - request.start).count();
+        LatencyHistogram& histogram = server.latencies[request.command];
+        histogram.buckets[latencyBucket(micros)]++;
+        histogram.count++;
+        histogram.maxMicros = max(histogram.maxMicros, micros);
+
+        int exitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        sendFrame(request.connection, joinFrameFields({"exit", to_string(exitStatus)}));
+        close(request.connection);
+        server.running.erase(found);
+    }
+}
+
+bool serve(const string& socketPath, const function<int(int, char*[])>& runCommand) {
+    ServerState server;
+    error_code ec;
+    server.root = fs::current_path(ec).string();
+    server.runCommand = runCommand;
+
+    sockaddr_un address;
+    if (!makeSocketAddress(socketPath, address)) {
+        cerr << "Error: Socket path too long: " << socketPath << "\n";
+        return false;
+    }
+    int existing = connectToSocket(socketPath);
+    if (existing >= 0) {
+        close(existing);
+        cerr << "Error: mygit serve is already running on " << socketPath << "\n";
+        return false;
+    }
+    unlink(socketPath.c_str()); // left behind by a daemon that did not exit cleanly
+
+    server.listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (server.listenFd < 0 || bind(server.listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        chmod(socketPath.c_str(), 0600) != 0 || listen(server.listenFd, 64) != 0) {
+        cerr << "Error: Cannot listen on " << socketPath << ": " << strerror(errno) << "\n";
+        if (server.listenFd >= 0) close(server.listenFd);
+        return false;
+    }
+
+    // Children and stop signals are read from a descriptor in the poll loop
+    sigset_t handled;
+    sigemptyset(&handled);
+    sigaddset(&handled, SIGCHLD);
+    sigaddset(&handled, SIGINT);
+    sigaddset(&handled, SIGTERM);
+    sigprocmask(SIG_BLOCK, &handled, &server.originalMask);
+    server.signalFd = signalfd(-1, &handled, SFD_CLOEXEC);
+
+    residentCaches = true;
+    refreshResidentCaches(server);
+    cout << "Serving " << server.root << " on " << socketPath << endl;
+
+    while (!server.stopping) {
+        pollfd watched[2] = {{server.listenFd, POLLIN, 0}, {server.signalFd, POLLIN, 0}};
+        int ready = poll(watched, 2, SERVE_IDLE_REFRESH_MS);
+        if (ready < 0 && errno != EINTR) break;
+        if (ready == 0) {
+            refreshResidentCaches(server);
+            continue;
+        }
+
+        if (watched[1].revents & POLLIN) {
+            signalfd_siginfo signal;
+            if (read(server.signalFd, &signal, sizeof(signal)) == sizeof(signal) && signal.ssi_signo != SIGCHLD) {
+                server.stopping = true;
+            }
+            reapRequests(server, false);
+            refreshResidentCaches(server);
+        }
+        if (!server.stopping && (watched[0].revents & POLLIN)) acceptRequest(server);
+    }
+
+    // Let running commands finish, then report
+    close(server.listenFd);
+    unlink(socketPath.c_str());
+    reapRequests(server, true);
+    close(server.signalFd);
+    sigprocmask(SIG_SETMASK, &server.originalMask, nullptr);
+    cerr << formatLatencyReport(server.latencies);
+    return true;
+}
+
+// Ask the daemon for its latency report (stats), or to stop
+bool serverControl(const string& socketPath, const string& verb) {
+    int fd = connectToSocket(socketPath);
+    if (fd < 0) {
+        cerr << "Error: No mygit serve running on " << socketPath << "\n";
+        return false;
+    }
+    string reply;
+    vector<int> unused;
+    bool ok = sendFrame(fd, joinFrameFields({verb})) && receiveFrame(fd, reply, unused);
+    close(fd);
+    vector<string> answer = splitFrameFields(reply);
+    if (!ok || answer.empty()) {
+        cerr << "Error: No answer from mygit serve on " << socketPath << "\n";
+        return false;
+    }
+    if (verb == "stats" && answer.size() == 2) cout << answer[1];
+    return true;
+}
+
+bool handleServe(int argc, char* argv[], const function<int(int, char*[])>& runCommand) {
+    const char* usage = "Usage: mygit serve [--socket <path>] [--report | --stop]\n";
+    if (!fs::exists(".mygit")) {
+        cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
+        return false;
+    }
+
+    string socketPath = serverSocketPath();
+    string action = "serve";
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--report") {
+            action = "stats";
+        } else if (arg == "--stop") {
+            action = "stop";
+        } else {
+            cerr << usage;
+            return false;
+        }
+    }
+
+    if (action != "serve") return serverControl(socketPath, action);
+    if (traceEnabled()) {
+        cerr << "Error: MYGIT_TRACE2 is not supported by serve; trace commands with MYGIT_NO_SERVER=1\n";
+        return false;
+    }
+    return serve(socketPath, runCommand);
+}
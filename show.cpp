@@ -6,6 +6,7 @@
 #include <string>
 #include <map>
 #include <iomanip>
+#include <algorithm>
 #include "header.h"
 
 namespace fs = std::filesystem;
@@ -67,141 +68,264 @@ CommitInfo parseCommitObject(const string& commitSHA) {
     return info;
 }
 
-// Compare two trees and show differences
-    void showTreeDiff(const string& oldTreeSHA, const string& newTreeSHA, const string& prefix) {
-    // Get entries from both trees
-    map<string, TreeEntry> oldEntries, newEntries;
-    
-    if (!oldTreeSHA.empty()) {
-        vector<TreeEntry> oldTreeEntries = readTreeEntries(oldTreeSHA);
-        for (const auto& entry : oldTreeEntries) {
-            oldEntries[entry.name] = entry;
-        }
+// Line diff settings for show (-U<n>, or "diff.context" in the config)
+DiffOptions showDiffOptions;
+
+// How show prints the tree diff
+enum ShowDiffFormat { SHOW_PATCH, SHOW_STAT, SHOW_NAME_ONLY, SHOW_NAME_STATUS };
+ShowDiffFormat showDiffFormat = SHOW_PATCH;
+
+// Width of the --stat output, as git uses for a terminal of unknown size
+const size_t STAT_WIDTH = 80;
+
+// Content of a blob, or "" for an empty id or an unreadable object
+string readBlobContent(const string& blobSHA) {
+    if (blobSHA.empty()) return "";
+    string objectContent = readObjectFile(blobSHA);
+    if (objectContent.empty()) return "";
+    auto [type, size, content] = parseObject(objectContent);
+    return type == "blob" ? content : "";
+}
+
+// Print the ---/+++ header and hunks between two blobs (either id may be
+// empty), or a single line when either side is binary. Labels are
+// "a/<path>", "b/<path>" or "/dev/null".
+void showBlobDiff(const string& oldSHA, const string& newSHA, const string& oldLabel, const string& newLabel) {
+    OutputBuffer& out = standardOutput();
+    string oldContent = readBlobContent(oldSHA);
+    string newContent = readBlobContent(newSHA);
+
+    if (isBinaryContent(oldContent) || isBinaryContent(newContent)) {
+        out << "Binary files " << oldLabel << " and " << newLabel << " differ\n";
+        return;
     }
-    
-    if (!newTreeSHA.empty()) {
-        vector<TreeEntry> newTreeEntries = readTreeEntries(newTreeSHA);
-        for (const auto& entry : newTreeEntries) {
-            newEntries[entry.name] = entry;
-        }
+    out << "--- " << oldLabel << "\n";
+    out << "+++ " << newLabel << "\n";
+    writeUnifiedDiff(out, oldContent, newContent, showDiffOptions);
+}
+
+// Collect the file-level differences between two trees, skipping subtrees
+// whose ids match. Only tree objects are read; blobs are compared by id.
+void collectTreeChanges(TreeArena& arena, const ObjectId* oldTree, const ObjectId* newTree, const string& prefix,
+                        vector<TreeChange>& changes) {
+    if (oldTree && newTree && *oldTree == *newTree) return;
+
+    // Get entries from both trees, by name
+    map<string_view, const TreeEntry*> oldEntries, newEntries;
+    if (oldTree) {
+        for (const auto& entry : readTreeEntries(arena, *oldTree)) oldEntries[entry.name] = &entry;
     }
-    
+    if (newTree) {
+        for (const auto& entry : readTreeEntries(arena, *newTree)) newEntries[entry.name] = &entry;
+    }
+
     // Get all unique file/directory names
-    set<string> allNames;
+    set<string_view> allNames;
     for (const auto& pair : oldEntries) allNames.insert(pair.first);
     for (const auto& pair : newEntries) allNames.insert(pair.first);
-    
-    for (const string& name : allNames) {
-        string fullPath = prefix.empty() ? name : prefix + "/" + name;
-        
-        bool inOld = oldEntries.find(name) != oldEntries.end();
-        bool inNew = newEntries.find(name) != newEntries.end();
-        
-        if (!inOld && inNew) {
-            // New file/directory
-            TreeEntry& entry = newEntries[name];
-            if (entry.type == "blob") {
-                cout << "diff --git a/" << fullPath << " b/" << fullPath << "\n";
-                cout << "new file mode " << entry.mode << "\n";
-                cout << "index 0000000.." << entry.sha.substr(0, 7) << "\n";
-                cout << "--- /dev/null\n";
-                cout << "+++ b/" << fullPath << "\n";
-                
-                // Show file content with + prefix
-                string objectContent = readObjectFile(entry.sha);
-                if (!objectContent.empty()) {
-                    auto [type, size, content] = parseObject(objectContent);
-                    if (type == "blob") {
-                        istringstream contentStream(content);
-                        string line;
-                        while (getline(contentStream, line)) {
-                            cout << "+" << line << "\n";
-                        }
-                    }
-                }
-            } else {
-                // Recursively show new directory
-                showTreeDiff("", entry.sha, fullPath);
-            }
-        } else if (inOld && !inNew) {
-            // Deleted file/directory
-            TreeEntry& entry = oldEntries[name];
-            if (entry.type == "blob") {
-                cout << "diff --git a/" << fullPath << " b/" << fullPath << "\n";
-                cout << "deleted file mode " << entry.mode << "\n";
-                cout << "index " << entry.sha.substr(0, 7) << "..0000000\n";
-                cout << "--- a/" << fullPath << "\n";
-                cout << "+++ /dev/null\n";
-                
-                // Show file content with - prefix
-                string objectContent = readObjectFile(entry.sha);
-                if (!objectContent.empty()) {
-                    auto [type, size, content] = parseObject(objectContent);
-                    if (type == "blob") {
-                        istringstream contentStream(content);
-                        string line;
-                        while (getline(contentStream, line)) {
-                            cout << "-" << line << "\n";
-                        }
-                    }
-                }
-            } else {
-                // Recursively show deleted directory
-                showTreeDiff(entry.sha, "", fullPath);
-            }
-        } else if (inOld && inNew) {
-            // Potentially modified file/directory
-            TreeEntry& oldEntry = oldEntries[name];
-            TreeEntry& newEntry = newEntries[name];
-            
-            if (oldEntry.sha != newEntry.sha) {
-                if (oldEntry.type == "blob" && newEntry.type == "blob") {
-                    // Modified file
-                    cout << "diff --git a/" << fullPath << " b/" << fullPath << "\n";
-                    cout << "index " << oldEntry.sha.substr(0, 7) << ".." << newEntry.sha.substr(0, 7) << " " << newEntry.mode << "\n";
-                    cout << "--- a/" << fullPath << "\n";
-                    cout << "+++ b/" << fullPath << "\n";
-                    
-                    // Simple diff: show old content with -, new content with +
-                    string oldContent, newContent;
-                    
-                    string oldObjectContent = readObjectFile(oldEntry.sha);
-                    if (!oldObjectContent.empty()) {
-                        auto [type, size, content] = parseObject(oldObjectContent);
-                        if (type == "blob") oldContent = content;
-                    }
-                    
-                    string newObjectContent = readObjectFile(newEntry.sha);
-                    if (!newObjectContent.empty()) {
-                        auto [type, size, content] = parseObject(newObjectContent);
-                        if (type == "blob") newContent = content;
-                    }
-                    
-                    // Show simple before/after diff
-                    if (!oldContent.empty()) {
-                        istringstream oldStream(oldContent);
-                        string line;
-                        while (getline(oldStream, line)) {
-                            cout << "-" << line << "\n";
-                        }
-                    }
-                    
-                    if (!newContent.empty()) {
-                        istringstream newStream(newContent);
-                        string line;
-                        while (getline(newStream, line)) {
-                            cout << "+" << line << "\n";
-                        }
-                    }
-                } else if (oldEntry.type == "tree" && newEntry.type == "tree") {
-                    // Modified directory - recurse
-                    showTreeDiff(oldEntry.sha, newEntry.sha, fullPath);
+
+    for (string_view name : allNames) {
+        string fullPath = normalizeRepoPath(joinTreePath(prefix, name));
+        auto oldIt = oldEntries.find(name);
+        auto newIt = newEntries.find(name);
+        const TreeEntry* oldEntry = oldIt == oldEntries.end() ? nullptr : oldIt->second;
+        const TreeEntry* newEntry = newIt == newEntries.end() ? nullptr : newIt->second;
+        if (oldEntry && newEntry && oldEntry->id == newEntry->id && oldEntry->mode == newEntry->mode) continue;
+
+        // Directories on either side recurse; a file replaced by a directory
+        // (or the reverse) is a deletion plus additions
+        const ObjectId* oldSubtree = oldEntry && oldEntry->isTree() ? &oldEntry->id : nullptr;
+        const ObjectId* newSubtree = newEntry && newEntry->isTree() ? &newEntry->id : nullptr;
+        if (oldSubtree || newSubtree) {
+            collectTreeChanges(arena, oldSubtree, newSubtree, fullPath, changes);
+        }
+
+        bool oldBlob = oldEntry && oldEntry->isBlob();
+        bool newBlob = newEntry && newEntry->isBlob();
+        if (!oldBlob && !newBlob) continue;
+
+        TreeChange change;
+        change.status = oldBlob && newBlob ? 'M' : (newBlob ? 'A' : 'D');
+        if (oldBlob) {
+            change.oldPath = fullPath;
+            change.oldMode = oldEntry->modeString();
+            change.oldSha = oldEntry->hex();
+        }
+        if (newBlob) {
+            change.newPath = fullPath;
+            change.newMode = newEntry->modeString();
+            change.newSha = newEntry->hex();
+        }
+        changes.push_back(move(change));
+    }
+}
+
+void collectTreeChanges(const string& oldTreeSHA, const string& newTreeSHA, const string& prefix,
+                        vector<TreeChange>& changes) {
+    ObjectId oldTree, newTree;
+    bool hasOld = hexToObjectId(oldTreeSHA, oldTree);
+    bool hasNew = hexToObjectId(newTreeSHA, newTree);
+    TreeArena arena;
+    collectTreeChanges(arena, hasOld ? &oldTree : nullptr, hasNew ? &newTree : nullptr, prefix, changes);
+}
+
+// Print one file's change in git's patch format
+void showChangePatch(const TreeChange& change) {
+    OutputBuffer& out = standardOutput();
+    const string& oldPath = change.status == 'A' ? change.newPath : change.oldPath;
+    const string& newPath = change.status == 'D' ? change.oldPath : change.newPath;
+    string oldAbbrev = change.oldSha.empty() ? "0000000" : change.oldSha.substr(0, 7);
+    string newAbbrev = change.newSha.empty() ? "0000000" : change.newSha.substr(0, 7);
+
+    out << "diff --git a/" << oldPath << " b/" << newPath << "\n";
+    if (change.status == 'A') {
+        out << "new file mode " << change.newMode << "\n";
+        out << "index " << oldAbbrev << ".." << newAbbrev << "\n";
+    } else if (change.status == 'D') {
+        out << "deleted file mode " << change.oldMode << "\n";
+        out << "index " << oldAbbrev << ".." << newAbbrev << "\n";
+    } else {
+        if (change.status == 'R' || change.status == 'C') {
+            const char* verb = change.status == 'R' ? "rename" : "copy";
+            out << "similarity index " << change.similarity << "%\n";
+            out << verb << " from " << change.oldPath << "\n";
+            out << verb << " to " << change.newPath << "\n";
+        }
+        if (change.oldMode != change.newMode) {
+            out << "old mode " << change.oldMode << "\n";
+            out << "new mode " << change.newMode << "\n";
+        }
+        if (change.oldSha == change.newSha) return; // pure rename or copy
+        out << "index " << oldAbbrev << ".." << newAbbrev;
+        if (change.oldMode == change.newMode) out << " " << change.newMode;
+        out << "\n";
+    }
+
+    showBlobDiff(change.oldSha, change.newSha, change.status == 'A' ? "/dev/null" : "a/" + oldPath,
+                 change.status == 'D' ? "/dev/null" : "b/" + newPath);
+}
+
+// --name-only / --name-status: paths (and status letters) from tree
+// entries alone; no blob is read
+void showChangeNames(const vector<TreeChange>& changes, bool withStatus) {
+    OutputBuffer& out = standardOutput();
+    for (const TreeChange& change : changes) {
+        const string& path = change.newPath.empty() ? change.oldPath : change.newPath;
+        if (!withStatus) {
+            out << path << "\n";
+        } else if (change.status == 'R' || change.status == 'C') {
+            out << change.status;
+            out.writeNumber(change.similarity, 3, '0');
+            out << "\t" << change.oldPath << "\t" << change.newPath << "\n";
+        } else {
+            out << change.status << "\t" << path << "\n";
+        }
+    }
+}
+
+// Line counts of one change for --stat
+struct ChangeStat {
+    string name;
+    size_t added = 0, removed = 0;
+    bool binary = false;
+    size_t oldSize = 0, newSize = 0;
+};
+
+// --stat: inflate only the changed blobs (on the shared pool) and count
+// their changed lines
+void showDiffStat(const vector<TreeChange>& changes) {
+    vector<ChangeStat> stats(changes.size());
+    {
+        TaskGroup group(sharedThreadPool());
+        for (size_t i = 0; i < changes.size(); i++) {
+            group.run([&changes, &stats, i]() {
+                const TreeChange& change = changes[i];
+                ChangeStat& stat = stats[i];
+                stat.name = change.status == 'R' || change.status == 'C'
+                                ? change.oldPath + " => " + change.newPath
+                                : (change.newPath.empty() ? change.oldPath : change.newPath);
+                if (change.oldSha == change.newSha) return; // pure rename or copy
+
+                string oldContent = readBlobContent(change.oldSha);
+                string newContent = readBlobContent(change.newSha);
+                stat.oldSize = oldContent.size();
+                stat.newSize = newContent.size();
+                stat.binary = isBinaryContent(oldContent) || isBinaryContent(newContent);
+                if (!stat.binary) {
+                    countChangedLines(oldContent, newContent, stat.added, stat.removed);
                 }
-            }
+            });
         }
+        group.wait();
     }
+
+    size_t nameWidth = 0, maxChanged = 0, totalAdded = 0, totalRemoved = 0;
+    for (const ChangeStat& stat : stats) {
+        nameWidth = max(nameWidth, stat.name.size());
+        maxChanged = max(maxChanged, stat.added + stat.removed);
+        totalAdded += stat.added;
+        totalRemoved += stat.removed;
+    }
+    size_t countWidth = max<size_t>(to_string(maxChanged).size(), 3);
+
+    // Scale the +/- graph down when the largest change doesn't fit
+    size_t graphWidth = STAT_WIDTH > nameWidth + countWidth + 6 ? STAT_WIDTH - nameWidth - countWidth - 6 : 10;
+    graphWidth = max<size_t>(graphWidth, 10);
+    auto scaled = [&](size_t lines) -> size_t {
+        if (maxChanged <= graphWidth || lines == 0) return lines;
+        return max<size_t>(1, lines * graphWidth / maxChanged);
+    };
+
+    OutputBuffer& out = standardOutput();
+    for (const ChangeStat& stat : stats) {
+        out << " ";
+        out.writePadded(stat.name, nameWidth);
+        out << " | ";
+        if (stat.binary) {
+            out << "Bin " << stat.oldSize << " -> " << stat.newSize << " bytes\n";
+            continue;
+        }
+        out.writeNumber(stat.added + stat.removed, countWidth);
+        if (stat.added + stat.removed > 0) {
+            out << " " << string(scaled(stat.added), '+') << string(scaled(stat.removed), '-');
+        }
+        out << "\n";
     }
 
+    out << " " << stats.size() << (stats.size() == 1 ? " file changed" : " files changed");
+    if (totalAdded > 0 || totalRemoved == 0) {
+        out << ", " << totalAdded << (totalAdded == 1 ? " insertion(+)" : " insertions(+)");
+    }
+    if (totalRemoved > 0 || totalAdded == 0) {
+        out << ", " << totalRemoved << (totalRemoved == 1 ? " deletion(-)" : " deletions(-)");
+    }
+    out << "\n";
+}
+
+// Compare two trees and show differences
+void showTreeDiff(const string& oldTreeSHA, const string& newTreeSHA, const string& prefix) {
+    vector<TreeChange> changes;
+    collectTreeChanges(oldTreeSHA, newTreeSHA, prefix, changes);
+    detectRenames(changes, showDiffOptions);
+
+    // Order by destination path, as git does
+    sort(changes.begin(), changes.end(), [](const TreeChange& a, const TreeChange& b) {
+        const string& pathA = a.newPath.empty() ? a.oldPath : a.newPath;
+        const string& pathB = b.newPath.empty() ? b.oldPath : b.newPath;
+        return pathA < pathB;
+    });
+
+    if (showDiffFormat == SHOW_NAME_ONLY || showDiffFormat == SHOW_NAME_STATUS) {
+        showChangeNames(changes, showDiffFormat == SHOW_NAME_STATUS);
+    } else if (showDiffFormat == SHOW_STAT) {
+        showDiffStat(changes);
+    } else {
+        for (const TreeChange& change : changes) {
+            showChangePatch(change);
+        }
+    }
+}
+
 // Show commit information and diff
 void showCommit(const string& commitSHA) {
     // Parse commit object
@@ -212,40 +336,41 @@ void showCommit(const string& commitSHA) {
     }
     
     // Display commit information
-    cout << "commit " << info.commitHash << "\n";
+    OutputBuffer& out = standardOutput();
+    out << "commit " << info.commitHash << "\n";
     
     if (!info.author.empty()) {
-        cout << "Author: " << info.author << "\n";
+        out << "Author: " << info.author << "\n";
     }
     
     if (!info.committer.empty()) {
-        cout << "Date: " << info.committer;
+        out << "Date: " << info.committer;
         if (!info.timestamp.empty()) {
-            cout << " " << info.timestamp;
+            out << " " << info.timestamp;
         }
-        cout << "\n";
+        out << "\n";
     }
     
-    cout << "\n";
+    out << "\n";
     
     // Display commit message with indentation
     if (!info.message.empty()) {
         istringstream messageStream(info.message);
         string line;
         while (getline(messageStream, line)) {
-            cout << "    " << line << "\n";
+            out << "    " << line << "\n";
         }
     }
     
-    cout << "\n";
+    out << "\n";
     
     // Show diff
     string parentTreeSHA;
     if (!info.parentHash.empty()) {
-        // Get parent's tree
-        CommitInfo parentInfo = parseCommitObject(info.parentHash);
-        if (!parentInfo.treeHash.empty()) {
-            parentTreeSHA = parentInfo.treeHash;
+        // Get parent's tree (from the commit-graph when available)
+        CommitSummary parentSummary;
+        if (readCommitSummary(info.parentHash, parentSummary)) {
+            parentTreeSHA = parentSummary.treeHash;
         }
     }
     
@@ -274,12 +399,13 @@ bool show(const string& commitSHA) {
     if (commitSHA.empty()) {
         showHEAD();
     } else {
-        // Validate commit SHA
-        if (commitSHA.length() != 40 || !objectExists(commitSHA)) {
+        // Validate commit SHA (or the branch or tag naming it)
+        string resolved = resolveRevision(commitSHA);
+        if (resolved.empty() || !objectExists(resolved)) {
             cerr << "Error: Invalid or non-existent commit SHA\n";
             return false;
         }
-        showCommit(commitSHA);
+        showCommit(resolved);
     }
     
     return true;
@@ -288,15 +414,51 @@ bool show(const string& commitSHA) {
 // Command handler for main.cpp integration
 bool handleShow(int argc, char* argv[]) {
     string commitSHA;
-    
-    if (argc > 3) {
-        cerr << "Usage: mygit show [commit-sha]\n";
-        return false;
+
+    string configuredContext = readConfigValue("diff.context");
+    if (!configuredContext.empty()) {
+        showDiffOptions.contextLines = atoi(configuredContext.c_str());
     }
-    
-    if (argc == 3) {
-        commitSHA = argv[2];
+
+    string configuredLimit = readConfigValue("diff.renameLimit");
+    if (!configuredLimit.empty()) {
+        showDiffOptions.renameLimit = atoi(configuredLimit.c_str());
+    }
+    if (readConfigValue("diff.renames") == "false") {
+        showDiffOptions.detectRenames = false;
+    } else if (readConfigValue("diff.renames") == "copies") {
+        showDiffOptions.detectCopies = true;
+    }
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("-M", 0) == 0 || arg.rfind("-C", 0) == 0) {
+            // -M[<n>%] / -C[<n>%]: renames (and copies) at n% similarity
+            showDiffOptions.detectRenames = true;
+            showDiffOptions.detectCopies = showDiffOptions.detectCopies || arg[1] == 'C';
+            if (arg.size() > 2) showDiffOptions.renameThreshold = atoi(arg.c_str() + 2);
+        } else if (arg == "--stat") {
+            showDiffFormat = SHOW_STAT;
+        } else if (arg == "--name-only" || arg == "--name-status") {
+            // Names come from tree entries alone, so only exact renames are paired
+            showDiffFormat = arg == "--name-only" ? SHOW_NAME_ONLY : SHOW_NAME_STATUS;
+            showDiffOptions.inexactRenames = false;
+        } else if (arg == "--no-renames") {
+            showDiffOptions.detectRenames = false;
+        } else if (arg.rfind("-l", 0) == 0 && arg.size() > 2) {
+            showDiffOptions.renameLimit = atoi(arg.c_str() + 2);
+        } else if (arg.rfind("-U", 0) == 0 && arg.size() > 2) {
+            showDiffOptions.contextLines = atoi(arg.c_str() + 2);
+        } else if (arg.rfind("--unified=", 0) == 0) {
+            showDiffOptions.contextLines = atoi(arg.c_str() + 10);
+        } else if (commitSHA.empty() && arg[0] != '-') {
+            commitSHA = arg;
+        } else {
+            cerr << "Usage: mygit show [--stat | --name-only | --name-status] [-U<n>] [-M[<n>%]] [-C[<n>%]]\n"
+                 << "                  [--no-renames] [-l<n>] [commit-sha]\n";
+            return false;
+        }
     }
     
     return show(commitSHA);
-}
\ No newline at end of file
+}
@@ -0,0 +1,180 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <string>
+#include <set>
+#include <map>
+#include "header.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+
+// Sparse checkout (.mygit/info/sparse-checkout)
+//
+// Cone mode: the file lists directories, one per line ("services/api/").
+// Everything under a listed directory is checked out, as are the files
+// directly inside the root and inside each parent of a listed directory.
+// Git's own cone format ("/*", "!/*/", "/a/", "!/a/*/", "/a/b/") is also
+// understood. Without the file, the whole tree is checked out.
+
+const string SPARSE_CHECKOUT_PATH = ".mygit/info/sparse-checkout";
+
+// Strip the slashes and trailing "*" of a pattern line
+string sparsePatternDirectory(string pattern) {
+    while (!pattern.empty() && (pattern.back() == '*' || pattern.back() == '/')) pattern.pop_back();
+    while (!pattern.empty() && pattern[0] == '/') pattern = pattern.substr(1);
+    return normalizeRepoPath(pattern);
+}
+
+SparseCheckout loadSparseCheckout() {
+    SparseCheckout sparse;
+    ifstream patternFile(SPARSE_CHECKOUT_PATH);
+    if (!patternFile) return sparse;
+
+    sparse.enabled = true;
+    set<string> listed, parentsOnly;
+    string line;
+    while (getline(patternFile, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        if (line[0] == '!') {
+            // "!/a/*/" limits "/a/" to its own files
+            string dir = sparsePatternDirectory(line.substr(1));
+            if (!dir.empty()) parentsOnly.insert(dir);
+            continue;
+        }
+
+        string dir = sparsePatternDirectory(line);
+        if (!dir.empty()) listed.insert(dir);
+    }
+
+    for (const string& dir : listed) {
+        if (parentsOnly.count(dir) == 0) sparse.recursive.insert(dir);
+    }
+    for (const string& dir : sparse.recursive) {
+        for (size_t slash = dir.find('/'); slash != string::npos; slash = dir.find('/', slash + 1)) {
+            sparse.parents.insert(dir.substr(0, slash));
+        }
+    }
+    return sparse;
+}
+
+// True if dir or one of its ancestors is a listed directory
+bool sparseUnderRecursive(const SparseCheckout& sparse, string dir) {
+    while (!dir.empty()) {
+        if (sparse.recursive.count(dir)) return true;
+        size_t slash = dir.rfind('/');
+        if (slash == string::npos) break;
+        dir.resize(slash);
+    }
+    return false;
+}
+
+// Whether a tree walk needs to look inside dir at all
+bool sparseIncludesDirectory(const SparseCheckout& sparse, const string& dir) {
+    if (!sparse.enabled || dir.empty()) return true;
+    return sparse.parents.count(dir) || sparseUnderRecursive(sparse, dir);
+}
+
+// Whether a file is checked out
+bool sparseIncludesPath(const SparseCheckout& sparse, const string& path) {
+    if (!sparse.enabled) return true;
+    size_t slash = path.rfind('/');
+    if (slash == string::npos) return true; // files in the root
+    string dir = path.substr(0, slash);
+    return sparse.parents.count(dir) || sparseUnderRecursive(sparse, dir);
+}
+
+// Collect the files of a tree that are inside the sparse set, and their
+// modes when asked. Excluded directories are not read; they are returned
+// as skip-worktree index entries carrying their tree id, alongside any
+// excluded files.
+void collectSparseTree(TreeArena& arena, span<const TreeEntry> entries, const string& prefix,
+                       const SparseCheckout& sparse, map<string, string>& files, vector<IndexEntry>& skipped,
+                       map<string, string>* modes) {
+    for (const auto& entry : entries) {
+        string path = normalizeRepoPath(joinTreePath(prefix, entry.name));
+
+        if (entry.isTree()) {
+            if (sparseIncludesDirectory(sparse, path)) {
+                collectSparseTree(arena, readTreeEntries(arena, entry.id), path, sparse, files, skipped, modes);
+            } else {
+                skipped.push_back({"40000", entry.hex(), path, 0, -1, true});
+            }
+        } else if (entry.isBlob()) {
+            if (sparseIncludesPath(sparse, path)) {
+                files[path] = entry.hex();
+                if (modes) (*modes)[path] = entry.modeString();
+            } else {
+                skipped.push_back({entry.modeString(), entry.hex(), path, 0, -1, true});
+            }
+        }
+    }
+}
+
+void collectSparseTree(const string& treeSHA, const string& prefix, const SparseCheckout& sparse,
+                       map<string, string>& files, vector<IndexEntry>& skipped, map<string, string>* modes) {
+    TreeArena arena;
+    collectSparseTree(arena, readTreeEntries(arena, treeSHA), prefix, sparse, files, skipped, modes);
+}
+
+// Bring the working tree in line with the current patterns
+bool reapplySparseCheckout() {
+    string currentCommit = getCurrentCommit();
+    if (currentCommit.empty()) return true;
+
+    string treeSHA = getTreeSHAFromCommit(currentCommit);
+    if (treeSHA.empty()) {
+        cerr << "Error: Cannot extract tree from commit\n";
+        return false;
+    }
+    return checkoutTree(treeSHA, treeSHA, false);
+}
+
+// mygit sparse-checkout set <dir>... | list | disable
+bool handleSparseCheckout(int argc, char* argv[]) {
+    OutputBuffer& out = standardOutput();
+    if (!fs::exists(".mygit")) {
+        cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
+        return false;
+    }
+
+    string subcommand = argc >= 3 ? argv[2] : "";
+    if (subcommand == "list") {
+        SparseCheckout sparse = loadSparseCheckout();
+        if (!sparse.enabled) {
+            cerr << "Sparse checkout is not enabled\n";
+            return false;
+        }
+        for (const string& dir : sparse.recursive) {
+            out << dir << "\n";
+        }
+        return true;
+    }
+
+    if (subcommand == "set" && argc >= 4) {
+        fs::create_directories(fs::path(SPARSE_CHECKOUT_PATH).parent_path());
+        ofstream patternFile(SPARSE_CHECKOUT_PATH, ios::trunc);
+        if (!patternFile) {
+            cerr << "Error: Cannot write " << SPARSE_CHECKOUT_PATH << "\n";
+            return false;
+        }
+        for (int i = 3; i < argc; i++) {
+            string dir = sparsePatternDirectory(argv[i]);
+            if (!dir.empty()) patternFile << dir << "/\n";
+        }
+        patternFile.close();
+        return reapplySparseCheckout();
+    }
+
+    if (subcommand == "disable") {
+        error_code ec;
+        fs::remove(SPARSE_CHECKOUT_PATH, ec);
+        return reapplySparseCheckout();
+    }
+
+    cerr << "Usage: mygit sparse-checkout set <dir>... | list | disable\n";
+    return false;
+}
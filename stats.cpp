@@ -0,0 +1,117 @@
+#include <iostream>
+#include <string>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <sys/resource.h>
+#include "header.h"
+
+using namespace std;
+
+// Per-command work counters (--stats)
+//
+// Counters are process-wide relaxed atomics, each on its own cache line so
+// parallel commands don't contend on them. They are printed to stderr at
+// exit so the command's own output stays machine-readable.
+
+struct alignas(64) StatSlot {
+    atomic<uint64_t> value{0};
+};
+
+StatSlot statSlots[STAT_COUNTER_COUNT];
+
+const char* const STAT_NAMES[STAT_COUNTER_COUNT] = {
+    "objects_read",
+    "bytes_inflated",
+    "bytes_deflated",
+    "objects_written",
+    "objects_skipped_existing",
+    "files_stated",
+    "files_opened",
+    "files_hashed",
+    "cache_hits",
+    "cache_misses",
+    "directories_scanned",
+};
+
+chrono::steady_clock::time_point statsStartTime = chrono::steady_clock::now();
+bool statsAsJson = false;
+
+void countStat(StatCounter counter, uint64_t amount) {
+    statSlots[counter].value.fetch_add(amount, memory_order_relaxed);
+}
+
+uint64_t statValue(StatCounter counter) {
+    return statSlots[counter].value.load(memory_order_relaxed);
+}
+
+// Zero the counters and restart the clock, for a command forked by serve
+void resetStats() {
+    for (StatSlot& slot : statSlots) slot.value.store(0, memory_order_relaxed);
+    statsStartTime = chrono::steady_clock::now();
+}
+
+// Peak resident set size in kilobytes
+long peakResidentKilobytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss;
+}
+
+// User and system CPU time in milliseconds
+void cpuMilliseconds(long long& user, long long& system) {
+    struct rusage usage;
+    user = system = 0;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return;
+    user = usage.ru_utime.tv_sec * 1000LL + usage.ru_utime.tv_usec / 1000;
+    system = usage.ru_stime.tv_sec * 1000LL + usage.ru_stime.tv_usec / 1000;
+}
+
+void printStats() {
+    long long wallMillis = chrono::duration_cast<chrono::milliseconds>(
+        chrono::steady_clock::now() - statsStartTime).count();
+    long long userMillis, systemMillis;
+    cpuMilliseconds(userMillis, systemMillis);
+
+    if (statsAsJson) {
+        cerr << "{";
+        for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+            cerr << "\"" << STAT_NAMES[i] << "\":" << statValue(static_cast<StatCounter>(i)) << ",";
+        }
+        cerr << "\"peak_rss_kb\":" << peakResidentKilobytes() << ",\"wall_time_ms\":" << wallMillis
+             << ",\"cpu_user_ms\":" << userMillis << ",\"cpu_system_ms\":" << systemMillis << "}\n";
+        return;
+    }
+
+    cerr << "\nStatistics:\n";
+    for (int i = 0; i < STAT_COUNTER_COUNT; i++) {
+        cerr << "  " << STAT_NAMES[i] << ": " << statValue(static_cast<StatCounter>(i)) << "\n";
+    }
+    cerr << "  peak_rss_kb: " << peakResidentKilobytes() << "\n";
+    cerr << "  wall_time_ms: " << wallMillis << "\n";
+    cerr << "  cpu_user_ms: " << userMillis << "\n";
+    cerr << "  cpu_system_ms: " << systemMillis << "\n";
+}
+
+// --stats, --stats=text or --stats=json
+bool isStatsOption(const string& arg) {
+    return arg == "--stats" || arg == "--stats=text" || arg == "--stats=json";
+}
+
+// Remove --stats / --stats=json / --stats=text given before the command name
+// and, if present, arrange for the counters to be printed at exit. Later
+// arguments belong to the command and are left alone.
+void extractStatsOption(int& argc, char* argv[]) {
+    int first = 1;
+    while (first < argc && isStatsOption(argv[first])) {
+        if (string(argv[first]) == "--stats=json") statsAsJson = true;
+        first++;
+    }
+    if (first == 1) return;
+
+    int kept = 1;
+    for (int i = first; i < argc; i++) argv[kept++] = argv[i];
+    argc = kept;
+    argv[argc] = nullptr;
+    atexit(printStats);
+}
@@ -21,61 +21,16 @@ bool isHiddenFile(const fs::path& path) {
 // Read the index file and return staged files
 map<string, string> readIndex() {
     map<string, string> stagedFiles;
-    
-    ifstream indexFile(".mygit/index");
-    if (!indexFile) {
-        return stagedFiles; // Empty map if no index file
-    }
-    
-    string line;
-    while (getline(indexFile, line)) {
-        if (line.empty()) continue;
-        
-        // Parse index format: "mode hash filename" or "mode Blob hash filename"
-        istringstream iss(line);
-        string mode, type_or_hash, hash, filename;
-        iss >> mode;
-        iss >> type_or_hash;
-        
-        if (type_or_hash == "Blob") {
-            // Format: "100644 Blob hash filename"
-            iss >> hash;
-            getline(iss, filename);
-        } else {
-            // Format: "100644 hash filename"  
-            hash = type_or_hash;
-            getline(iss, filename);
-        }
-        
-        // Remove leading space from filename
-        if (!filename.empty() && filename[0] == ' ') {
-            filename = filename.substr(1);
-        }
-        
-        if (!filename.empty()) {
-            stagedFiles[filename] = hash;
-        }
+    for (const IndexEntry& entry : loadIndex()) {
+        if (entry.skipWorktree) continue;
+        stagedFiles[entry.path] = entry.hash;
     }
-    
     return stagedFiles;
 }
 
-// Get current HEAD commit hash
+// Get current HEAD commit hash ("" before the first commit)
 string getCurrentCommit() {
-    ifstream headFile(".mygit/HEAD");
-    if (!headFile) {
-        return ""; // No HEAD file (no commits yet)
-    }
-    
-    string headContent;
-    getline(headFile, headContent);
-    
-    // If HEAD is empty or doesn't exist, there are no commits
-    if (headContent.empty()) {
-        return "";
-    }
-    
-    return headContent;
+    return readHEAD();
 }
 
 // Get files from the last commit's tree (if it exists)
@@ -113,30 +68,33 @@ map<string, string> getCommittedFiles() {
         return committedFiles;
     }
     
-    // Recursively collect all files from the tree
-    collectFilesFromTree(treeSHA, "", committedFiles);
+    // Recursively collect the files from the tree; directories outside the
+    // sparse checkout are neither read nor reported
+    vector<IndexEntry> skipped;
+    collectSparseTree(treeSHA, "", loadSparseCheckout(), committedFiles, skipped);
     
     return committedFiles;
 }
 
 // Recursively collect files from tree object
-void collectFilesFromTree(const string& treeSHA, const string& prefix, map<string, string>& files) {
-    vector<TreeEntry> entries = readTreeEntries(treeSHA);
-    if (entries.empty()) {
-        return;
-    }
-    
+void collectFilesFromTree(TreeArena& arena, span<const TreeEntry> entries, const string& prefix,
+                          map<string, string>& files) {
     for (const auto& entry : entries) {
-        string fullPath = prefix.empty() ? entry.name : prefix + "/" + entry.name;
+        string fullPath = joinTreePath(prefix, entry.name);
         
-        if (entry.type == "blob") {
-            files[fullPath] = entry.sha;
-        } else if (entry.type == "tree") {
-            collectFilesFromTree(entry.sha, fullPath, files);
+        if (entry.isTree()) {
+            collectFilesFromTree(arena, readTreeEntries(arena, entry.id), fullPath, files);
+        } else if (entry.isBlob()) {
+            files[normalizeRepoPath(fullPath)] = entry.hex();
         }
     }
 }
 
+void collectFilesFromTree(const string& treeSHA, const string& prefix, map<string, string>& files) {
+    TreeArena arena;
+    collectFilesFromTree(arena, readTreeEntries(arena, treeSHA), prefix, files);
+}
+
 // Get all files in working directory
 set<string> getWorkingDirectoryFiles() {
     set<string> workingFiles;
@@ -149,8 +107,11 @@ set<string> getWorkingDirectoryFiles() {
 
 // Recursively scan directory for files
 void scanDirectory(const string& dirPath, const string& prefix, set<string>& files) {
+    TraceSpan span("scanDirectory");
+    countStat(STAT_DIRECTORIES_SCANNED);
     try {
         for (const auto& entry : fs::directory_iterator(dirPath)) {
+            countStat(STAT_FILES_STATED);
             if (isHiddenFile(entry.path())) {
                 continue; // Skip hidden files and .mygit
             }
@@ -172,6 +133,7 @@ void scanDirectory(const string& dirPath, const string& prefix, set<string>& fil
 
 // Compute hash for a working directory file
 string computeWorkingFileHash(const string& filePath) {
+    countStat(STAT_FILES_STATED);
     if (!fs::exists(filePath)) {
         return "";
     }
@@ -184,10 +146,11 @@ string computeWorkingFileHash(const string& filePath) {
     ostringstream buffer;
     buffer << file.rdbuf();
     string fileContent = buffer.str();
+    countStat(STAT_FILES_OPENED);
+    countStat(STAT_FILES_HASHED);
     
-    // Create blob format and compute hash
-    string blobContent = "blob " + to_string(fileContent.length()) + '\0' + fileContent;
-    return computeSHA1FromString(blobContent);
+    // Compute the same id add/commit would store (chunked for large files)
+    return computeBlobHash(fileContent);
 }
 
 // Generate status report
@@ -195,7 +158,15 @@ vector<FileStatus> generateStatus() {
     vector<FileStatus> statusList;
     
     // Get file lists
-    map<string, string> stagedFiles = readIndex();
+    vector<IndexEntry> indexEntries = loadIndex();
+    map<string, string> stagedFiles;
+    map<string, const IndexEntry*> indexByPath;
+    for (const IndexEntry& entry : indexEntries) {
+        if (entry.skipWorktree) continue; // outside the sparse checkout
+        stagedFiles[entry.path] = entry.hash;
+        indexByPath[entry.path] = &entry;
+    }
+    long long indexMtime = indexFileMtime();
     map<string, string> committedFiles = getCommittedFiles();
     set<string> workingFiles = getWorkingDirectoryFiles();
     
@@ -231,7 +202,12 @@ vector<FileStatus> generateStatus() {
         }
         
         if (inWorkingDir) {
-            status.workingHash = computeWorkingFileHash(filePath);
+            // Unchanged stat data means the file still has the staged content
+            if (isStaged && indexStatMatches(*indexByPath[filePath], indexMtime)) {
+                status.workingHash = status.stagedHash;
+            } else {
+                status.workingHash = computeWorkingFileHash(filePath);
+            }
         }
         
         // Determine file status based on combinations
@@ -254,8 +230,8 @@ vector<FileStatus> generateStatus() {
             status.status = "deleted_unstaged";
         }
         else if (isCommitted && isStaged && !inWorkingDir) {
-            // File deletion is staged
-            status.status = "deleted";
+            // The index still has the file, so the deletion is not staged
+            status.status = "deleted_unstaged";
         }
         else if (isCommitted && isStaged && inWorkingDir) {
             // File exists in all three places - check for modifications
@@ -293,6 +269,7 @@ vector<FileStatus> generateStatus() {
 
 // Display status in a git-like format
 void displayStatus() {
+    OutputBuffer& out = standardOutput();
     if (!fs::exists(".mygit")) {
         cerr << "Error: Not a mygit repository. Run 'mygit init' first.\n";
         return;
@@ -323,66 +300,72 @@ void displayStatus() {
     
     // Display current branch/commit info
     string currentCommit = getCurrentCommit();
+    string branch = currentBranch();
+    if (!branch.empty()) {
+        out << "On branch " << branch.substr(branch.rfind("refs/heads/", 0) == 0 ? 11 : 0) << "\n";
+    } else {
+        out << "HEAD detached at " << currentCommit.substr(0, 8) << "\n";
+    }
     if (currentCommit.empty()) {
-        cout << "On initial commit\n";
+        out << "On initial commit\n";
     } else {
-        cout << "HEAD commit: " << currentCommit.substr(0, 8) << "...\n";
+        out << "HEAD commit: " << currentCommit.substr(0, 8) << "...\n";
     }
-    cout << "\n";
+    out << "\n";
     
     // Display staged files
     if (!staged.empty()) {
-        cout << "Changes to be committed:\n";
-        cout << "  (use \"mygit reset <file>...\" to unstage)\n\n";
+        out << "Changes to be committed:\n";
+        out << "  (use \"mygit reset <file>...\" to unstage)\n\n";
         
         for (const auto& file : staged) {
             if (file.status == "added") {
-                cout << "\tnew file:   " << file.filePath << "\n";
+                out << "\tnew file:   " << file.filePath << "\n";
             } else if (file.status == "modified") {
-                cout << "\tmodified:   " << file.filePath << "\n";
+                out << "\tmodified:   " << file.filePath << "\n";
             } else if (file.status == "deleted") {
-                cout << "\tdeleted:    " << file.filePath << "\n";
+                out << "\tdeleted:    " << file.filePath << "\n";
             }
         }
-        cout << "\n";
+        out << "\n";
     }
     
     // Display modified files
     if (!modified.empty()) {
-        cout << "Changes not staged for commit:\n";
-        cout << "  (use \"mygit add <file>...\" to update what will be committed)\n";
-        cout << "  (use \"mygit checkout -- <file>...\" to discard changes)\n\n";
+        out << "Changes not staged for commit:\n";
+        out << "  (use \"mygit add <file>...\" to update what will be committed)\n";
+        out << "  (use \"mygit checkout -- <file>...\" to discard changes)\n\n";
         
         for (const auto& file : modified) {
             if (file.status == "modified_unstaged" || 
                 file.status == "added_modified" || 
                 file.status == "modified_modified") {
-                cout << "\tmodified:   " << file.filePath << "\n";
+                out << "\tmodified:   " << file.filePath << "\n";
             } else if (file.status == "deleted_unstaged") {
-                cout << "\tdeleted:    " << file.filePath << "\n";
+                out << "\tdeleted:    " << file.filePath << "\n";
             }
         }
-        cout << "\n";
+        out << "\n";
     }
     
     // Display untracked files
     if (!untracked.empty()) {
-        cout << "Untracked files:\n";
-        cout << "  (use \"mygit add <file>...\" to include in what will be committed)\n\n";
+        out << "Untracked files:\n";
+        out << "  (use \"mygit add <file>...\" to include in what will be committed)\n\n";
         
         for (const auto& file : untracked) {
-            cout << "\t" << file.filePath << "\n";
+            out << "\t" << file.filePath << "\n";
         }
-        cout << "\n";
+        out << "\n";
     }
     
     // Summary message
     if (staged.empty() && modified.empty() && untracked.empty()) {
-        cout << "Nothing to commit, working tree clean\n";
+        out << "Nothing to commit, working tree clean\n";
     } else {
         if (staged.empty()) {
             if (!modified.empty() || !untracked.empty()) {
-                cout << "No changes added to commit (use \"mygit add\" to track)\n";
+                out << "No changes added to commit (use \"mygit add\" to track)\n";
             }
         }
     }
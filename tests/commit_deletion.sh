@@ -0,0 +1,51 @@
+#!/bin/bash
+# Regression test: a deleted tracked file can be staged, with "add <path>"
+# or "add .", and the next commit no longer contains it.
+#
+# Usage: tests/commit_deletion.sh (make test runs it with MYGIT set)
+
+set -e
+
+MYGIT=${MYGIT:-$(pwd)/mygit}
+export MYGIT_NO_SERVER=1
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK"
+
+fail() {
+    echo "FAIL: $1" >&2
+    exit 1
+}
+
+# Files in the tree of the commit HEAD points to
+head_files() {
+    local tree
+    tree=$("$MYGIT" cat-file -p "$("$MYGIT" rev-parse HEAD)" | awk '/^tree / { print $2; exit }')
+    "$MYGIT" ls-tree -r --name-only "$tree" | sort | tr '\n' ' '
+}
+
+"$MYGIT" init > /dev/null
+mkdir d
+echo a > a.txt
+echo b > b.txt
+echo c > d/c.txt
+echo e > d/e.txt
+"$MYGIT" add . > /dev/null
+"$MYGIT" commit -m "four files" > /dev/null
+
+# Deletion staged by naming the file
+rm b.txt
+"$MYGIT" add b.txt > /dev/null || fail "add of a deleted tracked file failed"
+"$MYGIT" commit -m "remove b" > /dev/null
+[ "$(head_files)" = "a.txt d/c.txt d/e.txt " ] || fail "b.txt still committed: $(head_files)"
+
+# Deletion staged by adding everything
+rm d/c.txt
+"$MYGIT" add . > /dev/null
+"$MYGIT" commit -m "remove d/c" > /dev/null
+[ "$(head_files)" = "a.txt d/e.txt " ] || fail "d/c.txt still committed: $(head_files)"
+
+# An unknown path is still an error
+"$MYGIT" add nosuch.txt 2>&1 | grep -q "does not exist" || fail "missing untracked path was not reported"
+
+echo "commit_deletion: ok"
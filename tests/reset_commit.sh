@@ -0,0 +1,51 @@
+#!/bin/bash
+# Regression test: "reset" must leave the index at HEAD's tree, so the
+# next commit keeps every tracked file instead of only the new ones.
+#
+# Usage: tests/reset_commit.sh (make test runs it with MYGIT set)
+
+set -e
+
+MYGIT=${MYGIT:-$(pwd)/mygit}
+export MYGIT_NO_SERVER=1
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK"
+
+fail() {
+    echo "FAIL: $1" >&2
+    exit 1
+}
+
+# Files in the tree of the commit HEAD points to
+head_files() {
+    local tree
+    tree=$("$MYGIT" cat-file -p "$("$MYGIT" rev-parse HEAD)" | awk '/^tree / { print $2; exit }')
+    "$MYGIT" ls-tree -r --name-only "$tree" | sort | tr '\n' ' '
+}
+
+"$MYGIT" init > /dev/null
+mkdir d
+echo a > a.txt
+echo b > d/b.txt
+echo c > c.txt
+"$MYGIT" add . > /dev/null
+"$MYGIT" commit -m "three files" > /dev/null
+FIRST=$("$MYGIT" rev-parse HEAD)
+
+# Plain reset, then a commit of one new file
+"$MYGIT" reset > /dev/null
+echo x > x.txt
+"$MYGIT" add x.txt > /dev/null
+"$MYGIT" commit -m "add x" > /dev/null
+[ "$(head_files)" = "a.txt c.txt d/b.txt x.txt " ] || fail "reset dropped tracked files: $(head_files)"
+if "$MYGIT" status | grep -q "a.txt"; then fail "a.txt is not clean after reset and commit"; fi
+
+# Mixed reset to the first commit keeps x.txt in the worktree only
+"$MYGIT" reset "$FIRST" > /dev/null
+echo y > y.txt
+"$MYGIT" add y.txt > /dev/null
+"$MYGIT" commit -m "add y" > /dev/null
+[ "$(head_files)" = "a.txt c.txt d/b.txt y.txt " ] || fail "mixed reset lost files: $(head_files)"
+
+echo "reset_commit: ok"
@@ -0,0 +1,64 @@
+#!/bin/bash
+# Regression test: a commit-graph written through "mygit serve" is picked up
+# by the daemon, so a later "log -- <path>" uses the new graph and Bloom
+# filters and matches a run without the daemon.
+#
+# Usage: tests/serve_commit_graph.sh (make test runs it with MYGIT set)
+
+set -e
+
+MYGIT=${MYGIT:-$(pwd)/mygit}
+unset MYGIT_NO_SERVER
+WORK=$(mktemp -d)
+trap 'cd "$WORK" && "$MYGIT" serve --stop > /dev/null 2>&1 || true; rm -rf "$WORK"' EXIT
+cd "$WORK"
+
+fail() {
+    echo "FAIL: $1" >&2
+    exit 1
+}
+
+# Commit one change to a path
+commit_path() {
+    mkdir -p "$(dirname "$1")"
+    echo "$2" > "$1"
+    "$MYGIT" add "$1" > /dev/null
+    "$MYGIT" commit -m "$2" > /dev/null
+}
+
+# objects_read reported by --stats for a command
+objects_read() {
+    "$@" 2>&1 > /dev/null | awk '$1 == "objects_read:" { print $2 }'
+}
+
+MYGIT_NO_SERVER=1 "$MYGIT" init > /dev/null
+for i in 1 2 3; do
+    MYGIT_NO_SERVER=1 commit_path src/a.txt "a$i"
+    MYGIT_NO_SERVER=1 commit_path docs/b.txt "b$i"
+done
+MYGIT_NO_SERVER=1 "$MYGIT" commit-graph write > /dev/null
+
+# The daemon loads this graph, then must notice when it is rewritten
+"$MYGIT" serve > /dev/null 2>&1 &
+while [ ! -S .mygit/serve.sock ]; do sleep 0.1; done
+
+for i in 4 5 6; do
+    commit_path src/a.txt "a$i"
+    commit_path docs/b.txt "b$i"
+done
+before_reads=$(objects_read "$MYGIT" --stats log -- src/a.txt)
+"$MYGIT" commit-graph write > /dev/null || fail "commit-graph write through serve failed"
+
+served=$("$MYGIT" log --oneline -- src/a.txt)
+direct=$(MYGIT_NO_SERVER=1 "$MYGIT" log --oneline -- src/a.txt)
+[ -n "$served" ] || fail "log -- src/a.txt printed nothing"
+[ "$served" = "$direct" ] || fail "log through serve differs: $served"
+[ "$(echo "$served" | wc -l)" -eq 6 ] || fail "expected 6 commits touching src/a.txt: $served"
+
+# With the new filters the child skips the tree diffs of the new commits; a
+# stale graph or filter would leave it reading as many objects as before
+after_reads=$(objects_read "$MYGIT" --stats log -- src/a.txt)
+[ -n "$before_reads" ] && [ -n "$after_reads" ] || fail "no objects_read counter from --stats"
+[ "$after_reads" -lt "$before_reads" ] || fail "serve read $after_reads objects after the write, $before_reads before"
+
+echo "serve_commit_graph: ok"
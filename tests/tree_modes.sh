@@ -0,0 +1,47 @@
+#!/bin/bash
+# Regression test: executable and symlink entries keep their modes through
+# checkout, reset and re-adding, so later commits do not change them.
+#
+# Usage: tests/tree_modes.sh (make test runs it with MYGIT set)
+
+set -e
+
+MYGIT=${MYGIT:-$(pwd)/mygit}
+export MYGIT_NO_SERVER=1
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK"
+
+fail() {
+    echo "FAIL: $1" >&2
+    exit 1
+}
+
+# "mode path" for every entry of HEAD's root tree
+head_modes() {
+    local tree
+    tree=$("$MYGIT" cat-file -p "$("$MYGIT" rev-parse HEAD)" | awk '/^tree / { print $2; exit }')
+    "$MYGIT" ls-tree "$tree" | awk '{ print $1 " " $4 }' | tr '\n' ' '
+}
+
+EXPECTED="120000 link 100644 plain 100755 run.sh "
+
+"$MYGIT" init > /dev/null
+printf '%s\n' 'commit refs/heads/master' 'committer T <t@example.com> 1700000000 +0000' 'data 6' 'import' \
+    'M 100755 inline run.sh' 'data 3' 'hi' '' 'M 120000 inline link' 'data 6' 'run.sh' \
+    'M 100644 inline plain' 'data 2' 'p' '' 'done' | "$MYGIT" fast-import > /dev/null
+"$MYGIT" checkout master > /dev/null
+
+echo more >> run.sh
+"$MYGIT" add . > /dev/null
+"$MYGIT" commit -m "edit run.sh" > /dev/null
+[ "$(head_modes)" = "$EXPECTED" ] || fail "modes changed by checkout and add: $(head_modes)"
+
+"$MYGIT" reset > /dev/null
+"$MYGIT" reset link > /dev/null
+echo x > new
+"$MYGIT" add new > /dev/null
+"$MYGIT" commit -m "add new" > /dev/null
+[ "$(head_modes)" = "120000 link 100644 new 100644 plain 100755 run.sh " ] || fail "modes changed by reset: $(head_modes)"
+
+echo "tree_modes: ok"
@@ -0,0 +1,121 @@
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdlib>
+#include <string>
+#include "header.h"
+
+using namespace std;
+
+// Number of worker threads: MYGIT_THREADS if set, otherwise one per core
+size_t configuredThreadCount() {
+    const char* env = getenv("MYGIT_THREADS");
+    if (env && *env) {
+        int requested = atoi(env);
+        if (requested > 0) return static_cast<size_t>(requested);
+    }
+    unsigned int cores = thread::hardware_concurrency();
+    return cores == 0 ? 1 : cores;
+}
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) threadCount = 1;
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCv.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(function<void()> task) {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        tasks.push_back(move(task));
+    }
+    queueCv.notify_one();
+}
+
+// Run one queued task on the calling thread, if there is one.
+// Used by TaskGroup::wait() so that a task waiting on its children
+// keeps the pool busy instead of blocking a worker.
+bool ThreadPool::runPendingTask() {
+    function<void()> task;
+    {
+        lock_guard<mutex> lock(queueMutex);
+        if (tasks.empty()) return false;
+        task = move(tasks.front());
+        tasks.pop_front();
+    }
+    task();
+    return true;
+}
+
+size_t ThreadPool::size() const {
+    return workers.size();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(queueMutex);
+            queueCv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+// Process-wide pool shared by all parallel commands
+ThreadPool& sharedThreadPool() {
+    static ThreadPool pool(configuredThreadCount());
+    return pool;
+}
+
+TaskGroup::TaskGroup(ThreadPool& pool) : pool(pool) {}
+
+TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskGroup::run(function<void()> task) {
+    pending.fetch_add(1);
+    pool.submit([this, task = move(task)]() {
+        try {
+            task();
+        } catch (const exception& e) {
+            cerr << "Error: " << e.what() << "\n";
+            failed = true;
+        }
+        // Decrement under the lock so wait() cannot return (and the group
+        // be destroyed) while this task still touches it
+        lock_guard<mutex> lock(doneMutex);
+        if (pending.fetch_sub(1) == 1) {
+            doneCv.notify_all();
+        }
+    });
+}
+
+bool TaskGroup::wait() {
+    while (pending.load() > 0) {
+        if (pool.runPendingTask()) continue;
+
+        unique_lock<mutex> lock(doneMutex);
+        doneCv.wait_for(lock, chrono::milliseconds(1), [this]() { return pending.load() == 0; });
+    }
+    lock_guard<mutex> lock(doneMutex);
+    return !failed.load();
+}
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+#include "header.h"
+
+using namespace std;
+
+// Trace-event output (MYGIT_TRACE2=<path>)
+//
+// TraceSpan records a complete ("ph":"X") event for the scope it lives in.
+// Events are buffered per thread and written once at exit as Chrome /
+// Perfetto trace-event JSON. When MYGIT_TRACE2 is unset a span costs one
+// check of a cached flag.
+
+struct TraceEvent {
+    const char* name;
+    long long startMicros;
+    long long durationMicros;
+};
+
+// Events recorded by one thread
+struct TraceThreadBuffer {
+    int threadId;
+    vector<TraceEvent> events;
+};
+
+mutex traceBuffersMutex;
+vector<shared_ptr<TraceThreadBuffer>> traceBuffers;
+atomic<int> nextTraceThreadId{1};
+
+const chrono::steady_clock::time_point traceEpoch = chrono::steady_clock::now();
+
+long long traceNowMicros() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - traceEpoch).count();
+}
+
+const char* traceOutputPath() {
+    static const char* path = []() -> const char* {
+        const char* env = getenv("MYGIT_TRACE2");
+        return env && *env ? env : nullptr;
+    }();
+    return path;
+}
+
+bool traceEnabled() {
+    return traceOutputPath() != nullptr;
+}
+
+// Buffer for the calling thread, registered on first use
+TraceThreadBuffer& traceThreadBuffer() {
+    thread_local TraceThreadBuffer* buffer = []() {
+        auto created = make_shared<TraceThreadBuffer>();
+        created->threadId = nextTraceThreadId.fetch_add(1);
+        lock_guard<mutex> lock(traceBuffersMutex);
+        traceBuffers.push_back(created);
+        return created.get();
+    }();
+    return *buffer;
+}
+
+string escapeTraceString(const char* text) {
+    string escaped;
+    for (const char* p = text; *p; p++) {
+        if (*p == '"' || *p == '\\') escaped += '\\';
+        escaped += *p;
+    }
+    return escaped;
+}
+
+// Write all buffered events to the MYGIT_TRACE2 file
+void flushTrace() {
+    const char* path = traceOutputPath();
+    if (!path) return;
+
+    ofstream out(path, ios::trunc);
+    if (!out) {
+        cerr << "Warning: Cannot write trace file " << path << "\n";
+        return;
+    }
+
+    int pid = getpid();
+    bool first = true;
+    out << "{\"traceEvents\":[\n";
+
+    lock_guard<mutex> lock(traceBuffersMutex);
+    for (const auto& buffer : traceBuffers) {
+        if (!first) out << ",\n";
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->threadId
+            << ",\"args\":{\"name\":\"" << (buffer->threadId == 1 ? "main" : "worker") << "\"}}";
+
+        for (const TraceEvent& event : buffer->events) {
+            out << ",\n{\"name\":\"" << escapeTraceString(event.name) << "\",\"cat\":\"mygit\",\"ph\":\"X\""
+                << ",\"ts\":" << event.startMicros << ",\"dur\":" << event.durationMicros
+                << ",\"pid\":" << pid << ",\"tid\":" << buffer->threadId << "}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+// Called once from main; registers the exit-time flush when tracing is on
+void initializeTrace() {
+    if (!traceEnabled()) return;
+    traceThreadBuffer(); // the main thread gets id 1
+    atexit(flushTrace);
+}
+
+TraceSpan::TraceSpan(const char* name) : name(name), startMicros(-1) {
+    if (traceEnabled()) {
+        startMicros = traceNowMicros();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if (startMicros < 0) return;
+    traceThreadBuffer().events.push_back({name, startMicros, traceNowMicros() - startMicros});
+}
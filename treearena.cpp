@@ -0,0 +1,303 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <shared_mutex>
+#include <type_traits>
+#include <unordered_map>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "header.h"
+
+using namespace std;
+
+// Tree parsing and per-walk tree storage
+//
+// A tree object is a sequence of "<mode> <name>\0<20-byte id>" entries.
+// TreeArena inflates each tree straight into one of its blocks and parses
+// it into a packed array of TreeEntry (mode enum, binary id, name view into
+// the inflated bytes) placed in the same blocks, so a walk over a large
+// tree makes no per-entry allocations and frees everything at once.
+
+// Arena blocks double from the first size up to the largest, so a walk
+// that reads one small tree stays small
+const size_t TREE_ARENA_FIRST_BLOCK_SIZE = 16 << 10;
+const size_t TREE_ARENA_MAX_BLOCK_SIZE = 1 << 20;
+
+static_assert(is_trivially_copyable_v<TreeEntry>, "tree entries are copied into the arena as bytes");
+
+const char* TreeEntry::modeString() const {
+    switch (mode) {
+        case TreeEntryMode::EXECUTABLE: return "100755";
+        case TreeEntryMode::SYMLINK: return "120000";
+        case TreeEntryMode::TREE: return "40000";
+        case TreeEntryMode::GITLINK: return "160000";
+        default: return "100644";
+    }
+}
+
+const char* TreeEntry::typeName() const {
+    if (mode == TreeEntryMode::TREE) return "tree";
+    if (mode == TreeEntryMode::GITLINK) return "commit";
+    return "blob";
+}
+
+string TreeEntry::hex() const {
+    return objectIdToHex(id);
+}
+
+// Mode of a tree entry from its octal text; false for unknown modes
+bool parseTreeEntryMode(string_view text, TreeEntryMode& mode) {
+    if (text == "100644" || text == "100664") {
+        mode = TreeEntryMode::FILE;
+    } else if (text == "40000" || text == "040000") {
+        mode = TreeEntryMode::TREE;
+    } else if (text == "100755") {
+        mode = TreeEntryMode::EXECUTABLE;
+    } else if (text == "120000") {
+        mode = TreeEntryMode::SYMLINK;
+    } else if (text == "160000") {
+        mode = TreeEntryMode::GITLINK;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Offsets of the space ending the mode and the NUL ending the name. With
+// SSE2 each 16-byte load is checked for both bytes at once, so an entry
+// with a short name is split by a single compare.
+bool findTreeEntrySeparators(const char* data, size_t length, size_t& space, size_t& nul) {
+    size_t i = 0;
+    bool haveSpace = false;
+#if defined(__SSE2__)
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i zeros = _mm_setzero_si128();
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        unsigned nulMask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zeros)));
+        if (!haveSpace) {
+            unsigned spaceMask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, spaces)));
+            if (spaceMask == 0) continue;
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(spaceMask));
+            space = i + bit;
+            haveSpace = true;
+            nulMask &= ~((2u << bit) - 1); // only a NUL after the space ends the name
+        }
+        if (nulMask != 0) {
+            nul = i + static_cast<unsigned>(__builtin_ctz(nulMask));
+            return true;
+        }
+    }
+#endif
+    if (!haveSpace) {
+        const void* found = memchr(data + i, ' ', length - i);
+        if (!found) return false;
+        space = static_cast<size_t>(static_cast<const char*>(found) - data);
+        i = space + 1;
+    }
+    const void* found = memchr(data + i, '\0', length - i);
+    if (!found) return false;
+    nul = static_cast<size_t>(static_cast<const char*>(found) - data);
+    return true;
+}
+
+// Parse the entry at pos and advance past it; false if it is malformed
+bool parseTreeEntry(string_view content, size_t& pos, TreeEntry& entry) {
+    if (pos >= content.size()) return false;
+    size_t space, nul;
+    if (!findTreeEntrySeparators(content.data() + pos, content.size() - pos, space, nul)) return false;
+    space += pos;
+    nul += pos;
+    if (nul == space + 1 || nul + 21 > content.size()) return false;
+    if (!parseTreeEntryMode(content.substr(pos, space - pos), entry.mode)) return false;
+
+    entry.name = content.substr(space + 1, nul - space - 1);
+    memcpy(entry.id.bytes.data(), content.data() + nul + 1, entry.id.bytes.size());
+    pos = nul + 21;
+    return true;
+}
+
+// Path of an entry named name inside the directory prefix ("" for the root)
+string joinTreePath(const string& prefix, string_view name) {
+    string path;
+    path.reserve(prefix.size() + 1 + name.size());
+    if (!prefix.empty()) {
+        path += prefix;
+        path += '/';
+    }
+    path += name;
+    return path;
+}
+
+// Inflate a tree object into memory from allocate(size), which is called
+// once the header gives the size
+bool inflateTree(const string& treeSHA, const string& gitDir, const function<char*(size_t)>& allocate,
+                 size_t& size, string& error) {
+    bool isTree = true;
+    char* out = nullptr;
+    size_t written = 0;
+    bool ok = streamObject(
+        treeSHA,
+        [&](const string& type, size_t objectSize) {
+            isTree = type == "tree";
+            if (!isTree) return false;
+            size = objectSize;
+            out = allocate(size);
+            return true;
+        },
+        [&](const char* data, size_t length) {
+            if (length > size - written) return false;
+            memcpy(out + written, data, length);
+            written += length;
+            return true;
+        },
+        gitDir);
+    if (!isTree) {
+        error = "Object is not a tree";
+        return false;
+    }
+    if (!ok || written != size) {
+        error = "Tree object not found or cannot be read";
+        return false;
+    }
+    return true;
+}
+
+// Bump-allocate from the current block; the caller holds the lock.
+// Requests larger than a quarter of a block get a block of their own.
+char* TreeArena::allocate(size_t size, size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(next) % alignment) % alignment;
+    if (padding + size > remaining) {
+        size_t nextBlockSize = min(TREE_ARENA_MAX_BLOCK_SIZE, max(TREE_ARENA_FIRST_BLOCK_SIZE, blockSize * 2));
+        if (size > nextBlockSize / 4) {
+            blocks.emplace_back(new char[size]);
+            return blocks.back().get();
+        }
+        blockSize = nextBlockSize;
+        blocks.emplace_back(new char[blockSize]);
+        next = blocks.back().get();
+        remaining = blockSize;
+        padding = 0;
+    }
+    char* result = next + padding;
+    next += padding + size;
+    remaining -= padding + size;
+    return result;
+}
+
+// Parse into a per-thread scratch array, then copy it into the arena in one piece
+bool TreeArena::parseInto(string_view content, span<const TreeEntry>& entries) {
+    thread_local vector<TreeEntry> scratch;
+    scratch.clear();
+    size_t pos = 0;
+    TreeEntry entry;
+    while (pos < content.size()) {
+        if (!parseTreeEntry(content, pos, entry)) return false;
+        scratch.push_back(entry);
+    }
+
+    size_t bytes = scratch.size() * sizeof(TreeEntry);
+    char* out;
+    {
+        lock_guard<mutex> guard(lock);
+        out = allocate(bytes, alignof(TreeEntry));
+    }
+    if (bytes > 0) memcpy(out, scratch.data(), bytes);
+    entries = span<const TreeEntry>(reinterpret_cast<const TreeEntry*>(out), scratch.size());
+    return true;
+}
+
+bool TreeArena::read(const string& treeSHA, span<const TreeEntry>& entries, string& error, const string& gitDir) {
+    entries = {};
+    char* content = nullptr;
+    size_t size = 0;
+    auto allocateContent = [&](size_t bytes) {
+        lock_guard<mutex> guard(lock);
+        content = allocate(bytes, 1);
+        return content;
+    };
+    if (!inflateTree(treeSHA, gitDir, allocateContent, size, error)) return false;
+    if (!parseInto(string_view(content, size), entries)) {
+        error = "Tree " + treeSHA + " is corrupt";
+        return false;
+    }
+    return true;
+}
+
+bool TreeArena::read(const ObjectId& id, span<const TreeEntry>& entries, string& error, const string& gitDir) {
+    return read(objectIdToHex(id), entries, error, gitDir);
+}
+
+bool TreeArena::parse(shared_ptr<const string> content, span<const TreeEntry>& entries) {
+    entries = {};
+    if (!parseInto(*content, entries)) return false;
+    lock_guard<mutex> guard(lock);
+    pinned.push_back(move(content));
+    return true;
+}
+
+// Tree contents cached by "mygit serve" (trees never change, so they never
+// go stale); dropped wholesale past RESIDENT_TREE_CACHE_BYTES. Arenas keep
+// a reference to what they parse, so dropping never invalidates a walk.
+const size_t RESIDENT_TREE_CACHE_BYTES = 128 << 20;
+
+struct ResidentTrees {
+    shared_mutex lock;
+    unordered_map<string, shared_ptr<const string>> trees;
+    size_t bytes = 0;
+};
+
+ResidentTrees& residentTrees() {
+    static ResidentTrees& cache = *new ResidentTrees; // never freed, so forked commands exit without touching it
+    return cache;
+}
+
+// Read a tree in the current repository into arena (used by checkout,
+// status, show and the other tree walkers). Errors are printed and give no
+// entries.
+span<const TreeEntry> readTreeEntries(TreeArena& arena, const string& treeSHA) {
+    span<const TreeEntry> entries;
+    string error;
+    if (!residentCachesEnabled()) {
+        if (!arena.read(treeSHA, entries, error)) cerr << "Error: " << error << "\n";
+        return entries;
+    }
+
+    ResidentTrees& cache = residentTrees();
+    shared_ptr<const string> content;
+    {
+        shared_lock<shared_mutex> guard(cache.lock);
+        auto found = cache.trees.find(treeSHA);
+        if (found != cache.trees.end()) content = found->second;
+    }
+    if (!content) {
+        auto inflated = make_shared<string>();
+        size_t size = 0;
+        auto allocateContent = [&](size_t bytes) {
+            inflated->resize(bytes);
+            return inflated->data();
+        };
+        if (!inflateTree(treeSHA, ".mygit", allocateContent, size, error)) {
+            cerr << "Error: " << error << "\n";
+            return entries;
+        }
+        content = inflated;
+
+        unique_lock<shared_mutex> guard(cache.lock);
+        if (cache.bytes + content->size() > RESIDENT_TREE_CACHE_BYTES) {
+            cache.trees.clear();
+            cache.bytes = 0;
+        }
+        if (cache.trees.emplace(treeSHA, content).second) cache.bytes += content->size();
+    }
+
+    if (!arena.parse(content, entries)) cerr << "Error: Tree " << treeSHA << " is corrupt\n";
+    return entries;
+}
+
+span<const TreeEntry> readTreeEntries(TreeArena& arena, const ObjectId& treeId) {
+    return readTreeEntries(arena, objectIdToHex(treeId));
+}
@@ -9,6 +9,9 @@
 #include <openssl/sha.h>
 #include <openssl/evp.h>
 #include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 #include "header.h"
 
 namespace fs = std::filesystem;
@@ -16,6 +19,7 @@ using namespace std;
 
 // Function to decompress zlib-compressed data (string version)
 string decompressData(const string& compressedData) {
+    TraceSpan span("decompressData");
     z_stream zs;
     memset(&zs, 0, sizeof(zs));
     
@@ -50,11 +54,13 @@ string decompressData(const string& compressedData) {
         return "";
     }
     
+    countStat(STAT_BYTES_INFLATED, outstring.size());
     return outstring;
 }
 
 // Function to decompress zlib-compressed data (vector version for lstree.cpp)
 string decompressData(const vector<unsigned char>& compressedData) {
+    TraceSpan span("decompressData");
     z_stream stream;
     memset(&stream, 0, sizeof(stream));
     
@@ -92,11 +98,13 @@ string decompressData(const vector<unsigned char>& compressedData) {
     } while (stream.avail_out == 0);
     
     inflateEnd(&stream);
+    countStat(STAT_BYTES_INFLATED, decompressed.size());
     return string(decompressed.begin(), decompressed.end());
 }
 
-// Function to read object file from .mygit/objects
-string readObjectFile(const string& hash) {
+// Function to read object file from .mygit/objects, without reassembling chunked blobs
+string readRawObjectFile(const string& hash) {
+    TraceSpan span("readObjectFile");
     string objectPath = ".mygit/objects/" + hash.substr(0, 2) + "/" + hash.substr(2);
     
     if (!fs::exists(objectPath)) {
@@ -113,11 +121,228 @@ string readObjectFile(const string& hash) {
     // Read the compressed data
     string compressedData((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
     file.close();
+    countStat(STAT_OBJECTS_READ);
     
     // Decompress the data
     return decompressData(compressedData);
 }
 
+// Function to read object file from .mygit/objects; chunked blobs are
+// returned as the reassembled blob so callers never see the manifest
+string readObjectFile(const string& hash) {
+    string objectData = readRawObjectFile(hash);
+    if (objectData.compare(0, 8, "chunked ") != 0) {
+        return objectData;
+    }
+    
+    size_t nullPos = objectData.find('\0');
+    if (nullPos == string::npos) {
+        cerr << "Error: Invalid object format\n";
+        return "";
+    }
+    return reassembleChunkedBlob(objectData.substr(nullPos + 1));
+}
+
+// Blobs smaller than this are never preallocated
+const size_t PREALLOCATE_MIN_SIZE = 1 << 20;
+
+// Inflate state and buffers reused for every object read on a thread
+struct InflateContext {
+    z_stream stream;
+    bool initialized = false;
+    vector<char> input = vector<char>(1 << 16);
+    vector<char> output = vector<char>(1 << 16);
+
+    ~InflateContext() {
+        if (initialized) inflateEnd(&stream);
+    }
+};
+
+// The calling thread's inflate context, reset for a new object
+z_stream* resetInflateContext(InflateContext& context) {
+    if (!context.initialized) {
+        memset(&context.stream, 0, sizeof(context.stream));
+        if (inflateInit(&context.stream) != Z_OK) return nullptr;
+        context.initialized = true;
+    } else if (inflateReset(&context.stream) != Z_OK) {
+        return nullptr;
+    }
+    context.stream.avail_in = 0;
+    return &context.stream;
+}
+
+InflateContext& threadInflateContext() {
+    thread_local InflateContext context;
+    return context;
+}
+
+// Open a loose object; -1 if it does not exist
+int openObjectFile(const string& hash, const string& gitDir) {
+    if (hash.size() != 40) return -1;
+    string objectPath = gitDir + "/objects/" + hash.substr(0, 2) + "/" + hash.substr(2);
+    int fd = open(objectPath.c_str(), O_RDONLY);
+    if (fd >= 0) countStat(STAT_OBJECTS_READ);
+    return fd;
+}
+
+// Inflate from fd into out until out is full or the stream ends
+int inflateObjectFile(int fd, InflateContext& context, char* out, size_t outSize, size_t& produced) {
+    z_stream& stream = context.stream;
+    stream.next_out = reinterpret_cast<Bytef*>(out);
+    stream.avail_out = static_cast<uInt>(outSize);
+    int ret = Z_OK;
+    while (stream.avail_out > 0 && ret != Z_STREAM_END) {
+        if (stream.avail_in == 0) {
+            ssize_t bytesRead = read(fd, context.input.data(), context.input.size());
+            if (bytesRead < 0 && errno == EINTR) continue;
+            if (bytesRead <= 0) return Z_DATA_ERROR; // truncated object
+            stream.next_in = reinterpret_cast<Bytef*>(context.input.data());
+            stream.avail_in = static_cast<uInt>(bytesRead);
+        }
+        ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret == Z_BUF_ERROR) ret = Z_OK; // needs more input
+        if (ret != Z_OK && ret != Z_STREAM_END) return ret;
+    }
+    produced = outSize - stream.avail_out;
+    countStat(STAT_BYTES_INFLATED, produced);
+    return ret;
+}
+
+// Parse "<type> <size>\0"; returns the header length, or 0 if malformed
+size_t parseObjectHeader(const char* data, size_t length, string& type, size_t& size) {
+    const char* nullPos = static_cast<const char*>(memchr(data, '\0', length));
+    const char* space = static_cast<const char*>(memchr(data, ' ', length));
+    if (!nullPos || !space || space > nullPos) return 0;
+    type.assign(data, space - data);
+    size = strtoull(space + 1, nullptr, 10);
+    return nullPos - data + 1;
+}
+
+// Inflate one stored object block by block, as stored: a chunked blob
+// yields its manifest. Prints nothing; false if the object is missing,
+// corrupt, or a callback returned false.
+bool streamStoredObject(const string& hash, const string& gitDir,
+                        const function<bool(const string&, size_t)>& onHeader,
+                        const function<bool(const char*, size_t)>& onData) {
+    int fd = openObjectFile(hash, gitDir);
+    if (fd < 0) return false;
+
+    InflateContext& context = threadInflateContext();
+    if (!resetInflateContext(context)) {
+        close(fd);
+        return false;
+    }
+
+    string header;
+    bool headerDone = false, ok = true;
+    int ret = Z_OK;
+    while (ret != Z_STREAM_END) {
+        size_t produced = 0;
+        ret = inflateObjectFile(fd, context, context.output.data(), context.output.size(), produced);
+        if (ret != Z_OK && ret != Z_STREAM_END) {
+            ok = false;
+            break;
+        }
+
+        const char* data = context.output.data();
+        if (!headerDone) {
+            const char* nullPos = static_cast<const char*>(memchr(data, '\0', produced));
+            size_t take = nullPos ? nullPos - data + 1 : produced;
+            header.append(data, take);
+            data += take;
+            produced -= take;
+            if (!nullPos) {
+                if (header.size() > 64) {
+                    ok = false;
+                    break;
+                }
+                continue;
+            }
+            headerDone = true;
+            string type;
+            size_t size;
+            if (parseObjectHeader(header.data(), header.size(), type, size) == 0 || !onHeader(type, size)) {
+                ok = false;
+                break;
+            }
+        }
+        if (produced > 0 && !onData(data, produced)) {
+            ok = false;
+            break;
+        }
+    }
+    close(fd);
+    return ok && headerDone;
+}
+
+// Manifest of a chunked blob; empty if it cannot be read
+string readChunkManifest(const string& hash, const string& gitDir) {
+    string manifest;
+    streamStoredObject(
+        hash, gitDir, [](const string& type, size_t) { return type == "chunked"; },
+        [&manifest](const char* data, size_t length) {
+            manifest.append(data, length);
+            return true;
+        });
+    return manifest;
+}
+
+// Read an object's type and size, inflating only its header. Chunked
+// blobs report the size of the reassembled blob.
+bool readObjectHeader(const string& hash, string& type, size_t& size, const string& gitDir) {
+    int fd = openObjectFile(hash, gitDir);
+    if (fd < 0) return false;
+
+    InflateContext& context = threadInflateContext();
+    char header[64]; // "<type> <size>\0" always fits
+    size_t produced = 0;
+    int ret = resetInflateContext(context) ? inflateObjectFile(fd, context, header, sizeof(header), produced) : Z_MEM_ERROR;
+    close(fd);
+    if ((ret != Z_OK && ret != Z_STREAM_END) || parseObjectHeader(header, produced, type, size) == 0) return false;
+
+    if (type == "chunked") {
+        string manifest = readChunkManifest(hash, gitDir);
+        if (manifest.empty()) return false;
+        type = "blob";
+        size = chunkedBlobSize(manifest);
+    }
+    return true;
+}
+
+// Inflate an object block by block without holding it in memory. onHeader
+// gets the type and size first, then onData gets the content; either can
+// stop the read by returning false. Chunked blobs stream chunk by chunk.
+bool streamObject(const string& hash, const function<bool(const string&, size_t)>& onHeader,
+                  const function<bool(const char*, size_t)>& onData, const string& gitDir) {
+    bool chunked = false;
+    string manifest;
+    bool ok = streamStoredObject(
+        hash, gitDir,
+        [&](const string& type, size_t size) {
+            chunked = type == "chunked";
+            return chunked || onHeader(type, size);
+        },
+        [&](const char* data, size_t length) {
+            if (!chunked) return onData(data, length);
+            manifest.append(data, length);
+            return true;
+        });
+    if (!ok || !chunked) return ok;
+
+    // Manifest lines are "<chunk-sha> <length>"; each chunk is a plain blob
+    if (!onHeader("blob", chunkedBlobSize(manifest))) return false;
+    size_t lineStart = 0;
+    while (lineStart < manifest.size()) {
+        size_t lineEnd = manifest.find('\n', lineStart);
+        if (lineEnd == string::npos) lineEnd = manifest.size();
+        string chunkHash = manifest.substr(lineStart, min<size_t>(40, lineEnd - lineStart));
+        auto isBlob = [](const string& chunkType, size_t) { return chunkType == "blob"; };
+        if (!streamStoredObject(chunkHash, gitDir, isBlob, onData)) return false;
+        lineStart = lineEnd + 1;
+    }
+    return true;
+}
+
 // Function to parse object (returns type, size, content)
 tuple<string, size_t, string> parseObject(const string& objectData) {
     // Find the null terminator that separates header from content
@@ -139,122 +364,131 @@ tuple<string, size_t, string> parseObject(const string& objectData) {
     return {type, size, content};
 }
 
-// Function to parse a single tree entry from binary content
-TreeEntry parseTreeEntry(const string& content, size_t& pos) {
-    TreeEntry entry;
+// Function to compute SHA1 hash from string
+string computeSHA1FromString(const string& data) {
+    TraceSpan span("computeSHA1FromString");
+    unsigned char hash[SHA_DIGEST_LENGTH];
+    SHA1(reinterpret_cast<const unsigned char*>(data.c_str()), data.length(), hash);
     
-    if (pos >= content.length()) {
-        return entry; // Return empty entry if at end
+    string hex(2 * SHA_DIGEST_LENGTH, '0');
+    formatHex(hash, SHA_DIGEST_LENGTH, hex.data());
+    return hex;
+}
+
+// Function to convert a 40-character hex id to binary
+bool hexToObjectId(const string& hex, ObjectId& id) {
+    if (hex.size() != 40) return false;
+    
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    
+    for (size_t i = 0; i < 20; i++) {
+        int high = nibble(hex[2 * i]);
+        int low = nibble(hex[2 * i + 1]);
+        if (high < 0 || low < 0) return false;
+        id.bytes[i] = static_cast<unsigned char>((high << 4) | low);
     }
-    
-    // Find the space that separates mode from filename
-    size_t spacePos = content.find(' ', pos);
-    if (spacePos == string::npos) {
-        return entry;
+    return true;
+}
+
+// Function to convert a binary id to lowercase hex
+string objectIdToHex(const ObjectId& id) {
+    string hex(40, '0');
+    formatHex(id.bytes.data(), 20, hex.data());
+    return hex;
+}
+
+// Write all bytes to fd, retrying short writes
+bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
     }
-    
-    // Extract mode
-    entry.mode = content.substr(pos, spacePos - pos);
-    
-    // Determine type based on mode
-    if (entry.mode == "040000" || entry.mode == "40000") {
-        entry.type = "tree";
+    return true;
+}
+
+// Stream a blob's content into fd without holding it in memory. With
+// preallocate, the blob's size is reserved first so large files are laid
+// out in few extents; filesystems that can't do that are written as usual.
+bool writeBlobToFd(const string& blobSHA, int fd, bool preallocate, string& error) {
+    TraceSpan span("writeBlobToFd");
+    size_t expected = 0, written = 0;
+    bool writeFailed = false;
+    bool ok = streamObject(
+        blobSHA,
+        [&](const string& type, size_t size) {
+            if (type != "blob") {
+                error = "Expected blob, got " + type;
+                return false;
+            }
+            expected = size;
+            if (preallocate && size >= PREALLOCATE_MIN_SIZE) {
+                // fallocate(2), not posix_fallocate: glibc's fallback would
+                // write the whole file twice where it isn't supported
+                fallocate(fd, 0, 0, static_cast<off_t>(size));
+            }
+            return true;
+        },
+        [&](const char* data, size_t length) {
+            if (!writeAll(fd, data, length)) {
+                writeFailed = true;
+                return false;
+            }
+            written += length;
+            return true;
+        });
+
+    if (ok && written == expected) return true;
+    if (!error.empty()) return false;
+    if (writeFailed) {
+        error = "Cannot write blob " + blobSHA;
+    } else if (!objectExists(blobSHA)) {
+        error = "Blob object " + blobSHA + " not found";
     } else {
-        entry.type = "blob";
+        error = "Blob object " + blobSHA + " is corrupt";
     }
-    
-    // Find the null terminator that separates filename from SHA
-    size_t nullPos = content.find('\0', spacePos + 1);
-    if (nullPos == string::npos || nullPos + 20 > content.length()) {
-        return entry;
-    }
-    
-    // Extract filename
-    entry.name = content.substr(spacePos + 1, nullPos - spacePos - 1);
-    
-    // Extract 20-byte binary SHA and convert to hex
-    stringstream ss;
-    for (int i = 0; i < 20; i++) {
-        unsigned char byte = content[nullPos + 1 + i];
-        ss << hex << setw(2) << setfill('0') << (int)byte;
-    }
-    entry.sha = ss.str();
-    
-    // Update position to next entry
-    pos = nullPos + 21; // null + 20 bytes SHA
-    
-    return entry;
+    return false;
 }
 
-// Function to compute SHA1 hash from string
-string computeSHA1FromString(const string& data) {
-    unsigned char hash[SHA_DIGEST_LENGTH];
-    SHA1(reinterpret_cast<const unsigned char*>(data.c_str()), data.length(), hash);
-    
-    stringstream ss;
-    for (int i = 0; i < SHA_DIGEST_LENGTH; i++) {
-        ss << hex << setw(2) << setfill('0') << (int)hash[i];
+// Check if the SHA is exactly 40 characters long and is hexadecimal
+bool isValidSHA1(const string& sha) {
+    if (sha.size() != 40) return false;
+    for (char c : sha) {
+        if (!isxdigit(static_cast<unsigned char>(c))) return false;
     }
-    
-    return ss.str();
+    return true;
 }
 
 // Function to check if object exists
 bool objectExists(const string& sha) {
     string objectPath = ".mygit/objects/" + sha.substr(0, 2) + "/" + sha.substr(2);
+    countStat(STAT_FILES_STATED);
     return fs::exists(objectPath);
 }
 
-// Function to read the HEAD reference
-string readHEAD() {
-    ifstream headFile(".mygit/HEAD");
-    if (!headFile) return "";
-    string headContent;
-    getline(headFile, headContent);
-    return headContent;
-}
-
-// Function to write the HEAD reference
-void writeHEAD(const string& commitHash) {
-    ofstream headFile(".mygit/HEAD");
-    headFile << commitHash;
-}
-
 // Function to check if a path is hidden (used by multiple files)
 bool isHidden(const fs::path& path) {
     string filename = path.filename().string();
     return !filename.empty() && (filename[0] == '.' || filename == ".mygit");
 }
 
-// Function to read tree entries from tree object (used by checkout, status, show)
-vector<TreeEntry> readTreeEntries(const string& treeSHA) {
-    vector<TreeEntry> entries;
-    
-    string objectContent = readObjectFile(treeSHA);
-    if (objectContent.empty()) {
-        cerr << "Error: Tree object not found or cannot be read\n";
-        return entries;
-    }
-    
-    auto [type, size, content] = parseObject(objectContent);
-    if (type != "tree") {
-        cerr << "Error: Object is not a tree\n";
-        return entries;
-    }
-    
-    // Parse tree entries from binary content
-    size_t pos = 0;
-    while (pos < content.length()) {
-        TreeEntry entry = parseTreeEntry(content, pos);
-        if (entry.sha.empty()) break;
-        entries.push_back(entry);
-    }
-    
-    return entries;
-}
-
 // Function to get tree SHA from commit object (used by checkout, reset, show)
 string getTreeSHAFromCommit(const string& commitSHA) {
+    // The commit-graph answers without inflating the commit
+    CommitSummary summary;
+    if (lookupCommitGraph(commitSHA, summary)) {
+        return summary.treeHash;
+    }
+    
     string objectContent = readObjectFile(commitSHA);
     if (objectContent.empty()) {
         cerr << "Error: Commit object not found or cannot be read\n";
@@ -32,99 +32,60 @@ string hashObject(const fs::path& filePath, bool writeFlag) {
     if (fileContent.empty() && fs::file_size(filePath) > 0) {
         return "";
     }
+    countStat(STAT_FILES_OPENED);
+    countStat(STAT_FILES_HASHED);
+    
+    // Large files become chunked blobs
+    if (shouldChunkBlob(fileContent.size())) {
+        return storeChunkedBlob(fileContent, writeFlag);
+    }
     
     // Create blob format
     string blobContent = "blob " + to_string(fileContent.length()) + '\0' + fileContent;
     string hash = computeSHA1FromString(blobContent); // Use function from utilities.cpp
     
     if (writeFlag) {
-        // Compress the blob content
-        uLongf compressedSize = compressBound(blobContent.size());
-        vector<unsigned char> compressedData(compressedSize);
-        
-        if (compress(compressedData.data(), &compressedSize,
-                    reinterpret_cast<const Bytef*>(blobContent.data()),
-                    blobContent.size()) != Z_OK) {
-            return "";
-        }
-        
-        // Store compressed blob
-        string objectDir = ".mygit/objects/" + hash.substr(0, 2);
-        fs::create_directories(objectDir);
-        string objectPath = objectDir + "/" + hash.substr(2);
-        
-        ofstream blobFile(objectPath, ios::binary);
-        if (!blobFile) {
+        // Compressed and stored atomically, safe to call from pool tasks
+        string error;
+        if (!storeObject(".mygit", hash, blobContent, error)) {
+            cerr << ("Error: " + error + "\n");
             return "";
         }
-        
-        blobFile.write(reinterpret_cast<const char*>(compressedData.data()), compressedSize);
-        blobFile.close();
     }
     
     return hash;
 }
 
-// Main writeTree function
-string writeTree(const fs::path& dirPath = ".") {
-    cout << "Creating tree structure for: \"" << fs::absolute(dirPath) << "\"" << endl;
-    
-    if (!fs::exists(".mygit/objects")) {
-        fs::create_directories(".mygit/objects");
-    }
-
-    vector<tuple<string, string, string>> entries; 
-    // (filename, mode, hash)
+// Number of files hashed by a single pool task in a wide directory
+const size_t BLOB_BATCH_SIZE = 64;
 
-    // Collect all entries
-    for (const auto& entry : fs::directory_iterator(dirPath)) {
-        if (isHidden(entry.path())) continue; // Use function from utilities.cpp
-
-        string entryName = entry.path().filename().string();
-        string mode, hash;
-
-        if (fs::is_regular_file(entry.status())) {
-            // Create blob and get its hash
-            hash = hashObject(entry.path(), true);  
-            if (hash.empty()) {
-                cerr << "Failed to create blob for " << entry.path() << endl;
-                continue;
-            }
-            mode = "100644"; // regular file
-        }
-        else if (fs::is_directory(entry.status())) {
-            // Recursively create subtree
-            hash = writeTree(entry.path());
-            if (hash.empty()) {
-                continue;
-            }
-            mode = "40000"; // directory (tree)
-        }
-        entries.push_back({entryName, mode, hash});
-    }
+// Tree entry under construction; hash is filled in by the task that writes it
+struct PendingTreeEntry {
+    string name;
+    string mode;
+    string hash;
+};
 
+// Serialize sorted entries into a tree object and store it, returns hash
+string storeTreeObject(vector<PendingTreeEntry>& entries) {
     // Sort entries by filename
     sort(entries.begin(), entries.end(),
-         [](const auto& a, const auto& b) {
-             return get<0>(a) < get<0>(b);
+         [](const PendingTreeEntry& a, const PendingTreeEntry& b) {
+             return a.name < b.name;
          });
 
     // Build tree content
     string fullContent;
     for (const auto& entry : entries) {
-        string filename = get<0>(entry);
-        string mode     = get<1>(entry);
-        string hashHex  = get<2>(entry);
-
         // mode + space + filename + null
-        fullContent += mode;
+        fullContent += entry.mode;
         fullContent += " ";
-        fullContent += filename;
+        fullContent += entry.name;
         fullContent += '\0';
 
         // convert hash hex -> raw 20 bytes
-        for (size_t i = 0; i < hashHex.size(); i += 2) {
-            string byteStr = hashHex.substr(i, 2);
+        for (size_t i = 0; i < entry.hash.size(); i += 2) {
+            string byteStr = entry.hash.substr(i, 2);
             char byte = (char)stoi(byteStr, nullptr, 16);
             fullContent.push_back(byte);
         }
@@ -136,35 +97,107 @@ string writeTree(const fs::path& dirPath = ".") {
 
     // Hash the whole tree object
     string treeHash = computeSHA1FromString(completeObject); // Use function from utilities.cpp
+    string error;
+    if (!storeObject(".mygit", treeHash, completeObject, error)) {
+        cerr << ("Error: " + error + "\n");
+        return "";
+    }
+    return treeHash;
+}
 
-    // Compress
-    uLongf compressedSize = compressBound(completeObject.size());
-    vector<unsigned char> compressedData(compressedSize);
+// -v lines come from pool tasks and share one buffer
+mutex verboseOutputMutex;
+
+// Build the tree for one directory. Every subdirectory and every batch of
+// files becomes a task on the shared pool; the directory waits for its
+// children's hashes before serializing its own tree. Returns "" when a
+// subdirectory could not be read or written, so the failure reaches the top.
+string writeTreeTask(const fs::path& dirPath, bool verbose) {
+    TraceSpan span("writeTree");
+    if (verbose) {
+        lock_guard<mutex> guard(verboseOutputMutex);
+        standardOutput() << "Creating tree structure for: " << fs::absolute(dirPath).string() << "\n";
+    }
 
-    if (compress(compressedData.data(), &compressedSize,
-                 reinterpret_cast<const Bytef*>(completeObject.data()),
-                 completeObject.size()) != Z_OK) {
-        cerr << "Error: Compression failed\n";
-        return "";
+    vector<PendingTreeEntry> entries;
+    vector<size_t> fileIndexes;
+
+    countStat(STAT_DIRECTORIES_SCANNED);
+
+    // Collect all entries
+    for (const auto& entry : fs::directory_iterator(dirPath)) {
+        if (isHidden(entry.path())) continue; // Use function from utilities.cpp
+
+        string entryName = entry.path().filename().string();
+        if (fs::is_regular_file(entry.status())) {
+            fileIndexes.push_back(entries.size());
+            entries.push_back({entryName, "100644", ""}); // regular file
+        } else if (fs::is_directory(entry.status())) {
+            entries.push_back({entryName, "40000", ""}); // directory (tree)
+        }
     }
 
-    // Save in .mygit/objects/xx/yyyy... format
-    string objectDir = ".mygit/objects/" + treeHash.substr(0, 2);
-    fs::create_directories(objectDir);
-    string objectPath = objectDir + "/" + treeHash.substr(2);
+    bool complete;
+    {
+        TaskGroup group(sharedThreadPool());
 
-    ofstream treeFile(objectPath, ios::binary);
-    if (!treeFile) {
-        cerr << "Error: Could not create tree object file\n";
-        return "";
+        // Recursively create subtrees
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].mode != "40000") continue;
+            group.run([&entries, &dirPath, i, verbose]() {
+                entries[i].hash = writeTreeTask(dirPath / entries[i].name, verbose);
+            });
+        }
+
+        // Create blobs in batches
+        for (size_t start = 0; start < fileIndexes.size(); start += BLOB_BATCH_SIZE) {
+            size_t end = min(start + BLOB_BATCH_SIZE, fileIndexes.size());
+            group.run([&entries, &fileIndexes, &dirPath, start, end]() {
+                for (size_t k = start; k < end; k++) {
+                    PendingTreeEntry& entry = entries[fileIndexes[k]];
+                    fs::path filePath = dirPath / entry.name;
+                    entry.hash = hashObject(filePath, true);
+                    if (entry.hash.empty()) {
+                        cerr << ("Failed to create blob for " + filePath.string() + "\n");
+                    }
+                }
+            });
+        }
+
+        complete = group.wait();
+    }
+    for (const PendingTreeEntry& entry : entries) {
+        if (entry.mode == "40000" && entry.hash.empty()) complete = false;
     }
-    treeFile.write(reinterpret_cast<const char*>(compressedData.data()), compressedSize);
-    treeFile.close();
+    if (!complete) return "";
 
-    cout << "Created tree object with hash: " << treeHash << endl;
+    // Skip files whose blob could not be written, as the serial version did
+    entries.erase(remove_if(entries.begin(), entries.end(),
+                            [](const PendingTreeEntry& e) { return e.hash.empty(); }),
+                  entries.end());
+
+    string treeHash = storeTreeObject(entries);
+    if (verbose) {
+        lock_guard<mutex> guard(verboseOutputMutex);
+        standardOutput() << "Created tree object with hash: " << treeHash << "\n";
+    }
     return treeHash;
 }
 
+// Main writeTree function
+string writeTree(const fs::path& dirPath, bool verbose) {
+    if (!fs::exists(".mygit/objects")) {
+        fs::create_directories(".mygit/objects");
+    }
+
+    try {
+        return writeTreeTask(dirPath, verbose);
+    } catch (const fs::filesystem_error& e) {
+        cerr << "Error: " << e.what() << "\n";
+        return "";
+    }
+}
+
 // Handler function for command line interface
 bool handleWriteTree(int argc, char* argv[]) {
     // Check if repository is initialized
@@ -180,6 +213,6 @@ bool handleWriteTree(int argc, char* argv[]) {
     }
     
     // Output just the hash for command line usage (like git write-tree)
-    cout << treeHash << endl;
+    standardOutput() << treeHash << "\n";
     return true;
 }
\ No newline at end of file